@@ -1,6 +1,9 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
 #include <zcbor_common.h>
+#include <zcbor_encode.h>
 
 #include <zephyr/net/coap.h>
 
@@ -9,19 +12,225 @@
 #include <datapoint/czd_datapoint_encode.h>
 #include <datapoint/czd_datapoint_types.h>
 
-#include <date_time.h>
-
+#ifdef CONFIG_DATAPOINT_AGGREGATE
+#include <datapoint_aggregate.h>
+#endif
+#include <datapoint_clock.h>
+#include <datapoint_csv.h>
+#include <datapoint_dictionary.h>
 #include <datapoint_helpers.h>
 #include <datapoint_queue.h>
+#ifdef CONFIG_DATAPOINT_SD_CBOR
+#include <datapoint_sdlog.h>
+#endif
+#include <datapoint_senml.h>
+#include <datapoint_sink.h>
+#if defined(CONFIG_DATAPOINT_ENCODING_TSZ) || defined(CONFIG_DATAPOINT_SD_TSZ)
+#include <datapoint_tsz.h>
+#endif
 
 #include <sd_card.h>
 
 LOG_MODULE_REGISTER(datapoint, LOG_LEVEL_INF);
 
+#define DATAPOINT_IMEI_TAIL 267864
+
+/* Longest wait for a datapoint before window summaries are checked */
+#define DATAPOINT_POLL_MS 1000
+
 const char * const data_path[] = {
     "ccd99122-3904-454a-95c7-9fb71f2c3fde", "data", NULL
 };
 
+static const char * const data_path_alias[] = {
+    CONFIG_DATAPOINT_PATH_ALIAS, NULL
+};
+
+static struct coap_request_template data_template;
+
+#ifdef CONFIG_DATAPOINT_ENCODING_SENML
+/* Datapoints awaiting a SenML pack, timestamped in milliseconds of uptime
+ * until the batch is flushed */
+static struct datapoint batch[CONFIG_DATAPOINT_SENML_BATCH_MAX];
+static size_t batch_len;
+static int64_t batch_deadline;
+
+/**
+ * @brief Send the batched datapoints as one or more SenML packs.
+ */
+static void dp_batch_flush(void)
+{
+    size_t sent = 0;
+
+    if (batch_len > 0 && cellular_state_get() != CELLULAR_STATE_RUNNING) {
+        LOG_WRN("Cellular interface not ready. %zu datapoints not sent",
+                batch_len);
+        batch_len = 0;
+        return;
+    }
+
+    /* Convert the whole batch with one offset, so that its relative times
+     * are exact even if the wall clock has since been stepped */
+    int64_t offset_ms;
+    if (datapoint_clock_offset(&offset_ms) != 0) {
+        LOG_ERR("Failed to get timestamp.");
+    }
+
+    for (size_t i = 0; i < batch_len; i++) {
+        batch[i].t += offset_ms;
+    }
+
+    while (sent < batch_len) {
+        struct cellular_uplink_buf buf;
+        int err = cellular_uplink_claim(&buf,
+                                        CONFIG_CELLULAR_UPLINK_BUFFER_SIZE,
+                                        CELLULAR_PRIORITY_TELEMETRY);
+        if (err != 0) {
+            LOG_ERR("Failed to claim uplink buffer: %d", err);
+            break;
+        }
+
+        buf.tag = "data";
+
+        int hdr_len = coap_template_build(&data_template, buf.data, buf.size,
+                                          true);
+        if (hdr_len < 0) {
+            LOG_ERR("Failed to build CoAP header: %d", hdr_len);
+            cellular_uplink_abort(&buf);
+            break;
+        }
+
+        /* Packs hold as many datapoints as fit in one uplink buffer */
+        size_t payload_len = 0;
+        int packed = datapoint_senml_encode(&batch[sent], batch_len - sent,
+                                            buf.data + hdr_len,
+                                            buf.size - hdr_len,
+                                            &payload_len);
+        if (packed < 0) {
+            LOG_ERR("SenML encode fail: %d", packed);
+            cellular_uplink_abort(&buf);
+            break;
+        }
+
+        LOG_INF("Sending SenML pack of %d datapoints (%zu B)", packed,
+                hdr_len + payload_len);
+
+        err = cellular_uplink_commit(&buf, hdr_len + payload_len);
+        if (err != 0) {
+            LOG_ERR("Failed to send datapoints: %d", err);
+        }
+
+        sent += packed;
+    }
+
+    if (sent < batch_len) {
+        LOG_WRN("Dropped %zu datapoints", batch_len - sent);
+    }
+
+    batch_len = 0;
+}
+
+/**
+ * @brief Add a datapoint to the batch, sending it once it is full.
+ */
+static void dp_sink_cellular_batch(const struct datapoint *dp)
+{
+    if (batch_len == 0) {
+        batch_deadline = k_uptime_get() +
+                         CONFIG_DATAPOINT_SENML_BATCH_TIMEOUT_MS;
+    }
+
+    batch[batch_len++] = *dp;
+
+    if (batch_len == ARRAY_SIZE(batch)) {
+        dp_batch_flush();
+    }
+}
+
+#elif defined(CONFIG_DATAPOINT_ENCODING_TSZ)
+/* Compressed blocks awaiting the uplink, one per sensor */
+static struct dp_tsz_set uplink_set;
+
+/* Largest CoAP header a template builds, with the payload marker */
+#define DP_TSZ_COAP_HEADER_MAX (4 + COAP_TOKEN_MAX_LEN + \
+                                CONFIG_COAP_TEMPLATE_MAX_OPTIONS_LEN + 1)
+/* Largest CBOR map around a block: map header, "i" uint32, "o" int64,
+ * "d" and "y" uint8 and "b" with a bstr header of up to three bytes */
+#define DP_TSZ_CBOR_OVERHEAD   (1 + 2 + 5 + 2 + 9 + 2 + 2 + 2 + 2 + 2 + 3)
+
+BUILD_ASSERT(DP_TSZ_COAP_HEADER_MAX + DP_TSZ_CBOR_OVERHEAD +
+             CONFIG_DATAPOINT_TSZ_BLOCK_SIZE <=
+             CONFIG_CELLULAR_UPLINK_BUFFER_SIZE,
+             "Compressed blocks must fit an uplink buffer");
+
+/**
+ * @brief Send a compressed block of one sensor's samples.
+ *
+ * The block is sent as a CBOR map {"i": IMEI tail, "o": uptime to UTC
+ * offset in ms, "d": sensor ID, "y": value type, "b": block}, so that block
+ * timestamps stay in uptime and the server adds the offset.
+ */
+static void dp_tsz_emit_cellular(const struct dp_tsz_series *series,
+                                 const uint8_t *block, size_t len)
+{
+    if (cellular_state_get() != CELLULAR_STATE_RUNNING) {
+        LOG_WRN("Cellular interface not ready. %u datapoints not sent",
+                series->enc.count);
+        return;
+    }
+
+    struct cellular_uplink_buf buf;
+    int err = cellular_uplink_claim(&buf, CONFIG_CELLULAR_UPLINK_BUFFER_SIZE,
+                                    CELLULAR_PRIORITY_TELEMETRY);
+    if (err != 0) {
+        LOG_ERR("Failed to claim uplink buffer: %d", err);
+        return;
+    }
+
+    buf.tag = "data";
+
+    int hdr_len = coap_template_build(&data_template, buf.data, buf.size,
+                                      true);
+    if (hdr_len < 0) {
+        LOG_ERR("Failed to build CoAP header: %d", hdr_len);
+        cellular_uplink_abort(&buf);
+        return;
+    }
+
+    int64_t offset_ms;
+    if (datapoint_clock_offset(&offset_ms) != 0) {
+        LOG_ERR("Failed to get timestamp.");
+    }
+
+    ZCBOR_STATE_E(zs, 1, buf.data + hdr_len, buf.size - hdr_len, 1);
+    bool ok = zcbor_map_start_encode(zs, 5) &&
+              zcbor_tstr_put_lit(zs, "i") &&
+              zcbor_uint32_put(zs, DATAPOINT_IMEI_TAIL) &&
+              zcbor_tstr_put_lit(zs, "o") &&
+              zcbor_int64_put(zs, offset_ms) &&
+              zcbor_tstr_put_lit(zs, "d") &&
+              zcbor_uint32_put(zs, series->sensor_id) &&
+              zcbor_tstr_put_lit(zs, "y") &&
+              zcbor_uint32_put(zs, series->type) &&
+              zcbor_tstr_put_lit(zs, "b") &&
+              zcbor_bstr_encode_ptr(zs, block, len) &&
+              zcbor_map_end_encode(zs, 5);
+    if (!ok) {
+        LOG_ERR("Block encode fail: %d", zcbor_peek_error(zs));
+        cellular_uplink_abort(&buf);
+        return;
+    }
+
+    size_t req_size = zs->payload - buf.data;
+    LOG_INF("Sending block of %u datapoints (%zu B): sensor %u",
+            series->enc.count, req_size, series->sensor_id);
+
+    err = cellular_uplink_commit(&buf, req_size);
+    if (err != 0) {
+        LOG_ERR("Failed to send datapoints: %d", err);
+    }
+}
+#else
 static void dp_sink_cellular(struct datapoint *dp)
 {
     if (cellular_state_get() != CELLULAR_STATE_RUNNING) {
@@ -29,51 +238,360 @@ static void dp_sink_cellular(struct datapoint *dp)
         return;
     }
 
-    uint8_t payload[100];
-    size_t payload_len = 0;
+    /* Encode the CoAP request directly into the uplink packet */
+    struct cellular_uplink_buf buf;
+    int err = cellular_uplink_claim(&buf, CONFIG_CELLULAR_UPLINK_BUFFER_SIZE,
+                                    CELLULAR_PRIORITY_TELEMETRY);
+    if (err != 0) {
+        LOG_ERR("Failed to claim uplink buffer: %d", err);
+        return;
+    }
 
-    int err = cbor_encode_datapoint(payload, sizeof(payload), dp, &payload_len);
+    buf.tag = "data";
+
+    int hdr_len = coap_template_build(&data_template, buf.data, buf.size,
+                                      true);
+    if (hdr_len < 0) {
+        LOG_ERR("Failed to build CoAP header: %d", hdr_len);
+        cellular_uplink_abort(&buf);
+        return;
+    }
+
+    size_t payload_len = 0;
+    err = cbor_encode_datapoint(buf.data + hdr_len, buf.size - hdr_len,
+                                dp, &payload_len);
     if (err != ZCBOR_SUCCESS) {
         LOG_ERR("CBOR encode fail: %d", err);
+        cellular_uplink_abort(&buf);
         return;
     }
 
-    uint8_t coap_buf[512] = {0};
-    int req_size = coap_build_request(coap_buf, sizeof(coap_buf),
-                                      COAP_TYPE_NON_CON,
-                                      COAP_METHOD_POST,
-                                      data_path,
-                                      payload, payload_len);
-    LOG_INF("Sending CoAP packet (%d B): %.*s", req_size,
-            (int)dp->s.len, dp->s.value);
+    size_t req_size = hdr_len + payload_len;
+    LOG_INF("Sending CoAP packet (%zu B): sensor %u", req_size, dp->d.d);
 
-    cellular_send_packet(coap_buf, req_size);
+    err = cellular_uplink_commit(&buf, req_size);
+    if (err != 0) {
+        LOG_ERR("Failed to send datapoint: %d", err);
+    }
 }
+#endif /* CONFIG_DATAPOINT_ENCODING_SENML */
+
+#ifdef CONFIG_DATAPOINT_SD_TSZ
+/* Compressed blocks awaiting the SD card, one per sensor */
+static struct dp_tsz_set sd_set;
+
+/* Marks the start of each block record in the log */
+#define SD_TSZ_MAGIC 0xd7
+
+/* Length of the header in front of each block */
+#define SD_TSZ_HEADER_LEN 13
+
+BUILD_ASSERT(CONFIG_DATAPOINT_TSZ_BLOCK_SIZE < SD_CARD_BUFFER_SIZE,
+             "Compressed blocks must fit an SD card log buffer");
+
+/**
+ * @brief Log a compressed block of one sensor's samples.
+ *
+ * Each record is a little-endian header {magic, sensor ID, value type,
+ * uptime to UTC offset in ms (int64), block length (uint16)} followed by
+ * the block.
+ */
+static void dp_tsz_emit_sd_card(const struct dp_tsz_series *series,
+                                const uint8_t *block, size_t len)
+{
+    uint8_t header[SD_TSZ_HEADER_LEN];
+    int64_t offset_ms;
+
+    if (datapoint_clock_offset(&offset_ms) != 0) {
+        LOG_ERR("Failed to get timestamp.");
+    }
 
+    header[0] = SD_TSZ_MAGIC;
+    header[1] = series->sensor_id;
+    header[2] = series->type;
+    sys_put_le64(offset_ms, &header[3]);
+    sys_put_le16(len, &header[11]);
+
+    if (sd_card_submit(header, sizeof(header), K_NO_WAIT) != 0) {
+        LOG_WRN("Dropped block of %u datapoints", series->enc.count);
+        return;
+    }
+
+    /* The buffer is only held for a copy, so waiting for it does not
+     * stall the sink, and the header is never left without its block */
+    int err = sd_card_submit(block, len, K_FOREVER);
+    if (err != 0) {
+        LOG_ERR("Failed to log block: %d", err);
+    }
+}
+#elif defined(CONFIG_DATAPOINT_SD_CSV)
 static void dp_sink_sd_card(struct datapoint *dp) {
     char line_buf[256] = {0};
-    size_t line_len = datapoint_to_csv(dp, line_buf, sizeof(line_buf));
-    sd_card_submit_line(line_buf, line_len, K_NO_WAIT);
+    char name[DATAPOINT_SUMMARY_NAME_MAX_LEN + 1];
+    struct datapoint row;
+
+    /* Windowed summaries are logged as one line per statistic */
+    unsigned int rows = dp->c_present ? DATAPOINT_SUMMARY_ROWS : 1;
+
+    for (unsigned int r = 0; r < rows; r++) {
+        const struct datapoint *line = dp;
+
+        if (dp->c_present) {
+            datapoint_summary_row(dp, r, &row, name);
+            line = &row;
+        }
+
+        int line_len = datapoint_to_csv(line, line_buf, sizeof(line_buf));
+        if (line_len < 0) {
+            continue;
+        }
+
+        sd_card_submit_line(line_buf, line_len, K_NO_WAIT);
+    }
+}
+#endif /* CONFIG_DATAPOINT_SD_TSZ */
+
+#ifndef CONFIG_DATAPOINT_ENCODING_TSZ
+/**
+ * @brief Get the form of a datapoint that is sent over the uplink.
+ */
+static struct datapoint dp_uplink_view(const struct datapoint *dp)
+{
+    struct datapoint view = *dp;
+
+#ifdef CONFIG_DATAPOINT_SENSOR_DICTIONARY
+    /* The server looks the name and unit up in the sensor dictionary */
+    view.s_present = false;
+    view.u_present = false;
+#else
+    view.d_present = false;
+#endif /* CONFIG_DATAPOINT_SENSOR_DICTIONARY */
+
+    return view;
+}
+#endif /* CONFIG_DATAPOINT_ENCODING_TSZ */
+
+/**
+ * @brief Convert a datapoint's capture time from uptime to UTC seconds.
+ */
+static void dp_to_utc_s(struct datapoint *dp)
+{
+    int64_t offset_ms;
+    if (datapoint_clock_offset(&offset_ms) != 0) {
+        LOG_ERR("Failed to get timestamp.");
+    }
+    dp->t = (dp->t + offset_ms) / 1000; /* Convert to UTC seconds */
+}
+
+static int dp_cellular_init(void)
+{
+    int err = coap_template_init(&data_template, COAP_TYPE_NON_CON,
+                                 COAP_METHOD_POST,
+                                 sizeof(CONFIG_DATAPOINT_PATH_ALIAS) > 1 ?
+                                 data_path_alias : data_path);
+    if (err != 0) {
+        LOG_ERR("Failed to encode datapoint request template: %d", err);
+        return err;
+    }
+
+#ifdef CONFIG_DATAPOINT_SENSOR_DICTIONARY
+    err = datapoint_dictionary_init();
+    if (err != 0) {
+        LOG_ERR("Failed to encode sensor dictionary template: %d", err);
+        return err;
+    }
+#endif /* CONFIG_DATAPOINT_SENSOR_DICTIONARY */
+
+    return 0;
+}
+
+static void dp_cellular_write(const struct datapoint_sample *sample)
+{
+#ifdef CONFIG_DATAPOINT_ENCODING_SENML
+    /* The batch is converted to UTC when it is flushed */
+    struct datapoint uplink = dp_uplink_view(&sample->dp);
+    dp_sink_cellular_batch(&uplink);
+#elif defined(CONFIG_DATAPOINT_ENCODING_TSZ)
+    struct datapoint_record rec;
+    if (datapoint_compact(&sample->dp, sample->type, &rec) == 0) {
+        dp_tsz_append(&uplink_set, &rec, sample->dp.t, dp_tsz_emit_cellular);
+    }
+#else
+    struct datapoint uplink = dp_uplink_view(&sample->dp);
+    dp_to_utc_s(&uplink);
+    dp_sink_cellular(&uplink);
+#endif /* CONFIG_DATAPOINT_ENCODING_SENML */
+}
+
+static void dp_cellular_poll(void)
+{
+#ifdef CONFIG_DATAPOINT_SENSOR_DICTIONARY
+    datapoint_dictionary_update();
+#endif /* CONFIG_DATAPOINT_SENSOR_DICTIONARY */
+
+#ifdef CONFIG_DATAPOINT_ENCODING_SENML
+    if (batch_len > 0 && k_uptime_get() >= batch_deadline) {
+        dp_batch_flush();
+    }
+#elif defined(CONFIG_DATAPOINT_ENCODING_TSZ)
+    dp_tsz_poll(&uplink_set, dp_tsz_emit_cellular);
+#endif /* CONFIG_DATAPOINT_ENCODING_SENML */
+}
+
+static int64_t dp_cellular_deadline(void)
+{
+#ifdef CONFIG_DATAPOINT_ENCODING_SENML
+    return batch_len > 0 ? batch_deadline : INT64_MAX;
+#elif defined(CONFIG_DATAPOINT_ENCODING_TSZ)
+    return dp_tsz_deadline(&uplink_set);
+#else
+    return INT64_MAX;
+#endif /* CONFIG_DATAPOINT_ENCODING_SENML */
+}
+
+static const struct datapoint_sink_api cellular_sink_api = {
+    .init = dp_cellular_init,
+    .write = dp_cellular_write,
+    .poll = dp_cellular_poll,
+    .deadline = dp_cellular_deadline,
+};
+
+#define CELLULAR_SINK_STACKSIZE 2048
+#define CELLULAR_SINK_PRIORITY  7
+
+/* Older datapoints are dropped first, as fresh ones matter more remotely */
+DATAPOINT_SINK_DEFINE(cellular_sink, &cellular_sink_api,
+                      CONFIG_DATAPOINT_SINK_CELLULAR_QUEUE_LEN,
+                      DATAPOINT_SINK_DROP_OLDEST, CELLULAR_SINK_STACKSIZE,
+                      CELLULAR_SINK_PRIORITY);
+
+#ifdef CONFIG_SD_CARD_WRITER
+static void dp_sd_card_write(const struct datapoint_sample *sample)
+{
+#if defined(CONFIG_DATAPOINT_SD_TSZ)
+    struct datapoint_record rec;
+    if (datapoint_compact(&sample->dp, sample->type, &rec) == 0) {
+        dp_tsz_append(&sd_set, &rec, sample->dp.t, dp_tsz_emit_sd_card);
+    }
+#elif defined(CONFIG_DATAPOINT_SD_CBOR)
+    struct datapoint dp = sample->dp;
+    int64_t offset_ms = 0;
+    if (datapoint_clock_offset(&offset_ms) != 0) {
+        LOG_ERR("Failed to get timestamp.");
+    }
+
+    /* Logged in UTC milliseconds, to keep the capture time exact */
+    dp.t += offset_ms;
+    datapoint_sdlog_write(&dp);
+#else
+    struct datapoint dp = sample->dp;
+    dp_to_utc_s(&dp);
+    dp_sink_sd_card(&dp);
+#endif /* CONFIG_DATAPOINT_SD_TSZ */
+}
+
+#ifdef CONFIG_DATAPOINT_SD_TSZ
+static void dp_sd_card_poll(void)
+{
+    dp_tsz_poll(&sd_set, dp_tsz_emit_sd_card);
+}
+
+static int64_t dp_sd_card_deadline(void)
+{
+    return dp_tsz_deadline(&sd_set);
+}
+#endif /* CONFIG_DATAPOINT_SD_TSZ */
+
+static const struct datapoint_sink_api sd_card_sink_api = {
+    .write = dp_sd_card_write,
+#ifdef CONFIG_DATAPOINT_SD_TSZ
+    .poll = dp_sd_card_poll,
+    .deadline = dp_sd_card_deadline,
+#endif /* CONFIG_DATAPOINT_SD_TSZ */
+};
+
+#define SD_CARD_SINK_STACKSIZE 2048
+#define SD_CARD_SINK_PRIORITY  8
+
+/* A full queue means the card has stalled, and new datapoints are dropped
+ * so that what is logged stays contiguous */
+DATAPOINT_SINK_DEFINE(sd_card_sink, &sd_card_sink_api,
+                      CONFIG_DATAPOINT_SINK_SD_CARD_QUEUE_LEN,
+                      DATAPOINT_SINK_DROP_NEWEST, SD_CARD_SINK_STACKSIZE,
+                      SD_CARD_SINK_PRIORITY);
+#endif /* CONFIG_SD_CARD_WRITER */
+
+/**
+ * @brief Publish a datapoint or window summary to every sink.
+ *
+ * @param dp    Datapoint with dp->t in milliseconds of uptime.
+ * @param type  Value type of the queued record.
+ */
+static void dp_publish(const struct datapoint *dp,
+                       enum datapoint_value_type type)
+{
+    struct datapoint_sample sample = {
+        .dp = *dp,
+        .type = type,
+    };
+
+    /* Set IMEI tail */
+    sample.dp.i = DATAPOINT_IMEI_TAIL;
+
+    datapoint_sink_publish(&sample);
+}
+
+#ifdef CONFIG_DATAPOINT_AGGREGATE
+static void dp_publish_summary(struct datapoint *summary)
+{
+    dp_publish(summary, DATAPOINT_VALUE_FLOAT);
+}
+#endif /* CONFIG_DATAPOINT_AGGREGATE */
+
+/**
+ * @brief Time to wait for the next datapoint before anything is due.
+ */
+static k_timeout_t dp_wait_timeout(void)
+{
+    int64_t now = k_uptime_get();
+    int64_t deadline = now + DATAPOINT_POLL_MS;
+
+#ifdef CONFIG_DATAPOINT_AGGREGATE
+    deadline = MIN(deadline, datapoint_aggregate_deadline());
+#endif /* CONFIG_DATAPOINT_AGGREGATE */
+
+    return K_MSEC(MAX(deadline - now, 0));
 }
 
 int datapoint_thread(void)
 {
+    struct datapoint_record rec;
     struct datapoint dp;
 
     while (1) {
-        if (datapoint_dequeue(&dp, K_MSEC(1000)) == 0) {
-            /* Set IMEI tail */
-            dp.i = 267864;
-
-            /* Set timestamp */
-            if (date_time_now(&dp.t) != 0) {
-                LOG_ERR("Failed to get timestamp.");
+        if (datapoint_dequeue(&rec, dp_wait_timeout()) == 0) {
+            int err = datapoint_expand(&rec, &dp);
+            if (err != 0) {
+                LOG_ERR("Failed to expand datapoint record: %d", err);
+                continue;
             }
-            dp.t /= 1000; /* Convert to seconds */
 
-            dp_sink_cellular(&dp);
-            dp_sink_sd_card(&dp);
+            /* Capture time, in milliseconds of uptime */
+            dp.t = datapoint_tick_to_uptime_ms(rec.tick);
+
+#ifdef CONFIG_DATAPOINT_AGGREGATE
+            /* Aggregated datapoints are only sent as window summaries */
+            if (!datapoint_aggregate_add(&rec, dp.t, dp_publish_summary)) {
+                dp_publish(&dp, rec.type);
+            }
+#else
+            dp_publish(&dp, rec.type);
+#endif /* CONFIG_DATAPOINT_AGGREGATE */
         }
+
+#ifdef CONFIG_DATAPOINT_AGGREGATE
+        datapoint_aggregate_poll(dp_publish_summary);
+#endif /* CONFIG_DATAPOINT_AGGREGATE */
     }
 
 	return 0;
@@ -0,0 +1,163 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <math.h>
+
+#include <datapoint_aggregate.h>
+#include <datapoint_sensors.h>
+
+/*
+ * Windowed aggregation
+ *
+ * Sensors with a window keep running statistics instead of passing on each
+ * datapoint. The mean and variance are updated with Welford's algorithm, so
+ * each sensor takes constant memory however many samples a window holds, and
+ * one summary is emitted per window.
+ *
+ * Windows are only touched by the datapoint thread. Window lengths can be
+ * set from any thread and are read atomically.
+ */
+
+struct aggregate_window {
+    uint32_t count;
+    double mean;
+    /* Sum of squared differences from the mean */
+    double m2;
+    double min;
+    double max;
+    int64_t start_ms;
+    int64_t end_ms;
+};
+
+static struct aggregate_window windows[DATAPOINT_SENSOR_COUNT];
+static atomic_t window_s[DATAPOINT_SENSOR_COUNT];
+
+int datapoint_aggregate_set_window(unsigned int sensor_id, uint32_t length_s)
+{
+    if (sensor_id >= DATAPOINT_SENSOR_COUNT) {
+        return -EINVAL;
+    }
+
+    atomic_set(&window_s[sensor_id], length_s);
+
+    return 0;
+}
+
+static double record_value(const struct datapoint_record *rec)
+{
+    switch (rec->type) {
+    case DATAPOINT_VALUE_FLOAT:
+        return rec->value.f;
+    case DATAPOINT_VALUE_E7:
+        return rec->value.i / 1e7;
+    case DATAPOINT_VALUE_INT:
+    default:
+        return rec->value.i;
+    }
+}
+
+static void window_emit(unsigned int sensor_id, datapoint_aggregate_emit_t emit)
+{
+    struct aggregate_window *window = &windows[sensor_id];
+    struct datapoint_record rec = {
+        .sensor_id = sensor_id,
+        .type = DATAPOINT_VALUE_FLOAT,
+    };
+    struct datapoint summary;
+
+    if (window->count == 0 || datapoint_expand(&rec, &summary) != 0) {
+        window->count = 0;
+        return;
+    }
+
+    summary.t = window->start_ms;
+    summary.f.f = window->mean;
+    summary.c_present = true;
+    summary.c.c = window->count;
+    summary.lo_present = true;
+    summary.lo.lo = window->min;
+    summary.hi_present = true;
+    summary.hi.hi = window->max;
+    summary.sd_present = true;
+    summary.sd.sd = window->count > 1 ?
+                    sqrt(window->m2 / (window->count - 1)) : 0.0;
+
+    window->count = 0;
+    emit(&summary);
+}
+
+bool datapoint_aggregate_add(const struct datapoint_record *rec,
+                             int64_t uptime_ms,
+                             datapoint_aggregate_emit_t emit)
+{
+    if (rec->sensor_id >= DATAPOINT_SENSOR_COUNT) {
+        return false;
+    }
+
+    struct aggregate_window *window = &windows[rec->sensor_id];
+    uint32_t length_s = atomic_get(&window_s[rec->sensor_id]);
+
+    if (window->count > 0 &&
+        (length_s == 0 || uptime_ms >= window->end_ms)) {
+        window_emit(rec->sensor_id, emit);
+    }
+
+    if (length_s == 0) {
+        return false;
+    }
+
+    double x = record_value(rec);
+
+    if (window->count == 0) {
+        window->start_ms = uptime_ms;
+        window->end_ms = uptime_ms + (int64_t)length_s * MSEC_PER_SEC;
+        window->mean = 0.0;
+        window->m2 = 0.0;
+        window->min = x;
+        window->max = x;
+    }
+
+    window->count++;
+
+    double delta = x - window->mean;
+    window->mean += delta / window->count;
+    window->m2 += delta * (x - window->mean);
+    window->min = MIN(window->min, x);
+    window->max = MAX(window->max, x);
+
+    return true;
+}
+
+void datapoint_aggregate_poll(datapoint_aggregate_emit_t emit)
+{
+    int64_t now = k_uptime_get();
+
+    for (unsigned int i = 0; i < DATAPOINT_SENSOR_COUNT; i++) {
+        if (windows[i].count > 0 && now >= windows[i].end_ms) {
+            window_emit(i, emit);
+        }
+    }
+}
+
+int64_t datapoint_aggregate_deadline(void)
+{
+    int64_t deadline = INT64_MAX;
+
+    for (unsigned int i = 0; i < DATAPOINT_SENSOR_COUNT; i++) {
+        if (windows[i].count > 0) {
+            deadline = MIN(deadline, windows[i].end_ms);
+        }
+    }
+
+    return deadline;
+}
+
+static int datapoint_aggregate_init(void)
+{
+    for (unsigned int i = 0; i < DATAPOINT_SENSOR_COUNT; i++) {
+        atomic_set(&window_s[i], CONFIG_DATAPOINT_AGGREGATE_WINDOW_S);
+    }
+
+    return 0;
+}
+
+SYS_INIT(datapoint_aggregate_init, APPLICATION, 0);
@@ -0,0 +1,55 @@
+#ifndef _DATAPOINT_AGGREGATE_H_
+#define _DATAPOINT_AGGREGATE_H_
+
+#include <zephyr/kernel.h>
+#include <datapoint/czd_datapoint_types.h>
+
+#include <datapoint_queue.h>
+
+/* Callback type for window summaries. The summary is expanded like a
+ * datapoint, with the mean in f, the count, minimum, maximum and standard
+ * deviation in c, lo, hi and sd, and t set to the start of the window in
+ * milliseconds of uptime. */
+typedef void (*datapoint_aggregate_emit_t)(struct datapoint *summary);
+
+/**
+ * @brief Set the aggregation window of a sensor.
+ *
+ * Safe to call from any thread. An open window is summarised when the next
+ * datapoint arrives or the window ends, whichever is first.
+ *
+ * @param sensor_id  Sensor ID from the sensor registry.
+ * @param window_s   Window length in seconds, or 0 to pass every datapoint.
+ *
+ * @return 0 on success, or -EINVAL if the sensor ID is unknown.
+ */
+int datapoint_aggregate_set_window(unsigned int sensor_id, uint32_t window_s);
+
+/**
+ * @brief Add a datapoint to its sensor's window.
+ *
+ * @param rec        Dequeued record.
+ * @param uptime_ms  Capture time in milliseconds of uptime.
+ * @param emit       Called with the summary of a window that has ended.
+ *
+ * @return true if the datapoint was aggregated, or false if its sensor is
+ *         not aggregated and the datapoint should be passed on as is.
+ */
+bool datapoint_aggregate_add(const struct datapoint_record *rec,
+                             int64_t uptime_ms,
+                             datapoint_aggregate_emit_t emit);
+
+/**
+ * @brief Summarise every window that has ended.
+ */
+void datapoint_aggregate_poll(datapoint_aggregate_emit_t emit);
+
+/**
+ * @brief Get the uptime at which the next open window ends.
+ *
+ * @return Deadline in milliseconds of uptime, or INT64_MAX if no window is
+ *         open.
+ */
+int64_t datapoint_aggregate_deadline(void);
+
+#endif /* _DATAPOINT_AGGREGATE_H_ */
@@ -0,0 +1,47 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <lib/cellular.h>
+
+#include <datapoint_helpers.h>
+#include <datapoint_cellular_stats.h>
+
+LOG_MODULE_REGISTER(datapoint_cellular_stats, LOG_LEVEL_INF);
+
+static struct k_work_delayable cellular_stats_work;
+
+static void cellular_stats_work_handler(struct k_work *work)
+{
+    struct cellular_stats stats;
+    int err = 0;
+
+    cellular_stats_get(&stats);
+
+    err |= submit_int_datapoint(stats.last_hour.tx_bytes,
+                                DATAPOINT_SENSOR_CELL_TX_HOUR);
+    err |= submit_int_datapoint(stats.last_hour.rx_bytes,
+                                DATAPOINT_SENSOR_CELL_RX_HOUR);
+
+    if (stats.signal_valid) {
+        err |= submit_int_datapoint(stats.rsrp_dbm,
+                                    DATAPOINT_SENSOR_CELL_RSRP);
+        err |= submit_int_datapoint(stats.rsrq_db,
+                                    DATAPOINT_SENSOR_CELL_RSRQ);
+    }
+
+    if (err != 0) {
+        LOG_ERR("Failed to submit cellular statistics");
+    }
+
+    k_work_schedule(&cellular_stats_work,
+                    K_SECONDS(CONFIG_DATAPOINT_CELLULAR_STATS_INTERVAL));
+}
+
+int datapoint_cellular_stats_init(void)
+{
+    k_work_init_delayable(&cellular_stats_work, cellular_stats_work_handler);
+    k_work_schedule(&cellular_stats_work,
+                    K_SECONDS(CONFIG_DATAPOINT_CELLULAR_STATS_INTERVAL));
+
+    return 0;
+}
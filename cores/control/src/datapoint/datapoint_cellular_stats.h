@@ -0,0 +1,6 @@
+#ifndef DATAPOINT_CELLULAR_STATS_H_
+#define DATAPOINT_CELLULAR_STATS_H_
+
+int datapoint_cellular_stats_init(void);
+
+#endif /* DATAPOINT_CELLULAR_STATS_H_ */
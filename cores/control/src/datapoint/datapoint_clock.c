@@ -0,0 +1,67 @@
+#include <zephyr/kernel.h>
+#include <date_time.h>
+
+#include <datapoint_clock.h>
+
+/*
+ * Datapoint clock
+ *
+ * Datapoints are stamped with the uptime tick when they are captured, and
+ * only converted to UTC when they reach a sink. The conversion is a single
+ * offset from uptime to UTC, refreshed from date_time at most every
+ * CONFIG_DATAPOINT_CLOCK_REFRESH_S or whenever a GNSS fix provides the time.
+ */
+
+static struct k_spinlock clock_lock;
+static int64_t utc_offset_ms;
+static int64_t synced_at_ms;
+static bool synced;
+
+int64_t datapoint_tick_to_uptime_ms(uint32_t tick)
+{
+    int64_t now = k_uptime_ticks();
+
+    /* Unsigned subtraction gives the age across a wrap of the low bits */
+    int64_t ticks = now - (uint32_t)((uint32_t)now - tick);
+
+    return k_ticks_to_ms_floor64(ticks);
+}
+
+void datapoint_clock_sync(int64_t utc_ms)
+{
+    int64_t uptime_ms = k_uptime_get();
+
+    K_SPINLOCK(&clock_lock) {
+        utc_offset_ms = utc_ms - uptime_ms;
+        synced_at_ms = uptime_ms;
+        synced = true;
+    }
+}
+
+int datapoint_clock_offset(int64_t *offset_ms)
+{
+    bool stale = false;
+
+    K_SPINLOCK(&clock_lock) {
+        stale = !synced || k_uptime_get() - synced_at_ms >=
+                           CONFIG_DATAPOINT_CLOCK_REFRESH_S * MSEC_PER_SEC;
+    }
+
+    if (stale) {
+        int64_t utc_ms;
+
+        if (date_time_now(&utc_ms) == 0) {
+            datapoint_clock_sync(utc_ms);
+        }
+    }
+
+    int err = 0;
+
+    K_SPINLOCK(&clock_lock) {
+        /* A stale offset is still better than none */
+        *offset_ms = utc_offset_ms;
+        err = synced ? 0 : -EAGAIN;
+    }
+
+    return err;
+}
@@ -0,0 +1,33 @@
+#ifndef _DATAPOINT_CLOCK_H_
+#define _DATAPOINT_CLOCK_H_
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Convert a capture tick to milliseconds of uptime.
+ *
+ * @param tick  Low 32 bits of k_uptime_ticks() at capture. The tick must
+ *              be less than one wrap of the 32-bit counter old.
+ */
+int64_t datapoint_tick_to_uptime_ms(uint32_t tick);
+
+/**
+ * @brief Set the wall clock from an external time source, such as a GNSS
+ *        fix, taken at the current uptime.
+ *
+ * @param utc_ms  Milliseconds since the Unix epoch.
+ */
+void datapoint_clock_sync(int64_t utc_ms);
+
+/**
+ * @brief Get the offset from uptime to UTC in milliseconds.
+ *
+ * The offset is refreshed from date_time when it is older than
+ * CONFIG_DATAPOINT_CLOCK_REFRESH_S, so callers may convert any number of
+ * uptimes for the cost of one call.
+ *
+ * @return 0 on success, or -EAGAIN if the wall clock has never been set.
+ */
+int datapoint_clock_offset(int64_t *offset_ms);
+
+#endif /* _DATAPOINT_CLOCK_H_ */
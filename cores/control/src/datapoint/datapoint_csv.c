@@ -0,0 +1,319 @@
+#include <zephyr/kernel.h>
+#include <string.h>
+#include <math.h>
+
+#include <datapoint_csv.h>
+
+/*
+ * CSV formatter
+ *
+ * Lines of the SD card log used to be built with one snprintf() call per
+ * column, which made formatting the most expensive step of logging. Columns
+ * are now converted directly: integers with 32-bit divisions wherever the
+ * value allows, and floats as a fixed point number of millionths.
+ *
+ * Floats are rounded exactly as "%.6f" rounds them, to the nearest
+ * millionth of the exact binary value with ties to even. The fraction of a
+ * double is m * 2^e for a 53-bit integer m, so its value in millionths is
+ * m * 15625 * 2^(e + 6), which is rounded with a 128-bit shift. Doubles of
+ * 2^64 and above are integers, and are converted with a short base 10^9
+ * bignum.
+ */
+
+/* Longest float below 2^64: sign, 20 digits, point and 6 digits */
+#define FIXED6_MAX_LEN (1 + 20 + 1 + 6)
+
+/* 2^1024 has 309 decimal digits */
+#define BIG_LIMBS DIV_ROUND_UP(309, 9)
+
+#define LIMB_BASE 1000000000U
+
+struct line {
+    char *p;
+    /* Characters that may still be written, leaving room for the NUL */
+    size_t room;
+};
+
+static bool put(struct line *line, const char *s, size_t len)
+{
+    if (len > line->room) {
+        line->room = 0;
+        return false;
+    }
+
+    memcpy(line->p, s, len);
+    line->p += len;
+    line->room -= len;
+
+    return true;
+}
+
+static bool put_char(struct line *line, char c)
+{
+    return put(line, &c, 1);
+}
+
+/**
+ * @brief Write the digits of v, at least width of them, ending at end.
+ *
+ * @return Start of the digits.
+ */
+static char *u32_digits(char *end, uint32_t v, int width)
+{
+    char *p = end;
+
+    do {
+        *--p = '0' + v % 10;
+        v /= 10;
+    } while (v != 0);
+
+    while (end - p < width) {
+        *--p = '0';
+    }
+
+    return p;
+}
+
+static size_t u64_to_str(char *buf, uint64_t v)
+{
+    char tmp[20];
+    char *end = tmp + sizeof(tmp);
+    char *p;
+
+    if (v <= UINT32_MAX) {
+        p = u32_digits(end, (uint32_t)v, 1);
+    } else {
+        /* One 64-bit division per 9 digits, the rest is 32-bit */
+        p = u32_digits(end, (uint32_t)(v % LIMB_BASE), 9);
+        v /= LIMB_BASE;
+
+        if (v <= UINT32_MAX) {
+            p = u32_digits(p, (uint32_t)v, 1);
+        } else {
+            p = u32_digits(p, (uint32_t)(v % LIMB_BASE), 9);
+            p = u32_digits(p, (uint32_t)(v / LIMB_BASE), 1);
+        }
+    }
+
+    size_t len = end - p;
+    memcpy(buf, p, len);
+
+    return len;
+}
+
+static bool put_i64(struct line *line, int64_t v)
+{
+    char buf[1 + 20];
+    size_t len = 0;
+    uint64_t mag = (uint64_t)v;
+
+    if (v < 0) {
+        buf[len++] = '-';
+        mag = 0 - mag;
+    }
+
+    len += u64_to_str(&buf[len], mag);
+
+    return put(line, buf, len);
+}
+
+/**
+ * @brief Round a fraction in [0, 1) to millionths, ties to even.
+ *
+ * @return Millionths, up to and including 1000000.
+ */
+static uint32_t frac_to_micro(double frac)
+{
+    if (frac == 0.0) {
+        return 0;
+    }
+
+    int exp;
+    uint64_t m = (uint64_t)ldexp(frexp(frac, &exp), 53);
+
+    /* frac * 10^6 = m * 15625 * 2^-s */
+    int s = 53 - exp - 6;
+
+    /* m * 15625 is below 2^67, so anything shifted further rounds to 0 */
+    if (s >= 68) {
+        return 0;
+    }
+
+    /* hi:lo = m * 15625 */
+    uint64_t a = (m >> 32) * 15625;
+    uint64_t b = (m & UINT32_MAX) * 15625;
+    uint64_t lo = (a << 32) + b;
+    uint64_t hi = (a >> 32) + (lo < b);
+
+    uint64_t n;
+    uint64_t rem_hi;
+    uint64_t rem_lo;
+    uint64_t half_hi;
+    uint64_t half_lo;
+
+    if (s >= 64) {
+        n = hi >> (s - 64);
+        rem_hi = hi & BIT64_MASK(s - 64);
+        rem_lo = lo;
+        half_hi = s > 64 ? BIT64(s - 65) : 0;
+        half_lo = s > 64 ? 0 : BIT64(63);
+    } else {
+        n = (lo >> s) | (hi << (64 - s));
+        rem_hi = 0;
+        rem_lo = lo & BIT64_MASK(s);
+        half_hi = 0;
+        half_lo = BIT64(s - 1);
+    }
+
+    if (rem_hi > half_hi || (rem_hi == half_hi && rem_lo > half_lo) ||
+        (rem_hi == half_hi && rem_lo == half_lo && (n & 1))) {
+        n++;
+    }
+
+    return (uint32_t)n;
+}
+
+/**
+ * @brief Format a finite double below 2^64 in magnitude as "%.6f".
+ */
+static size_t fixed6_to_str(char *buf, double v)
+{
+    double mag = fabs(v);
+    uint64_t ip = (uint64_t)mag;
+    uint32_t micro = frac_to_micro(mag - (double)ip);
+    size_t len = 0;
+
+    if (micro == 1000000) {
+        ip++;
+        micro = 0;
+    }
+
+    if (signbit(v)) {
+        buf[len++] = '-';
+    }
+
+    len += u64_to_str(&buf[len], ip);
+    buf[len++] = '.';
+    u32_digits(&buf[len + 6], micro, 6);
+
+    return len + 6;
+}
+
+/**
+ * @brief Format a double of 2^64 or more in magnitude as "%.6f".
+ *
+ * Such doubles are integers, m * 2^e with e of at least 11.
+ */
+static bool put_big(struct line *line, double v)
+{
+    uint32_t limbs[BIG_LIMBS];
+    size_t n = 0;
+    int exp;
+    uint64_t m = (uint64_t)ldexp(frexp(fabs(v), &exp), 53);
+    int e = exp - 53;
+
+    while (m > 0) {
+        limbs[n++] = m % LIMB_BASE;
+        m /= LIMB_BASE;
+    }
+
+    /* Multiply by 2^e, 32 bits at a time */
+    while (e > 0) {
+        int shift = MIN(e, 32);
+        uint64_t carry = 0;
+
+        for (size_t i = 0; i < n; i++) {
+            uint64_t x = ((uint64_t)limbs[i] << shift) + carry;
+            limbs[i] = x % LIMB_BASE;
+            carry = x / LIMB_BASE;
+        }
+
+        while (carry > 0) {
+            limbs[n++] = carry % LIMB_BASE;
+            carry /= LIMB_BASE;
+        }
+
+        e -= shift;
+    }
+
+    char digits[9];
+    char *end = digits + sizeof(digits);
+    char *p = u32_digits(end, limbs[n - 1], 1);
+
+    bool ok = (!signbit(v) || put_char(line, '-')) &&
+              put(line, p, end - p);
+
+    for (size_t i = n - 1; ok && i-- > 0;) {
+        u32_digits(end, limbs[i], 9);
+        ok = put(line, digits, sizeof(digits));
+    }
+
+    return ok && put(line, ".000000", 7);
+}
+
+static bool put_double(struct line *line, double v)
+{
+    if (isnan(v)) {
+        return signbit(v) ? put(line, "-nan", 4) : put(line, "nan", 3);
+    }
+
+    if (isinf(v)) {
+        return signbit(v) ? put(line, "-inf", 4) : put(line, "inf", 3);
+    }
+
+    if (fabs(v) >= 0x1p64) {
+        return put_big(line, v);
+    }
+
+    char buf[FIXED6_MAX_LEN];
+
+    return put(line, buf, fixed6_to_str(buf, v));
+}
+
+/**
+ * @brief Write a string as "%.*s" would, stopping at an embedded NUL.
+ */
+static bool put_tstr(struct line *line, const struct zcbor_string *s)
+{
+    if (s->len == 0 || s->value == NULL) {
+        return true;
+    }
+
+    return put(line, (const char *)s->value,
+               strnlen((const char *)s->value, s->len));
+}
+
+int datapoint_to_csv(const struct datapoint *dp, char *buf, size_t buf_size)
+{
+    if (!dp || !buf) {
+        return -EINVAL;
+    }
+
+    if (buf_size == 0) {
+        return -ENOMEM;
+    }
+
+    struct line line = {
+        .p = buf,
+        .room = buf_size - 1,
+    };
+
+    bool ok = put_i64(&line, dp->t) && put_char(&line, ',') &&
+              put_tstr(&line, &dp->s.s) && put_char(&line, ',') &&
+              (!dp->n_present || put_i64(&line, dp->n.n)) &&
+              put_char(&line, ',') &&
+              (!dp->f_present || put_double(&line, dp->f.f)) &&
+              put_char(&line, ',') &&
+              (!dp->r_present || put_tstr(&line, &dp->r.r)) &&
+              put_char(&line, ',') &&
+              (!dp->u_present || put_tstr(&line, &dp->u.u)) &&
+              put_char(&line, '\n');
+
+    if (!ok) {
+        return -ENOMEM;
+    }
+
+    *line.p = '\0';
+
+    return line.p - buf;
+}
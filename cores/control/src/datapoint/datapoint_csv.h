@@ -0,0 +1,26 @@
+#ifndef _DATAPOINT_CSV_H_
+#define _DATAPOINT_CSV_H_
+
+#include <zephyr/kernel.h>
+#include <datapoint/czd_datapoint_types.h>
+
+/**
+ * @brief Format a datapoint as a line of the SD card CSV log.
+ *
+ * The columns are the timestamp, sensor name, integer value, float value,
+ * string value and unit, each followed by a comma apart from the unit,
+ * which ends the line. Absent values are left empty. Each column is the
+ * same as an exactly rounding snprintf() gives for "%" PRId64, "%.*s", "%d"
+ * or "%.6f", but is converted without printf's floating point formatting,
+ * so the floating point printf support is not needed.
+ *
+ * @param dp        Datapoint to format.
+ * @param buf       Destination buffer, NUL terminated on success.
+ * @param buf_size  Size of the destination buffer.
+ *
+ * @return Length of the line, -EINVAL for invalid arguments, or -ENOMEM if
+ *         the line and its terminator do not fit.
+ */
+int datapoint_to_csv(const struct datapoint *dp, char *buf, size_t buf_size);
+
+#endif /* _DATAPOINT_CSV_H_ */
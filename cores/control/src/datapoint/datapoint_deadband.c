@@ -0,0 +1,139 @@
+#include <zephyr/kernel.h>
+#include <math.h>
+
+#include <datapoint_deadband.h>
+#include <datapoint_sensors.h>
+
+/*
+ * Deadband filter
+ *
+ * Slowly changing sensors are polled far more often than their values
+ * change. Values are compared with the last queued value of their sensor
+ * before they are queued, so that unchanged values take no queue space,
+ * airtime or SD card writes. A heartbeat value is still queued after
+ * max_silence_s, so that the server can tell a steady sensor from a silent
+ * one.
+ *
+ * Sensors may be submitted from several threads, so the settings and last
+ * values are held under a spinlock.
+ */
+
+#define DEADBAND(abs_, pct_) {                                \
+    .abs = (abs_),                                           \
+    .pct = (pct_),                                           \
+    .max_silence_s = CONFIG_DATAPOINT_DEADBAND_MAX_SILENCE_S, \
+}
+
+/* Defaults for channels that are polled faster than they change. All other
+ * sensors queue every value until a deadband is set. */
+static const struct datapoint_deadband default_deadbands[] = {
+    [DATAPOINT_SENSOR_SHT4X_TEMP] = DEADBAND(0.05f, 0.0f),
+    [DATAPOINT_SENSOR_SHT4X_HUM]  = DEADBAND(0.5f, 0.0f),
+    [DATAPOINT_SENSOR_ADC0_0]     = DEADBAND(0.0f, 1.0f),
+    [DATAPOINT_SENSOR_ADC0_1]     = DEADBAND(0.0f, 1.0f),
+    [DATAPOINT_SENSOR_ADC0_2]     = DEADBAND(0.0f, 1.0f),
+    [DATAPOINT_SENSOR_ADC0_3]     = DEADBAND(0.0f, 1.0f),
+    [DATAPOINT_SENSOR_ADC1_0]     = DEADBAND(0.0f, 1.0f),
+    [DATAPOINT_SENSOR_ADC1_1]     = DEADBAND(0.0f, 1.0f),
+    [DATAPOINT_SENSOR_ADC1_2]     = DEADBAND(0.0f, 1.0f),
+    [DATAPOINT_SENSOR_ADC1_3]     = DEADBAND(0.0f, 1.0f),
+};
+
+struct deadband_state {
+    struct datapoint_deadband config;
+    double last_value;
+    int64_t last_ms;
+    bool has_last;
+};
+
+static struct k_spinlock deadband_lock;
+static struct deadband_state states[DATAPOINT_SENSOR_COUNT];
+
+int datapoint_deadband_set(unsigned int sensor_id,
+                           const struct datapoint_deadband *deadband)
+{
+    if (sensor_id >= DATAPOINT_SENSOR_COUNT ||
+        !(deadband->abs >= 0.0f) || !(deadband->pct >= 0.0f)) {
+        return -EINVAL;
+    }
+
+    K_SPINLOCK(&deadband_lock) {
+        states[sensor_id].config = *deadband;
+        states[sensor_id].has_last = false;
+    }
+
+    return 0;
+}
+
+int datapoint_deadband_get(unsigned int sensor_id,
+                           struct datapoint_deadband *deadband)
+{
+    if (sensor_id >= DATAPOINT_SENSOR_COUNT) {
+        return -EINVAL;
+    }
+
+    K_SPINLOCK(&deadband_lock) {
+        *deadband = states[sensor_id].config;
+    }
+
+    return 0;
+}
+
+bool datapoint_deadband_pass(unsigned int sensor_id, double value)
+{
+    if (sensor_id >= DATAPOINT_SENSOR_COUNT) {
+        return true;
+    }
+
+    struct deadband_state *state = &states[sensor_id];
+    int64_t now = k_uptime_get();
+    bool pass = true;
+
+    K_SPINLOCK(&deadband_lock) {
+        const struct datapoint_deadband *config = &state->config;
+
+        if (!state->has_last ||
+            (config->abs == 0.0f && config->pct == 0.0f)) {
+            /* Nothing to compare with, or no deadband */
+        } else if (config->max_silence_s > 0 &&
+                   now - state->last_ms >=
+                   (int64_t)config->max_silence_s * MSEC_PER_SEC) {
+            /* Heartbeat */
+        } else {
+            double band = MAX((double)config->abs,
+                              config->pct / 100.0 * fabs(state->last_value));
+
+            pass = !(fabs(value - state->last_value) <= band);
+        }
+
+        if (pass) {
+            state->last_value = value;
+            state->last_ms = now;
+            state->has_last = true;
+        }
+    }
+
+    return pass;
+}
+
+void datapoint_deadband_reset(unsigned int sensor_id)
+{
+    if (sensor_id >= DATAPOINT_SENSOR_COUNT) {
+        return;
+    }
+
+    K_SPINLOCK(&deadband_lock) {
+        states[sensor_id].has_last = false;
+    }
+}
+
+static int datapoint_deadband_init(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(default_deadbands); i++) {
+        states[i].config = default_deadbands[i];
+    }
+
+    return 0;
+}
+
+SYS_INIT(datapoint_deadband_init, APPLICATION, 0);
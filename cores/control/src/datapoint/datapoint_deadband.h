@@ -0,0 +1,63 @@
+#ifndef _DATAPOINT_DEADBAND_H_
+#define _DATAPOINT_DEADBAND_H_
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Report-by-exception settings of a sensor.
+ *
+ * A value is only queued when it differs from the last queued value by more
+ * than the larger of abs and pct percent of the last value, or when nothing
+ * has been queued for max_silence_s. A deadband of zero in both abs and pct
+ * queues every value.
+ */
+struct datapoint_deadband {
+    /* Absolute deadband, in the sensor's unit */
+    float abs;
+    /* Deadband as a percentage of the last queued value */
+    float pct;
+    /* Longest time without a queued value, 0 for no heartbeat */
+    uint32_t max_silence_s;
+};
+
+/**
+ * @brief Set the deadband of a sensor.
+ *
+ * Safe to call from any thread. The next value of the sensor is always
+ * queued.
+ *
+ * @return 0 on success, or -EINVAL if the sensor ID is unknown or a
+ *         deadband is negative.
+ */
+int datapoint_deadband_set(unsigned int sensor_id,
+                           const struct datapoint_deadband *deadband);
+
+/**
+ * @brief Get the deadband of a sensor.
+ *
+ * @return 0 on success, or -EINVAL if the sensor ID is unknown.
+ */
+int datapoint_deadband_get(unsigned int sensor_id,
+                           struct datapoint_deadband *deadband);
+
+/**
+ * @brief Decide whether a value is to be queued.
+ *
+ * A value that passes becomes the reference for the next one.
+ *
+ * @param sensor_id  Sensor ID from the sensor registry.
+ * @param value      Value in the sensor's unit.
+ *
+ * @return true if the value is outside the deadband or a heartbeat is due.
+ */
+bool datapoint_deadband_pass(unsigned int sensor_id, double value);
+
+/**
+ * @brief Forget the last queued value of a sensor, so that its next value
+ *        passes.
+ *
+ * Used when a value passed the deadband but could not be queued.
+ */
+void datapoint_deadband_reset(unsigned int sensor_id);
+
+#endif /* _DATAPOINT_DEADBAND_H_ */
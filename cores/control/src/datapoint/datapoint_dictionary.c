@@ -0,0 +1,208 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/net/coap.h>
+#include <string.h>
+#include <zcbor_encode.h>
+
+#include <lib/cellular.h>
+#include <lib/coap.h>
+
+#include <datapoint_dictionary.h>
+#include <datapoint_sensors.h>
+
+LOG_MODULE_REGISTER(datapoint_dictionary, LOG_LEVEL_INF);
+
+/*
+ * Sensor dictionary
+ *
+ * Datapoints on the uplink only carry a sensor ID. The dictionary maps the
+ * IDs to names and units, and is posted to the sensors resource once per boot
+ * as one or more pages, each a CBOR map:
+ *
+ *   {"h": registry hash, "o": first sensor ID, "s": [[name, unit], ...]}
+ *
+ * Pages are sent one at a time. With CONFIG_COAP_CON each page is
+ * confirmable, and a page that is not acknowledged is sent again.
+ */
+
+enum dictionary_state {
+    DICTIONARY_IDLE,
+    DICTIONARY_IN_FLIGHT,
+    DICTIONARY_DELIVERED,
+};
+
+static const char * const sensors_path[] = {
+    "ccd99122-3904-454a-95c7-9fb71f2c3fde", "sensors", NULL
+};
+
+static struct coap_request_template sensors_template;
+static uint32_t registry_hash;
+
+static atomic_t state = ATOMIC_INIT(DICTIONARY_IDLE);
+/* First ID and number of entries of the page being sent */
+static size_t page_first;
+static size_t page_count;
+
+static bool encode_entries(zcbor_state_t *zs, size_t first, size_t count)
+{
+    bool ok = zcbor_tstr_put_lit(zs, "h") &&
+              zcbor_uint32_put(zs, registry_hash) &&
+              zcbor_tstr_put_lit(zs, "o") &&
+              zcbor_uint32_put(zs, first) &&
+              zcbor_tstr_put_lit(zs, "s") &&
+              zcbor_list_start_encode(zs, count);
+
+    for (size_t id = first; ok && id < first + count; id++) {
+        const struct datapoint_sensor_info *info = datapoint_sensor_info(id);
+
+        ok = zcbor_list_start_encode(zs, 2) &&
+             zcbor_tstr_encode_ptr(zs, info->name, strlen(info->name)) &&
+             zcbor_tstr_encode_ptr(zs, info->unit, strlen(info->unit)) &&
+             zcbor_list_end_encode(zs, 2);
+    }
+
+    return ok && zcbor_list_end_encode(zs, count);
+}
+
+/**
+ * @brief Encode as many entries from first onwards as fit in the buffer.
+ *
+ * @return Number of entries encoded, or -ENOMEM if none fit.
+ */
+static int encode_page(uint8_t *buf, size_t buf_len, size_t first,
+                       size_t *encoded_len)
+{
+    for (size_t n = DATAPOINT_SENSOR_COUNT - first; n > 0; n--) {
+        ZCBOR_STATE_E(zs, 3, buf, buf_len, 1);
+
+        if (zcbor_map_start_encode(zs, 3) &&
+            encode_entries(zs, first, n) &&
+            zcbor_map_end_encode(zs, 3)) {
+            *encoded_len = zs->payload - buf;
+            return n;
+        }
+    }
+
+    return -ENOMEM;
+}
+
+/**
+ * @brief Build the request for the page starting at page_first.
+ *
+ * @return Request length, or a negative errno code on failure.
+ */
+static int build_page(uint8_t *buf, size_t buf_len)
+{
+    int hdr_len = coap_template_build(&sensors_template, buf, buf_len, true);
+    if (hdr_len < 0) {
+        return hdr_len;
+    }
+
+    size_t payload_len;
+    int count = encode_page(buf + hdr_len, buf_len - hdr_len, page_first,
+                            &payload_len);
+    if (count < 0) {
+        return count;
+    }
+
+    page_count = count;
+
+    return hdr_len + payload_len;
+}
+
+/**
+ * @brief Move on to the next page once a page has been delivered.
+ */
+static void page_delivered(void)
+{
+    page_first += page_count;
+
+    if (page_first == DATAPOINT_SENSOR_COUNT) {
+        LOG_INF("Sensor dictionary %08x delivered", registry_hash);
+        atomic_set(&state, DICTIONARY_DELIVERED);
+    } else {
+        atomic_set(&state, DICTIONARY_IDLE);
+    }
+}
+
+#ifdef CONFIG_COAP_CON
+static void page_delivery_cb(uint16_t msg_id, enum coap_con_result result,
+                             void *user_data)
+{
+    if (result != COAP_CON_DELIVERED) {
+        LOG_WRN("Sensor dictionary page %zu not delivered: %d", page_first,
+                result);
+        atomic_set(&state, DICTIONARY_IDLE);
+        return;
+    }
+
+    page_delivered();
+}
+
+static int send_page(void)
+{
+    uint8_t buf[CONFIG_COAP_MAX_MSG_LEN];
+
+    int len = build_page(buf, sizeof(buf));
+    if (len < 0) {
+        return len;
+    }
+
+    return coap_con_send(buf, len, page_delivery_cb, NULL);
+}
+#else
+static int send_page(void)
+{
+    struct cellular_uplink_buf buf;
+    int err = cellular_uplink_claim(&buf, CONFIG_CELLULAR_UPLINK_BUFFER_SIZE,
+                                    CELLULAR_PRIORITY_TELEMETRY);
+    if (err != 0) {
+        return err;
+    }
+
+    buf.tag = "sensors";
+
+    int len = build_page(buf.data, buf.size);
+    if (len < 0) {
+        cellular_uplink_abort(&buf);
+        return len;
+    }
+
+    err = cellular_uplink_commit(&buf, len);
+    if (err != 0) {
+        return err;
+    }
+
+    /* Without confirmable messages, a page is as delivered as it gets */
+    page_delivered();
+
+    return 0;
+}
+#endif /* CONFIG_COAP_CON */
+
+void datapoint_dictionary_update(void)
+{
+    if (atomic_get(&state) != DICTIONARY_IDLE ||
+        cellular_state_get() != CELLULAR_STATE_RUNNING) {
+        return;
+    }
+
+    atomic_set(&state, DICTIONARY_IN_FLIGHT);
+
+    int err = send_page();
+    if (err != 0) {
+        LOG_ERR("Failed to send sensor dictionary page %zu: %d", page_first,
+                err);
+        atomic_set(&state, DICTIONARY_IDLE);
+    }
+}
+
+int datapoint_dictionary_init(void)
+{
+    registry_hash = datapoint_sensors_hash();
+
+    return coap_template_init(&sensors_template,
+                              IS_ENABLED(CONFIG_COAP_CON) ? COAP_TYPE_CON :
+                                                            COAP_TYPE_NON_CON,
+                              COAP_METHOD_POST, sensors_path);
+}
@@ -0,0 +1,22 @@
+#ifndef _DATAPOINT_DICTIONARY_H_
+#define _DATAPOINT_DICTIONARY_H_
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Prepare the sensor dictionary request.
+ *
+ * @return 0 on success, or a negative errno code on failure.
+ */
+int datapoint_dictionary_init(void);
+
+/**
+ * @brief Send the next page of the sensor dictionary if one is due.
+ *
+ * Called periodically from the cellular sink worker. Does nothing once the whole
+ * dictionary has been delivered, while a page is awaiting acknowledgement, or
+ * while the cellular link is down.
+ */
+void datapoint_dictionary_update(void);
+
+#endif /* _DATAPOINT_DICTIONARY_H_ */
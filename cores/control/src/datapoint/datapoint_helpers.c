@@ -1,16 +1,64 @@
 #include <zephyr/kernel.h>
 #include <zephyr/drivers/sensor.h>
 #include <string.h>
+#include <math.h>
 
 #include <datapoint_queue.h>
 #include <datapoint_helpers.h>
+#ifdef CONFIG_DATAPOINT_DEADBAND
+#include <datapoint_deadband.h>
+#endif
 #include <datapoint/czd_datapoint_types.h>
 
 
+/**
+ * @brief Queue a value for a sensor, recording the capture tick.
+ *
+ * Values within the sensor's deadband are dropped here, before they take
+ * any queue space, and reported as submitted.
+ */
+static int submit_record(enum datapoint_value_type type, int32_t i, float f,
+                         enum datapoint_sensor sensor)
+{
+    if (sensor >= DATAPOINT_SENSOR_COUNT) {
+        return -EINVAL;
+    }
+
+    struct datapoint_record rec = {
+        .sensor_id = sensor,
+        .type = type,
+        .tick = (uint32_t)k_uptime_ticks(),
+    };
+
+    if (type == DATAPOINT_VALUE_FLOAT) {
+        rec.value.f = f;
+    } else {
+        rec.value.i = i;
+    }
+
+#ifdef CONFIG_DATAPOINT_DEADBAND
+    double value = type == DATAPOINT_VALUE_FLOAT ? f :
+                   type == DATAPOINT_VALUE_E7 ? i / 1e7 : i;
+
+    if (!datapoint_deadband_pass(sensor, value)) {
+        return 0;
+    }
+
+    int err = datapoint_enqueue(&rec);
+    if (err != 0) {
+        /* Let the next value through in place of the lost one */
+        datapoint_deadband_reset(sensor);
+    }
+
+    return err;
+#else
+    return datapoint_enqueue(&rec);
+#endif /* CONFIG_DATAPOINT_DEADBAND */
+}
+
 int get_and_submit_sensor_datapoint(const struct device *dev,
                                     enum sensor_channel chan,
-                                    const char *label,
-                                    const char *unit)
+                                    enum datapoint_sensor sensor)
 {
     struct sensor_value val;
     int err = sensor_channel_get(dev, chan, &val);
@@ -18,119 +66,84 @@ int get_and_submit_sensor_datapoint(const struct device *dev,
         return 1;
     }
 
-    struct datapoint dp = {
-        .n_present = false,
-        .f_present = true,
-        .r_present = false,
-        .u_present = true,
-        .s = {.value = label, .len = strlen(label)},
-        .u.u = {.value = unit, .len = strlen(unit)},
-        .f.f = sensor_value_to_double(&val),
-    };
-
-    return datapoint_enqueue(&dp, K_NO_WAIT);
+    return submit_record(DATAPOINT_VALUE_FLOAT, 0,
+                         (float)sensor_value_to_double(&val), sensor);
 }
 
 int submit_float_datapoint(double value,
-                           const char *label,
-                           const char *unit)
+                           enum datapoint_sensor sensor)
 {
-    struct datapoint dp = {
-        .n_present = false,
-        .f_present = true,
-        .r_present = false,
-        .u_present = true,
-        .s = {.value = label, .len = strlen(label)},
-        .u.u = {.value = unit, .len = strlen(unit)},
-        .f.f = value,
-    };
-
-    return datapoint_enqueue(&dp,K_NO_WAIT);
+    return submit_record(DATAPOINT_VALUE_FLOAT, 0, (float)value, sensor);
 }
 
-int submit_int_datapoint(int32_t value,
-                         const char *label,
-                         const char *unit)
+int submit_e7_datapoint(double value,
+                        enum datapoint_sensor sensor)
 {
-    struct datapoint dp = {
-        .n_present = true,
-        .f_present = false,
-        .r_present = false,
-        .u_present = true,
-        .s = {.value = label, .len = strlen(label)},
-        .u.u = {.value = unit, .len = strlen(unit)},
-        .n.n = value,
-    };
+    if (value >= INT32_MAX / 1e7 || value <= INT32_MIN / 1e7) {
+        return -ERANGE;
+    }
 
-    return datapoint_enqueue(&dp,K_NO_WAIT);
+    return submit_record(DATAPOINT_VALUE_E7, (int32_t)llround(value * 1e7),
+                         0.0f, sensor);
 }
 
-int datapoint_to_csv(const struct datapoint *dp, char *buf, size_t buf_size)
+int submit_int_datapoint(int32_t value,
+                         enum datapoint_sensor sensor)
 {
-    if (!dp || !buf) {
-        return -EINVAL;
-    }
-
-    size_t offset = 0;
-    int ret;
+    return submit_record(DATAPOINT_VALUE_INT, value, 0.0f, sensor);
+}
 
-    /* 1. timestamp */
-    ret = snprintf(buf + offset, buf_size - offset, "%" PRId64 ",", dp->t);
-    if (ret < 0 || ret >= (int)(buf_size - offset)) {
-        return -ENOMEM;
-    }
-    offset += ret;
+int datapoint_summary_row(const struct datapoint *dp, unsigned int row,
+                          struct datapoint *out, char *name_buf)
+{
+    static const char * const suffixes[DATAPOINT_SUMMARY_ROWS] = {
+        NULL, "min", "max", "sd", "count",
+    };
 
-    /* 2. sensor name */
-    ret = snprintf(buf + offset, buf_size - offset, "%.*s,", (int)dp->s.len, dp->s.value);
-    if (ret < 0 || ret >= (int)(buf_size - offset)) {
-        return -ENOMEM;
+    if (!dp->c_present || row >= DATAPOINT_SUMMARY_ROWS) {
+        return -EINVAL;
     }
-    offset += ret;
 
-    /* 3. int value (if present) */
-    if (dp->n_present) {
-        ret = snprintf(buf + offset, buf_size - offset, "%d,", dp->n.n);
-    } else {
-        ret = snprintf(buf + offset, buf_size - offset, ",");
-    }
-    if (ret < 0 || ret >= (int)(buf_size - offset)) {
-        return -ENOMEM;
-    }
-    offset += ret;
+    *out = *dp;
+    out->c_present = false;
+    out->lo_present = false;
+    out->hi_present = false;
+    out->sd_present = false;
 
-    /* 4. float value (if present) */
-    if (dp->f_present) {
-        ret = snprintf(buf + offset, buf_size - offset, "%.6f,", dp->f.f);
-    } else {
-        ret = snprintf(buf + offset, buf_size - offset, ",");
-    }
-    if (ret < 0 || ret >= (int)(buf_size - offset)) {
-        return -ENOMEM;
+    if (row == 0) {
+        return 0;
     }
-    offset += ret;
 
-    /* 5. string value (if present) */
-    if (dp->r_present) {
-        ret = snprintf(buf + offset, buf_size - offset, "%.*s,", (int)dp->r.r.len, dp->r.r.value);
+    int len;
+    if (dp->s_present) {
+        len = snprintk(name_buf, DATAPOINT_SUMMARY_NAME_MAX_LEN + 1, "%.*s/%s",
+                       (int)dp->s.s.len, dp->s.s.value, suffixes[row]);
     } else {
-        ret = snprintf(buf + offset, buf_size - offset, ",");
-    }
-    if (ret < 0 || ret >= (int)(buf_size - offset)) {
-        return -ENOMEM;
+        len = snprintk(name_buf, DATAPOINT_SUMMARY_NAME_MAX_LEN + 1, "%u/%s",
+                       dp->d.d, suffixes[row]);
     }
-    offset += ret;
 
-    /* 6. unit string (if present) */
-    if (dp->u_present) {
-        ret = snprintf(buf + offset, buf_size - offset, "%.*s\n", (int)dp->u.u.len, dp->u.u.value);
-    } else {
-        ret = snprintf(buf + offset, buf_size - offset, "\n");
-    }
-    if (ret < 0 || ret >= (int)(buf_size - offset)) {
-        return -ENOMEM;
+    out->s_present = true;
+    out->s.s.value = name_buf;
+    out->s.s.len = MIN(len, DATAPOINT_SUMMARY_NAME_MAX_LEN);
+
+    switch (row) {
+    case 1:
+        out->f.f = dp->lo.lo;
+        break;
+    case 2:
+        out->f.f = dp->hi.hi;
+        break;
+    case 3:
+        out->f.f = dp->sd.sd;
+        break;
+    default:
+        out->f_present = false;
+        out->n_present = true;
+        out->n.n = dp->c.c;
+        out->u_present = false;
+        break;
     }
-    offset += ret;
 
-    return offset;
+    return 0;
 }
@@ -5,20 +5,48 @@
 #include <zephyr/drivers/sensor.h>
 
 #include <datapoint/czd_datapoint_types.h>
+#include <datapoint_sensors.h>
 
 int get_and_submit_sensor_datapoint(const struct device *dev,
                                     enum sensor_channel chan,
-                                    const char *label,
-                                    const char *unit);
+                                    enum datapoint_sensor sensor);
 
 int submit_float_datapoint(double value,
-                           const char *label,
-                           const char *unit);
+                           enum datapoint_sensor sensor);
+
+/* Submit a value with 1e-7 resolution, such as a coordinate in degrees,
+ * without the precision loss of a single precision float */
+int submit_e7_datapoint(double value,
+                        enum datapoint_sensor sensor);
 
 int submit_int_datapoint(int value,
-                         const char *label,
-                         const char *unit);
+                         enum datapoint_sensor sensor);
+
+/* A windowed summary, with c, lo, hi and sd present, is written as rows for
+ * the mean, minimum, maximum, standard deviation and count */
+#define DATAPOINT_SUMMARY_ROWS 5
+
+/* Longest row name: a sensor name, or ID, and "/count" */
+#define DATAPOINT_SUMMARY_NAME_MAX_LEN (32 + 6)
 
-int datapoint_to_csv(const struct datapoint *dp, char *buf, size_t buf_size);
+/**
+ * @brief Get one row of a windowed summary as a plain datapoint.
+ *
+ * Row 0 is the mean under the sensor's own name. The other rows are named
+ * "<name>/min", "<name>/max", "<name>/sd" and "<name>/count", where the name
+ * is the sensor ID in decimal if the summary has no sensor name. The count
+ * has no unit.
+ *
+ * @param dp        Summary datapoint.
+ * @param row       Row index, below DATAPOINT_SUMMARY_ROWS.
+ * @param out       Set to the row.
+ * @param name_buf  Holds the row name, at least
+ *                  DATAPOINT_SUMMARY_NAME_MAX_LEN + 1 bytes.
+ *
+ * @return 0 on success, or -EINVAL if dp is not a summary or row is out of
+ *         range.
+ */
+int datapoint_summary_row(const struct datapoint *dp, unsigned int row,
+                          struct datapoint *out, char *name_buf);
 
 #endif /* DATAPOINT_HELPERS_H_ */
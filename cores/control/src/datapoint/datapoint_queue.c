@@ -1,22 +1,446 @@
 #include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <string.h>
+#include <math.h>
 
 #include <datapoint_queue.h>
+#include <datapoint_sensors.h>
 #include <datapoint/czd_datapoint_types.h>
 
-#define DATAPOINT_QUEUE_ALIGNMENT 4
-#define DATAPOINT_QUEUE_MAX_ITEMS 10
+/*
+ * Datapoint queue
+ *
+ * Records are passed from any number of producers to the datapoint thread
+ * through a bounded lock-free ring (Vyukov's bounded MPMC queue, used here
+ * with a single consumer). Each cell carries a sequence number: a producer
+ * claims the cell at enqueue_pos with a CAS once the cell's sequence equals
+ * that position, writes the record and publishes it by advancing the
+ * sequence. The consumer takes the cell at dequeue_pos once its sequence is
+ * one past the position, and frees it for the next lap of the ring.
+ *
+ * records_sem counts published records so the consumer can block.
+ *
+ * When the ring is full, the record is handled according to
+ * CONFIG_DATAPOINT_QUEUE_OVERFLOW. Dropping the oldest record makes the
+ * producer a second consumer for one record, so dequeue_pos is claimed with
+ * a CAS as in the full MPMC queue. Dropped records are counted against
+ * their sensor.
+ *
+ * Records only carry the sensor ID, and are expanded with the name and unit
+ * from the sensor registry when they are dequeued.
+ */
 
-K_MSGQ_DEFINE(datapoint_queue,
-              sizeof(struct datapoint),
-              DATAPOINT_QUEUE_MAX_ITEMS,
-              DATAPOINT_QUEUE_ALIGNMENT);
+struct datapoint_cell {
+    atomic_t seq;
+    struct datapoint_record rec;
+} __aligned(16);
 
-int datapoint_enqueue(struct datapoint *dp, k_timeout_t timeout)
+BUILD_ASSERT(IS_POWER_OF_TWO(sizeof(struct datapoint_cell)),
+             "Ring cells must tile the ring size");
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_DATAPOINT_QUEUE_SIZE),
+             "The ring size must be a power of two");
+
+#define RING_CELLS (CONFIG_DATAPOINT_QUEUE_SIZE / sizeof(struct datapoint_cell))
+#define RING_MASK  (RING_CELLS - 1)
+
+BUILD_ASSERT(RING_CELLS >= 2, "The ring must hold at least two records");
+
+/* Downsampled sensors keep one in 2^shift records, up to one in 2^MAX */
+#define DOWNSAMPLE_MAX_SHIFT 4
+
+static struct datapoint_cell ring[RING_CELLS];
+static atomic_t enqueue_pos;
+static atomic_t dequeue_pos;
+
+K_SEM_DEFINE(records_sem, 0, RING_CELLS);
+
+/* Records lost per sensor, and the most records ever queued at once */
+static atomic_t dropped[DATAPOINT_SENSOR_COUNT];
+static atomic_t high_water;
+
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE
+static atomic_t downsample_shift[DATAPOINT_SENSOR_COUNT];
+static atomic_t downsample_count[DATAPOINT_SENSOR_COUNT];
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE */
+
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_BLOCK
+/* Given by the consumer while producers are waiting for space */
+K_SEM_DEFINE(space_sem, 0, 1);
+static atomic_t space_waiters;
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_BLOCK */
+
+static uint32_t ring_used(void)
+{
+    return (uint32_t)atomic_get(&enqueue_pos) -
+           (uint32_t)atomic_get(&dequeue_pos);
+}
+
+/**
+ * @brief Write a record to the ring.
+ *
+ * @return 0 on success, or -ENOMSG if the ring is full.
+ */
+static int ring_put(const struct datapoint_record *rec)
 {
-    return k_msgq_put(&datapoint_queue, dp, timeout);
+    struct datapoint_cell *cell;
+    uint32_t pos = atomic_get(&enqueue_pos);
+
+    while (true) {
+        cell = &ring[pos & RING_MASK];
+        int32_t dif = (int32_t)((uint32_t)atomic_get(&cell->seq) - pos);
+
+        if (dif == 0) {
+            if (atomic_cas(&enqueue_pos, pos, pos + 1)) {
+                break;
+            }
+            pos = atomic_get(&enqueue_pos);
+        } else if (dif < 0) {
+            /* The consumer has not freed this cell yet */
+            return -ENOMSG;
+        } else {
+            /* Another producer claimed the cell first */
+            pos = atomic_get(&enqueue_pos);
+        }
+    }
+
+    cell->rec = *rec;
+    atomic_set(&cell->seq, pos + 1);
+
+    k_sem_give(&records_sem);
+
+    /* Track the high-water mark against concurrent producers */
+    uint32_t used = ring_used();
+    atomic_val_t mark = atomic_get(&high_water);
+    while ((uint32_t)mark < used && !atomic_cas(&high_water, mark, used)) {
+        mark = atomic_get(&high_water);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Take the oldest record from the ring, for a caller holding one
+ *        count of records_sem.
+ *
+ * @param wait  Wait for a producer that has claimed the oldest cell to
+ *              finish writing it. Without waiting, the call fails instead.
+ *
+ * @return 0 on success, or -EAGAIN if the oldest record is still being
+ *         written and wait is false.
+ */
+static int ring_take(struct datapoint_record *rec, bool wait)
+{
+    struct datapoint_cell *cell;
+    uint32_t pos = atomic_get(&dequeue_pos);
+
+    while (true) {
+        cell = &ring[pos & RING_MASK];
+        int32_t dif = (int32_t)((uint32_t)atomic_get(&cell->seq) - (pos + 1));
+
+        if (dif == 0) {
+            if (atomic_cas(&dequeue_pos, pos, pos + 1)) {
+                break;
+            }
+        } else if (dif < 0) {
+            /* A producer that claimed this cell before the one that gave
+             * the semaphore has not finished writing it */
+            if (!wait) {
+                return -EAGAIN;
+            }
+            k_sleep(K_TICKS(1));
+        }
+        pos = atomic_get(&dequeue_pos);
+    }
+
+    *rec = cell->rec;
+    atomic_set(&cell->seq, pos + RING_CELLS);
+
+    return 0;
 }
 
-int datapoint_dequeue(struct datapoint *dp, k_timeout_t timeout)
+static void count_drop(unsigned int sensor_id)
 {
-    return k_msgq_get(&datapoint_queue, dp, timeout);
+    if (sensor_id < DATAPOINT_SENSOR_COUNT) {
+        atomic_inc(&dropped[sensor_id]);
+    }
 }
+
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_DROP_OLDEST
+/**
+ * @brief Make room by dropping the oldest record, then queue rec.
+ */
+static int put_drop_oldest(const struct datapoint_record *rec)
+{
+    struct datapoint_record oldest;
+
+    if (k_sem_take(&records_sem, K_NO_WAIT) != 0) {
+        /* The consumer is taking the remaining records */
+        return ring_put(rec);
+    }
+
+    if (ring_take(&oldest, false) != 0) {
+        k_sem_give(&records_sem);
+        return -ENOMSG;
+    }
+
+    count_drop(oldest.sensor_id);
+
+    return ring_put(rec);
+}
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_DROP_OLDEST */
+
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE
+/**
+ * @brief Decide whether a record of a downsampled sensor is skipped.
+ */
+static bool downsample_skip(unsigned int sensor_id)
+{
+    uint32_t shift = atomic_get(&downsample_shift[sensor_id]);
+
+    if (shift == 0) {
+        return false;
+    }
+
+    uint32_t n = atomic_inc(&downsample_count[sensor_id]);
+
+    return (n & BIT_MASK(shift)) != 0;
+}
+
+/**
+ * @brief Halve the rate of the sensor whose record did not fit.
+ */
+static void downsample_more(unsigned int sensor_id)
+{
+    atomic_val_t shift = atomic_get(&downsample_shift[sensor_id]);
+
+    if (shift < DOWNSAMPLE_MAX_SHIFT) {
+        atomic_cas(&downsample_shift[sensor_id], shift, shift + 1);
+    }
+}
+
+/**
+ * @brief Double the rate of a downsampled sensor again once the queue has
+ *        drained.
+ */
+static void downsample_less(unsigned int sensor_id)
+{
+    atomic_val_t shift = atomic_get(&downsample_shift[sensor_id]);
+
+    if (shift > 0 && ring_used() < RING_CELLS / 4) {
+        atomic_cas(&downsample_shift[sensor_id], shift, shift - 1);
+    }
+}
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE */
+
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_BLOCK
+/**
+ * @brief Wait up to the block timeout for room to queue rec.
+ */
+static int put_blocking(const struct datapoint_record *rec)
+{
+    k_timepoint_t end =
+        sys_timepoint_calc(K_MSEC(CONFIG_DATAPOINT_QUEUE_BLOCK_TIMEOUT_MS));
+    int err;
+
+    atomic_inc(&space_waiters);
+
+    do {
+        err = ring_put(rec);
+    } while (err != 0 &&
+             k_sem_take(&space_sem, sys_timepoint_timeout(end)) == 0);
+
+    atomic_dec(&space_waiters);
+
+    return err;
+}
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_BLOCK */
+
+int datapoint_enqueue(const struct datapoint_record *rec)
+{
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE
+    if (rec->sensor_id < DATAPOINT_SENSOR_COUNT &&
+        downsample_skip(rec->sensor_id)) {
+        count_drop(rec->sensor_id);
+        return 0;
+    }
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE */
+
+    int err = ring_put(rec);
+
+    if (err == 0) {
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE
+        if (rec->sensor_id < DATAPOINT_SENSOR_COUNT) {
+            downsample_less(rec->sensor_id);
+        }
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE */
+        return 0;
+    }
+
+#if defined(CONFIG_DATAPOINT_QUEUE_OVERFLOW_DROP_OLDEST)
+    err = put_drop_oldest(rec);
+    if (err == 0) {
+        return 0;
+    }
+#elif defined(CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE)
+    if (rec->sensor_id < DATAPOINT_SENSOR_COUNT) {
+        downsample_more(rec->sensor_id);
+    }
+#elif defined(CONFIG_DATAPOINT_QUEUE_OVERFLOW_BLOCK)
+    /* ISRs cannot wait, and drop the record instead */
+    if (!k_is_in_isr()) {
+        err = put_blocking(rec);
+        if (err == 0) {
+            return 0;
+        }
+    }
+#endif
+
+    count_drop(rec->sensor_id);
+
+    return err;
+}
+
+int datapoint_dequeue(struct datapoint_record *rec, k_timeout_t timeout)
+{
+    if (k_sem_take(&records_sem, timeout) != 0) {
+        return -EAGAIN;
+    }
+
+    ring_take(rec, true);
+
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_BLOCK
+    if (atomic_get(&space_waiters) > 0) {
+        k_sem_give(&space_sem);
+    }
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_BLOCK */
+
+    return 0;
+}
+
+void datapoint_queue_stats_get(struct datapoint_queue_stats *stats)
+{
+    *stats = (struct datapoint_queue_stats) {
+        .capacity = RING_CELLS,
+        .used = ring_used(),
+        .high_water = atomic_get(&high_water),
+    };
+
+    for (size_t i = 0; i < DATAPOINT_SENSOR_COUNT; i++) {
+        stats->dropped += atomic_get(&dropped[i]);
+    }
+}
+
+int datapoint_queue_sensor_stats_get(unsigned int sensor_id,
+                                     struct datapoint_queue_sensor_stats *stats)
+{
+    if (sensor_id >= DATAPOINT_SENSOR_COUNT) {
+        return -EINVAL;
+    }
+
+    *stats = (struct datapoint_queue_sensor_stats) {
+        .dropped = atomic_get(&dropped[sensor_id]),
+#ifdef CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE
+        .downsample_shift = atomic_get(&downsample_shift[sensor_id]),
+#endif /* CONFIG_DATAPOINT_QUEUE_OVERFLOW_DOWNSAMPLE */
+    };
+
+    return 0;
+}
+
+void datapoint_queue_stats_reset(void)
+{
+    for (size_t i = 0; i < DATAPOINT_SENSOR_COUNT; i++) {
+        atomic_clear(&dropped[i]);
+    }
+
+    atomic_set(&high_water, ring_used());
+}
+
+int datapoint_expand(const struct datapoint_record *rec,
+                     struct datapoint *dp)
+{
+    const struct datapoint_sensor_info *sensor =
+        datapoint_sensor_info(rec->sensor_id);
+    if (sensor == NULL) {
+        return -ENOENT;
+    }
+
+    *dp = (struct datapoint) {
+        .d_present = true,
+        .d.d = rec->sensor_id,
+        .s_present = true,
+        .s.s = {.value = sensor->name, .len = strlen(sensor->name)},
+        .u_present = true,
+        .u.u = {.value = sensor->unit, .len = strlen(sensor->unit)},
+    };
+
+    switch (rec->type) {
+    case DATAPOINT_VALUE_INT:
+        dp->n_present = true;
+        dp->n.n = rec->value.i;
+        break;
+    case DATAPOINT_VALUE_FLOAT:
+        dp->f_present = true;
+        dp->f.f = rec->value.f;
+        break;
+    case DATAPOINT_VALUE_E7:
+        dp->f_present = true;
+        dp->f.f = rec->value.i / 1e7;
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+int datapoint_compact(const struct datapoint *dp,
+                      enum datapoint_value_type type,
+                      struct datapoint_record *rec)
+{
+    if (!dp->d_present) {
+        return -EINVAL;
+    }
+
+    *rec = (struct datapoint_record) {
+        .sensor_id = dp->d.d,
+        .type = type,
+    };
+
+    switch (type) {
+    case DATAPOINT_VALUE_INT:
+        if (!dp->n_present) {
+            return -EINVAL;
+        }
+        rec->value.i = dp->n.n;
+        break;
+    case DATAPOINT_VALUE_FLOAT:
+        if (!dp->f_present) {
+            return -EINVAL;
+        }
+        rec->value.f = dp->f.f;
+        break;
+    case DATAPOINT_VALUE_E7:
+        if (!dp->f_present) {
+            return -EINVAL;
+        }
+        /* Exact, as the expanded value is the fixed point value / 1e7 */
+        rec->value.i = (int32_t)llround(dp->f.f * 1e7);
+        break;
+    default:
+        return -EINVAL;
+    }
+
+    return 0;
+}
+
+static int datapoint_queue_init(void)
+{
+    for (uint32_t i = 0; i < RING_CELLS; i++) {
+        atomic_set(&ring[i].seq, i);
+    }
+
+    return 0;
+}
+
+SYS_INIT(datapoint_queue_init, APPLICATION, 0);
@@ -4,8 +4,114 @@
 #include <zephyr/kernel.h>
 #include <datapoint/czd_datapoint_types.h>
 
-int datapoint_enqueue(struct datapoint *dp, k_timeout_t timeout);
+enum datapoint_value_type {
+    DATAPOINT_VALUE_INT,
+    DATAPOINT_VALUE_FLOAT,
+    /* Fixed point in units of 1e-7, e.g. GNSS coordinates in degrees */
+    DATAPOINT_VALUE_E7,
+};
 
-int datapoint_dequeue(struct datapoint *dp, k_timeout_t timeout);
+/**
+ * @brief Compact form of a datapoint while it is queued.
+ *
+ * Name and unit are held in the sensor registry (datapoint_sensors.h) and
+ * only looked up when the record is expanded to a struct datapoint.
+ */
+struct datapoint_record {
+    uint8_t sensor_id;
+    uint8_t type;
+    union {
+        int32_t i;
+        float f;
+    } value;
+    /* Low 32 bits of k_uptime_ticks() at capture */
+    uint32_t tick;
+};
+
+struct datapoint_queue_stats {
+    /* Number of records the queue holds */
+    uint32_t capacity;
+    /* Records queued now */
+    uint32_t used;
+    /* Most records ever queued at once */
+    uint32_t high_water;
+    /* Records dropped over all sensors */
+    uint32_t dropped;
+};
+
+struct datapoint_queue_sensor_stats {
+    /* Records of the sensor that were dropped, or skipped while it was
+     * downsampled */
+    uint32_t dropped;
+    /* The sensor keeps one in 2^downsample_shift records */
+    uint32_t downsample_shift;
+};
+
+/**
+ * @brief Queue a record.
+ *
+ * Safe to call from any thread or ISR. When the queue is full, the record
+ * is handled according to CONFIG_DATAPOINT_QUEUE_OVERFLOW. Only the
+ * blocking policy waits, and never in an ISR.
+ *
+ * @return 0 on success or if the record was skipped by downsampling, or
+ *         -ENOMSG if the record was dropped.
+ */
+int datapoint_enqueue(const struct datapoint_record *rec);
+
+/**
+ * @brief Take the oldest record from the queue.
+ *
+ * Only the datapoint thread may dequeue.
+ *
+ * @return 0 on success, or -EAGAIN if no record arrived within timeout.
+ */
+int datapoint_dequeue(struct datapoint_record *rec, k_timeout_t timeout);
+
+/**
+ * @brief Get the queue occupancy and drop counts.
+ */
+void datapoint_queue_stats_get(struct datapoint_queue_stats *stats);
+
+/**
+ * @brief Get the drop count and downsampling of one sensor.
+ *
+ * @return 0 on success, or -EINVAL if the sensor ID is unknown.
+ */
+int datapoint_queue_sensor_stats_get(unsigned int sensor_id,
+                                     struct datapoint_queue_sensor_stats *stats);
+
+/**
+ * @brief Clear the drop counts and restart the high-water mark from the
+ *        current occupancy.
+ */
+void datapoint_queue_stats_reset(void);
+
+/**
+ * @brief Expand a record to a full datapoint.
+ *
+ * The sensor ID, name and unit are all set. The timestamp and IMEI tail are
+ * left for the caller to set.
+ *
+ * @return 0 on success, or -ENOENT if the sensor ID is unknown.
+ */
+int datapoint_expand(const struct datapoint_record *rec,
+                     struct datapoint *dp);
+
+/**
+ * @brief Get the record a datapoint was expanded from.
+ *
+ * The capture tick is not kept in a datapoint, and is left at zero.
+ *
+ * @param dp    Datapoint with its sensor ID and a value.
+ * @param type  Value type of the original record.
+ * @param rec   Set to the record.
+ *
+ * @return 0 on success, or -EINVAL if dp has no sensor ID or no value of
+ *         the given type.
+ */
+int datapoint_compact(const struct datapoint *dp,
+                      enum datapoint_value_type type,
+                      struct datapoint_record *rec);
 
 #endif /* _DATAPOINT_QUEUE_H_ */
@@ -0,0 +1,97 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include <zcbor_common.h>
+
+#include <datapoint/czd_datapoint_decode.h>
+#include <datapoint/czd_datapoint_encode.h>
+
+#include <datapoint_sdlog.h>
+#include <datapoint_sensors.h>
+#include <sd_card.h>
+
+LOG_MODULE_REGISTER(datapoint_sdlog, LOG_LEVEL_INF);
+
+struct sdlog_reader {
+    int64_t start_ms;
+    int64_t end_ms;
+    datapoint_sdlog_cb_t cb;
+    void *user_data;
+    int count;
+};
+
+int datapoint_sdlog_write(const struct datapoint *dp)
+{
+    uint8_t record[SD_CARD_RECORD_MAX_LEN];
+    struct datapoint logged = *dp;
+    size_t len = 0;
+
+    /* Name and unit are restored from the sensor registry when read */
+    if (logged.d_present) {
+        logged.s_present = false;
+        logged.u_present = false;
+    }
+
+    int err = cbor_encode_datapoint(record, sizeof(record), &logged, &len);
+    if (err != ZCBOR_SUCCESS) {
+        LOG_ERR("CBOR encode fail: %d", err);
+        return -ENOMEM;
+    }
+
+    return sd_card_submit_record(record, len, logged.t, K_NO_WAIT);
+}
+
+static int sdlog_read_record(const uint8_t *data, size_t len,
+                             void *user_data)
+{
+    struct sdlog_reader *reader = user_data;
+    struct datapoint dp;
+    size_t decoded_len;
+
+    /* Data that only looks like a record, such as part of one cut short by
+     * a reset, is passed over */
+    if (cbor_decode_datapoint(data, len, &dp, &decoded_len) != ZCBOR_SUCCESS ||
+        decoded_len != len) {
+        return -EBADMSG;
+    }
+
+    if (dp.t < reader->start_ms || dp.t > reader->end_ms) {
+        return 0;
+    }
+
+    const struct datapoint_sensor_info *info =
+        dp.d_present ? datapoint_sensor_info(dp.d.d) : NULL;
+
+    if (info != NULL && !dp.s_present) {
+        dp.s_present = true;
+        dp.s.s.value = (const uint8_t *)info->name;
+        dp.s.s.len = strlen(info->name);
+        dp.u_present = true;
+        dp.u.u.value = (const uint8_t *)info->unit;
+        dp.u.u.len = strlen(info->unit);
+    }
+
+    reader->count++;
+
+    return reader->cb(&dp, reader->user_data);
+}
+
+int datapoint_sdlog_read(int64_t start_ms, int64_t end_ms,
+                         datapoint_sdlog_cb_t cb, void *user_data)
+{
+    struct sdlog_reader reader = {
+        .start_ms = start_ms,
+        .end_ms = end_ms,
+        .cb = cb,
+        .user_data = user_data,
+    };
+
+    if (cb == NULL) {
+        return -EINVAL;
+    }
+
+    int ret = sd_card_read_records(start_ms, end_ms, sdlog_read_record,
+                                   &reader);
+
+    return ret < 0 ? ret : reader.count;
+}
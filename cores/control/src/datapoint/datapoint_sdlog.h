@@ -0,0 +1,52 @@
+#ifndef _DATAPOINT_SDLOG_H_
+#define _DATAPOINT_SDLOG_H_
+
+#include <zephyr/kernel.h>
+#include <datapoint/czd_datapoint_types.h>
+
+/*
+ * Binary SD card log
+ *
+ * Each datapoint is logged as a CZD datapoint map, framed and time indexed
+ * by the SD card writer (sd_card_submit_record()). Records carry the time
+ * in milliseconds since the Unix epoch and the sensor ID, but not the
+ * sensor name or unit, which are looked up in the sensor registry when
+ * the log is read back.
+ */
+
+/* Called for each datapoint read back. Return 0 to carry on reading, or
+ * anything else to stop. */
+typedef int (*datapoint_sdlog_cb_t)(const struct datapoint *dp,
+                                    void *user_data);
+
+/**
+ * @brief Log a datapoint to the SD card.
+ *
+ * Only the SD card sink may write to the log.
+ *
+ * @param dp  Datapoint with dp->t in milliseconds since the Unix epoch.
+ *
+ * @return 0 on success, -ENOMEM if the datapoint could not be encoded, or
+ *         the error from sd_card_submit_record().
+ */
+int datapoint_sdlog_write(const struct datapoint *dp);
+
+/**
+ * @brief Read back the logged datapoints within a time range.
+ *
+ * Datapoints are passed to the callback in the order they were logged,
+ * with the sensor name and unit set from the sensor registry. Datapoints
+ * still buffered in RAM are not read.
+ *
+ * @param start_ms   Start of the range, in ms since the Unix epoch.
+ * @param end_ms     End of the range, inclusive.
+ * @param cb         Called for each datapoint.
+ * @param user_data  Passed to the callback.
+ *
+ * @return Number of datapoints passed to the callback, or a negative error
+ *         code if the log could not be read.
+ */
+int datapoint_sdlog_read(int64_t start_ms, int64_t end_ms,
+                         datapoint_sdlog_cb_t cb, void *user_data);
+
+#endif /* _DATAPOINT_SDLOG_H_ */
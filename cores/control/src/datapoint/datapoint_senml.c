@@ -0,0 +1,248 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <string.h>
+#include <zcbor_encode.h>
+
+#include <datapoint_helpers.h>
+#include <datapoint_senml.h>
+
+/* SenML CBOR labels, RFC 8428 section 6 */
+#define SENML_LABEL_BN -2
+#define SENML_LABEL_BT -3
+#define SENML_LABEL_BU -4
+#define SENML_LABEL_N   0
+#define SENML_LABEL_U   1
+#define SENML_LABEL_V   2
+#define SENML_LABEL_VS  3
+#define SENML_LABEL_T   6
+
+/* "<imei tail>:<sensor name>" */
+#define BASE_NAME_MAX_LEN (10 + 1 + 32 + 1)
+
+/* Relative times below this many milliseconds come back to the millisecond
+ * from a single precision float, whose step is under half a millisecond
+ * below 8192 s */
+#define FLOAT32_EXACT_MS 8000000
+
+struct senml_base {
+    char name[BASE_NAME_MAX_LEN];
+    size_t name_len;
+    bool shared_name;
+    bool shared_unit;
+    int64_t time_s;
+};
+
+/* Sensor IDs as decimal strings, up to "255" */
+#define SENSOR_ID_MAX_LEN 3
+
+static bool tstr_equal(const struct zcbor_string *a,
+                       const struct zcbor_string *b)
+{
+    return a->len == b->len && memcmp(a->value, b->value, a->len) == 0;
+}
+
+/**
+ * @brief Get the SenML name of a datapoint.
+ *
+ * Datapoints without a sensor name are named by their sensor ID, which the
+ * server resolves through the sensor dictionary.
+ */
+static struct zcbor_string record_name(const struct datapoint *dp,
+                                       char id_buf[SENSOR_ID_MAX_LEN + 1])
+{
+    if (dp->s_present || !dp->d_present) {
+        return dp->s.s;
+    }
+
+    int len = snprintk(id_buf, SENSOR_ID_MAX_LEN + 1, "%u", dp->d.d);
+
+    return (struct zcbor_string) {
+        .value = id_buf,
+        .len = MIN(len, SENSOR_ID_MAX_LEN),
+    };
+}
+
+/**
+ * @brief Work out what the first count datapoints have in common.
+ */
+static void senml_base_init(struct senml_base *base,
+                            const struct datapoint *dps, size_t count)
+{
+    char first_id[SENSOR_ID_MAX_LEN + 1];
+    char id[SENSOR_ID_MAX_LEN + 1];
+    struct zcbor_string first_name = record_name(&dps[0], first_id);
+
+    /* Summary rows are named and unitless apart from the mean */
+    base->shared_name = !dps[0].c_present;
+    base->shared_unit = dps[0].u_present && !dps[0].c_present;
+
+    for (size_t i = 1; i < count; i++) {
+        struct zcbor_string name = record_name(&dps[i], id);
+
+        base->shared_name &= !dps[i].c_present &&
+                             tstr_equal(&name, &first_name);
+        base->shared_unit &= dps[i].u_present && !dps[i].c_present &&
+                             tstr_equal(&dps[i].u.u, &dps[0].u.u);
+    }
+
+    int len = snprintk(base->name, sizeof(base->name), "%u:%.*s", dps[0].i,
+                       base->shared_name ? (int)first_name.len : 0,
+                       first_name.value);
+    base->name_len = MIN(len, sizeof(base->name) - 1);
+
+    base->time_s = dps[0].t / MSEC_PER_SEC;
+}
+
+static bool encode_value(zcbor_state_t *state, const struct datapoint *dp)
+{
+    if (dp->n_present) {
+        return zcbor_int32_put(state, SENML_LABEL_V) &&
+               zcbor_int32_put(state, dp->n.n);
+    }
+
+    if (dp->f_present) {
+        /* Most sensor readings survive the narrowing, saving 4 bytes */
+        float narrow = (float)dp->f.f;
+
+        return zcbor_int32_put(state, SENML_LABEL_V) &&
+               ((double)narrow == dp->f.f ?
+                zcbor_float32_put(state, narrow) :
+                zcbor_float64_put(state, dp->f.f));
+    }
+
+    return zcbor_int32_put(state, SENML_LABEL_VS) &&
+           zcbor_tstr_encode_ptr(state, dp->r.r.value, dp->r.r.len);
+}
+
+/**
+ * @brief Encode a time relative to the base time, in seconds.
+ */
+static bool encode_time(zcbor_state_t *state, int64_t relative_ms)
+{
+    if (relative_ms % MSEC_PER_SEC == 0) {
+        return zcbor_int64_put(state, relative_ms / MSEC_PER_SEC);
+    }
+
+    if (relative_ms > -FLOAT32_EXACT_MS && relative_ms < FLOAT32_EXACT_MS) {
+        return zcbor_float32_put(state, relative_ms / 1000.0f);
+    }
+
+    return zcbor_float64_put(state, relative_ms / 1000.0);
+}
+
+static bool encode_record(zcbor_state_t *state, const struct datapoint *dp,
+                          const struct senml_base *base, bool first)
+{
+    int64_t relative_ms = dp->t - base->time_s * MSEC_PER_SEC;
+    bool has_value = dp->n_present || dp->f_present || dp->r_present;
+    bool has_unit = !base->shared_unit && dp->u_present;
+
+    size_t entries = (first ? 2 + base->shared_unit : 0) +
+                     !base->shared_name + has_unit + has_value +
+                     (relative_ms != 0);
+
+    bool ok = zcbor_map_start_encode(state, entries);
+
+    if (first) {
+        ok = ok && zcbor_int32_put(state, SENML_LABEL_BN) &&
+             zcbor_tstr_encode_ptr(state, base->name, base->name_len) &&
+             zcbor_int32_put(state, SENML_LABEL_BT) &&
+             zcbor_int64_put(state, base->time_s);
+
+        if (base->shared_unit) {
+            ok = ok && zcbor_int32_put(state, SENML_LABEL_BU) &&
+                 zcbor_tstr_encode_ptr(state, dp->u.u.value, dp->u.u.len);
+        }
+    }
+
+    if (!base->shared_name) {
+        char id[SENSOR_ID_MAX_LEN + 1];
+        struct zcbor_string name = record_name(dp, id);
+
+        ok = ok && zcbor_int32_put(state, SENML_LABEL_N) &&
+             zcbor_tstr_encode_ptr(state, name.value, name.len);
+    }
+
+    if (has_unit) {
+        ok = ok && zcbor_int32_put(state, SENML_LABEL_U) &&
+             zcbor_tstr_encode_ptr(state, dp->u.u.value, dp->u.u.len);
+    }
+
+    if (has_value) {
+        ok = ok && encode_value(state, dp);
+    }
+
+    if (relative_ms != 0) {
+        ok = ok && zcbor_int32_put(state, SENML_LABEL_T) &&
+             encode_time(state, relative_ms);
+    }
+
+    return ok && zcbor_map_end_encode(state, entries);
+}
+
+/**
+ * @brief Number of SenML records a datapoint is encoded as.
+ */
+static size_t record_rows(const struct datapoint *dp)
+{
+    return dp->c_present ? DATAPOINT_SUMMARY_ROWS : 1;
+}
+
+/**
+ * @brief Encode a datapoint, with a windowed summary as one record per
+ *        statistic.
+ */
+static bool encode_datapoint(zcbor_state_t *state, const struct datapoint *dp,
+                             const struct senml_base *base, bool first)
+{
+    if (!dp->c_present) {
+        return encode_record(state, dp, base, first);
+    }
+
+    for (unsigned int r = 0; r < DATAPOINT_SUMMARY_ROWS; r++) {
+        char name[DATAPOINT_SUMMARY_NAME_MAX_LEN + 1];
+        struct datapoint row;
+
+        if (datapoint_summary_row(dp, r, &row, name) != 0 ||
+            !encode_record(state, &row, base, first && r == 0)) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+int datapoint_senml_encode(const struct datapoint *dps, size_t count,
+                           uint8_t *buf, size_t buf_len,
+                           size_t *encoded_len)
+{
+    if (dps == NULL || count == 0 || buf == NULL || encoded_len == NULL) {
+        return -EINVAL;
+    }
+
+    /* Drop records from the end until the pack fits. The base is worked
+     * out again each time, as fewer records may share more. */
+    for (size_t n = count; n > 0; n--) {
+        struct senml_base base;
+        senml_base_init(&base, dps, n);
+
+        size_t records = 0;
+        for (size_t i = 0; i < n; i++) {
+            records += record_rows(&dps[i]);
+        }
+
+        ZCBOR_STATE_E(state, 2, buf, buf_len, 1);
+
+        bool ok = zcbor_list_start_encode(state, records);
+        for (size_t i = 0; ok && i < n; i++) {
+            ok = encode_datapoint(state, &dps[i], &base, i == 0);
+        }
+
+        if (ok && zcbor_list_end_encode(state, records)) {
+            *encoded_len = state->payload - buf;
+            return n;
+        }
+    }
+
+    return -ENOMEM;
+}
@@ -0,0 +1,37 @@
+#ifndef _DATAPOINT_SENML_H_
+#define _DATAPOINT_SENML_H_
+
+#include <zephyr/kernel.h>
+#include <datapoint/czd_datapoint_types.h>
+
+/**
+ * @brief Encode datapoints as a SenML-CBOR (RFC 8428) pack.
+ *
+ * The first record carries the base name, built from the IMEI tail and the
+ * sensor name when all datapoints share one, the base time and, when all
+ * datapoints share one, the base unit. Datapoints without a sensor name are
+ * named by their sensor ID in decimal. Each record then only carries what
+ * differs from the base. Windowed summaries are encoded as one record per
+ * statistic, see datapoint_summary_row().
+ *
+ * If the pack does not fit in the buffer, the last datapoint is dropped and
+ * the pack is encoded again, as fewer datapoints may share more base values.
+ * Fitting a pack may then take up to count encodings, so count is kept
+ * small, see CONFIG_DATAPOINT_SENML_BATCH_MAX. The datapoints dropped are
+ * left for the next pack.
+ *
+ * @param dps          Datapoints to encode. dp->t is the capture time in
+ *                     milliseconds since the Unix epoch.
+ * @param count        Number of datapoints.
+ * @param buf          Destination buffer.
+ * @param buf_len      Length of the destination buffer.
+ * @param encoded_len  Set to the number of bytes written.
+ *
+ * @return Number of datapoints encoded, -EINVAL for invalid arguments, or
+ *         -ENOMEM if not even one datapoint fits.
+ */
+int datapoint_senml_encode(const struct datapoint *dps, size_t count,
+                           uint8_t *buf, size_t buf_len,
+                           size_t *encoded_len);
+
+#endif /* _DATAPOINT_SENML_H_ */
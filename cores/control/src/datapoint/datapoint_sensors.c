@@ -0,0 +1,45 @@
+#include <zephyr/kernel.h>
+
+#include <datapoint_sensors.h>
+
+#define DATAPOINT_SENSOR_INFO(id, sensor_name, sensor_unit) \
+    [DATAPOINT_SENSOR_##id] = {.name = sensor_name, .unit = sensor_unit},
+
+static const struct datapoint_sensor_info sensors[] = {
+    DATAPOINT_SENSOR_LIST(DATAPOINT_SENSOR_INFO)
+};
+
+const struct datapoint_sensor_info *datapoint_sensor_info(unsigned int id)
+{
+    if (id >= ARRAY_SIZE(sensors)) {
+        return NULL;
+    }
+
+    return &sensors[id];
+}
+
+/* 32-bit FNV-1a, including the terminating NUL so that names and units
+ * cannot run into each other */
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME        16777619U
+
+static uint32_t fnv1a(uint32_t hash, const char *str)
+{
+    do {
+        hash = (hash ^ (uint8_t)*str) * FNV_PRIME;
+    } while (*str++ != '\0');
+
+    return hash;
+}
+
+uint32_t datapoint_sensors_hash(void)
+{
+    uint32_t hash = FNV_OFFSET_BASIS;
+
+    for (size_t i = 0; i < ARRAY_SIZE(sensors); i++) {
+        hash = fnv1a(hash, sensors[i].name);
+        hash = fnv1a(hash, sensors[i].unit);
+    }
+
+    return hash;
+}
@@ -0,0 +1,76 @@
+#ifndef _DATAPOINT_SENSORS_H_
+#define _DATAPOINT_SENSORS_H_
+
+#include <zephyr/kernel.h>
+
+/*
+ * Sensor registry
+ *
+ * Every datapoint channel is listed here with its name and unit, and is
+ * identified by its position in the list. Datapoints only carry the ID, and
+ * the name and unit are sent to the server once in the sensor dictionary.
+ *
+ * IDs must stay stable between firmware versions, so new channels are only
+ * ever added to the end of the list, and channels are not removed.
+ */
+#define DATAPOINT_SENSOR_LIST(X)                          \
+    X(LSM6DSO_ACCEL_X,   "lsm6dso_accel_x",   "m/s^2")    \
+    X(LSM6DSO_ACCEL_Y,   "lsm6dso_accel_y",   "m/s^2")    \
+    X(LSM6DSO_ACCEL_Z,   "lsm6dso_accel_z",   "m/s^2")    \
+    X(LSM6DSO_GYRO_X,    "lsm6dso_gyro_x",    "rad/s")    \
+    X(LSM6DSO_GYRO_Y,    "lsm6dso_gyro_y",    "rad/s")    \
+    X(LSM6DSO_GYRO_Z,    "lsm6dso_gyro_z",    "rad/s")    \
+    X(LIS3MDL_MAG_X,     "lis3mdl_mag_x",     "G")        \
+    X(LIS3MDL_MAG_Y,     "lis3mdl_mag_y",     "G")        \
+    X(LIS3MDL_MAG_Z,     "lis3mdl_mag_z",     "G")        \
+    X(SHT4X_TEMP,        "sht4x_temp",        "deg C")    \
+    X(SHT4X_HUM,         "sht4x_hum",         "%")        \
+    X(GNSS_LAT,          "gnss_lat",          "deg")      \
+    X(GNSS_LONG,         "gnss_long",         "deg")      \
+    X(GNSS_ACCURACY,     "gnss_accuracy",     "m")        \
+    X(GNSS_ALT,          "gnss_alt",          "m")        \
+    X(GNSS_ALT_ACCURACY, "gnss_alt_accuracy", "m")        \
+    X(ADC0_0,            "adc0_0",            "mV")       \
+    X(ADC0_1,            "adc0_1",            "mV")       \
+    X(ADC0_2,            "adc0_2",            "mV")       \
+    X(ADC0_3,            "adc0_3",            "mV")       \
+    X(ADC1_0,            "adc1_0",            "mV")       \
+    X(ADC1_1,            "adc1_1",            "mV")       \
+    X(ADC1_2,            "adc1_2",            "mV")       \
+    X(ADC1_3,            "adc1_3",            "mV")       \
+    X(CELL_TX_HOUR,      "cell_tx_hour",      "B")        \
+    X(CELL_RX_HOUR,      "cell_rx_hour",      "B")        \
+    X(CELL_RSRP,         "cell_rsrp",         "dBm")      \
+    X(CELL_RSRQ,         "cell_rsrq",         "dB")
+
+#define DATAPOINT_SENSOR_ENUM(id, name, unit) DATAPOINT_SENSOR_##id,
+
+enum datapoint_sensor {
+    DATAPOINT_SENSOR_LIST(DATAPOINT_SENSOR_ENUM)
+    DATAPOINT_SENSOR_COUNT
+};
+
+BUILD_ASSERT(DATAPOINT_SENSOR_COUNT <= UINT8_MAX + 1,
+             "Sensor IDs must fit in one byte");
+
+struct datapoint_sensor_info {
+    const char *name;
+    const char *unit;
+};
+
+/**
+ * @brief Look up the name and unit of a sensor.
+ *
+ * @return Sensor information, or NULL if the ID is unknown.
+ */
+const struct datapoint_sensor_info *datapoint_sensor_info(unsigned int id);
+
+/**
+ * @brief Hash of every sensor ID, name and unit in the registry.
+ *
+ * Sent with the sensor dictionary so that the server can tell whether the
+ * dictionary it holds for a device is current.
+ */
+uint32_t datapoint_sensors_hash(void);
+
+#endif /* _DATAPOINT_SENSORS_H_ */
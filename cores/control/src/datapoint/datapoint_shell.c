@@ -0,0 +1,184 @@
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <stdlib.h>
+
+#include <datapoint_queue.h>
+#include <datapoint_sensors.h>
+#include <datapoint_sink.h>
+#ifdef CONFIG_DATAPOINT_DEADBAND
+#include <datapoint_deadband.h>
+#endif
+#ifdef CONFIG_DATAPOINT_SD_CBOR
+#include <datapoint_csv.h>
+#include <datapoint_helpers.h>
+#include <datapoint_sdlog.h>
+#endif
+
+static int cmd_datapoint_queue(const struct shell *sh, size_t argc,
+                               char **argv)
+{
+    struct datapoint_queue_stats stats;
+    struct datapoint_queue_sensor_stats sensor;
+
+    datapoint_queue_stats_get(&stats);
+
+    shell_print(sh, "Queue: %u / %u used, high-water %u, %u dropped",
+                stats.used, stats.capacity, stats.high_water, stats.dropped);
+
+    for (unsigned int id = 0; id < DATAPOINT_SENSOR_COUNT; id++) {
+        if (datapoint_queue_sensor_stats_get(id, &sensor) != 0 ||
+            (sensor.dropped == 0 && sensor.downsample_shift == 0)) {
+            continue;
+        }
+
+        shell_print(sh, "  %-18s %8u dropped, keeping 1 in %u",
+                    datapoint_sensor_info(id)->name, sensor.dropped,
+                    1U << sensor.downsample_shift);
+    }
+
+    return 0;
+}
+
+static int cmd_datapoint_queue_reset(const struct shell *sh, size_t argc,
+                                     char **argv)
+{
+    datapoint_queue_stats_reset();
+    shell_print(sh, "Datapoint queue statistics cleared");
+
+    return 0;
+}
+
+static int cmd_datapoint_sinks(const struct shell *sh, size_t argc,
+                               char **argv)
+{
+    struct datapoint_sink_stats stats;
+
+    shell_print(sh, "  %-14s %10s %10s %12s", "sink", "written", "dropped",
+                "high-water");
+
+    for (size_t i = 0; datapoint_sink_stats_get(i, &stats) == 0; i++) {
+        shell_print(sh, "  %-14s %10u %10u %7u / %-4u", stats.name,
+                    stats.written, stats.dropped, stats.high_water,
+                    stats.queue_len);
+    }
+
+    return 0;
+}
+
+#ifdef CONFIG_DATAPOINT_DEADBAND
+static int cmd_datapoint_deadband(const struct shell *sh, size_t argc,
+                                  char **argv)
+{
+    struct datapoint_deadband deadband;
+    unsigned int id = strtoul(argv[1], NULL, 10);
+
+    if (datapoint_deadband_get(id, &deadband) != 0) {
+        shell_error(sh, "Unknown sensor ID: %s", argv[1]);
+        return -EINVAL;
+    }
+
+    /* Settings left out keep their current value */
+    if (argc > 2) {
+        deadband.abs = strtof(argv[2], NULL);
+    }
+    if (argc > 3) {
+        deadband.pct = strtof(argv[3], NULL);
+    }
+    if (argc > 4) {
+        deadband.max_silence_s = strtoul(argv[4], NULL, 10);
+    }
+
+    if (argc > 2) {
+        int err = datapoint_deadband_set(id, &deadband);
+        if (err != 0) {
+            shell_error(sh, "Failed to set the deadband: %d", err);
+            return err;
+        }
+    }
+
+    const struct datapoint_sensor_info *info = datapoint_sensor_info(id);
+
+    shell_print(sh, "%s: %g %s or %g%%, heartbeat %u s", info->name,
+                (double)deadband.abs, info->unit, (double)deadband.pct,
+                deadband.max_silence_s);
+
+    return 0;
+}
+#endif /* CONFIG_DATAPOINT_DEADBAND */
+
+#ifdef CONFIG_DATAPOINT_SD_CBOR
+static int print_logged(const struct datapoint *dp, void *user_data)
+{
+    const struct shell *sh = user_data;
+    char name[DATAPOINT_SUMMARY_NAME_MAX_LEN + 1];
+    struct datapoint line;
+    char buf[256];
+
+    /* Print the same lines as the CSV log, timestamped in UTC seconds */
+    unsigned int rows = dp->c_present ? DATAPOINT_SUMMARY_ROWS : 1;
+
+    for (unsigned int r = 0; r < rows; r++) {
+        line = *dp;
+        if (dp->c_present) {
+            datapoint_summary_row(dp, r, &line, name);
+        }
+        line.t /= MSEC_PER_SEC;
+
+        if (datapoint_to_csv(&line, buf, sizeof(buf)) > 0) {
+            shell_fprintf(sh, SHELL_NORMAL, "%s", buf);
+        }
+    }
+
+    return 0;
+}
+
+static int cmd_datapoint_log(const struct shell *sh, size_t argc,
+                             char **argv)
+{
+    int64_t start_s = strtoll(argv[1], NULL, 10);
+    int64_t end_s = strtoll(argv[2], NULL, 10);
+
+    int ret = datapoint_sdlog_read(start_s * MSEC_PER_SEC,
+                                   end_s * MSEC_PER_SEC + MSEC_PER_SEC - 1,
+                                   print_logged, (void *)sh);
+    if (ret < 0) {
+        shell_error(sh, "Failed to read the log: %d", ret);
+        return ret;
+    }
+
+    shell_print(sh, "%d datapoints", ret);
+
+    return 0;
+}
+#endif /* CONFIG_DATAPOINT_SD_CBOR */
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_datapoint_queue,
+    SHELL_CMD(reset, NULL, "Clear the statistics", cmd_datapoint_queue_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_datapoint,
+    SHELL_CMD(queue, &sub_datapoint_queue,
+              "Show queue occupancy and drops per sensor",
+              cmd_datapoint_queue),
+    SHELL_CMD(sinks, NULL, "Show datapoints handled and dropped per sink",
+              cmd_datapoint_sinks),
+#ifdef CONFIG_DATAPOINT_DEADBAND
+    SHELL_CMD_ARG(deadband, NULL,
+                  "Show or set the deadband of a sensor\n"
+                  "Usage: datapoint deadband <id> [<abs> [<pct> "
+                  "[<heartbeat_s>]]]",
+                  cmd_datapoint_deadband, 2, 3),
+#endif /* CONFIG_DATAPOINT_DEADBAND */
+#ifdef CONFIG_DATAPOINT_SD_CBOR
+    SHELL_CMD_ARG(log, NULL,
+                  "Print the SD card log between two UTC times in seconds\n"
+                  "Usage: datapoint log <start> <end>",
+                  cmd_datapoint_log, 3, 0),
+#endif /* CONFIG_DATAPOINT_SD_CBOR */
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(datapoint, &sub_datapoint, "Datapoint pipeline commands",
+                   NULL);
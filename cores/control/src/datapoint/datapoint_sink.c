@@ -0,0 +1,147 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <datapoint_sink.h>
+
+LOG_MODULE_REGISTER(datapoint_sink, LOG_LEVEL_INF);
+
+/*
+ * Datapoint sinks
+ *
+ * The datapoint thread publishes each sample to every registered sink. Each
+ * sink has its own bounded queue and worker thread, so a slow sink, such as
+ * an uplink waiting on the modem, neither delays the other sinks nor the
+ * datapoint thread. When a sink's queue is full, its policy decides which
+ * sample is dropped, and the drop is counted against that sink only.
+ *
+ * Sinks are registered during boot and never removed, so the list is only
+ * locked against registration.
+ */
+
+static sys_slist_t sinks = SYS_SLIST_STATIC_INIT(&sinks);
+static struct k_spinlock sinks_lock;
+
+int datapoint_sink_register(struct datapoint_sink *sink)
+{
+    if (sink->queue == NULL || sink->api == NULL ||
+        sink->api->write == NULL) {
+        return -EINVAL;
+    }
+
+    K_SPINLOCK(&sinks_lock) {
+        sys_slist_append(&sinks, &sink->node);
+    }
+
+    return 0;
+}
+
+static void sink_put(struct datapoint_sink *sink,
+                     const struct datapoint_sample *sample)
+{
+    if (k_msgq_put(sink->queue, sample, K_NO_WAIT) != 0) {
+        struct datapoint_sample oldest;
+
+        atomic_inc(&sink->dropped);
+
+        if (sink->policy != DATAPOINT_SINK_DROP_OLDEST) {
+            return;
+        }
+
+        /* The worker may take the oldest sample first, in which case the
+         * put has room anyway */
+        k_msgq_get(sink->queue, &oldest, K_NO_WAIT);
+
+        if (k_msgq_put(sink->queue, sample, K_NO_WAIT) != 0) {
+            return;
+        }
+    }
+
+    atomic_val_t used = k_msgq_num_used_get(sink->queue);
+    atomic_val_t high_water = atomic_get(&sink->high_water);
+
+    /* Only the datapoint thread publishes, so no CAS loop is needed */
+    if (used > high_water) {
+        atomic_set(&sink->high_water, used);
+    }
+}
+
+void datapoint_sink_publish(const struct datapoint_sample *sample)
+{
+    struct datapoint_sink *sink;
+
+    SYS_SLIST_FOR_EACH_CONTAINER(&sinks, sink, node) {
+        sink_put(sink, sample);
+    }
+}
+
+/**
+ * @brief Time for a sink to wait for a sample before its periodic work.
+ */
+static k_timeout_t sink_timeout(const struct datapoint_sink *sink)
+{
+    int64_t now = k_uptime_get();
+    int64_t deadline = now + CONFIG_DATAPOINT_SINK_POLL_MS;
+
+    if (sink->api->deadline != NULL) {
+        deadline = MIN(deadline, sink->api->deadline());
+    }
+
+    return K_MSEC(MAX(deadline - now, 0));
+}
+
+void datapoint_sink_worker(void *p1, void *p2, void *p3)
+{
+    struct datapoint_sink *sink = p1;
+    struct datapoint_sample sample;
+
+    if (sink->api->init != NULL) {
+        int err = sink->api->init();
+        if (err != 0) {
+            LOG_ERR("Failed to start %s: %d", sink->name, err);
+
+            /* Keep the queue drained so the failure shows in the drop
+             * count rather than as a permanently full queue */
+            while (1) {
+                k_msgq_get(sink->queue, &sample, K_FOREVER);
+                atomic_inc(&sink->dropped);
+            }
+        }
+    }
+
+    while (1) {
+        if (k_msgq_get(sink->queue, &sample, sink_timeout(sink)) == 0) {
+            sink->api->write(&sample);
+            atomic_inc(&sink->written);
+        }
+
+        if (sink->api->poll != NULL) {
+            sink->api->poll();
+        }
+    }
+}
+
+int datapoint_sink_stats_get(size_t index, struct datapoint_sink_stats *stats)
+{
+    struct datapoint_sink *sink;
+    int err = -ENOENT;
+
+    K_SPINLOCK(&sinks_lock) {
+        SYS_SLIST_FOR_EACH_CONTAINER(&sinks, sink, node) {
+            if (index-- > 0) {
+                continue;
+            }
+
+            *stats = (struct datapoint_sink_stats) {
+                .name = sink->name,
+                .written = atomic_get(&sink->written),
+                .dropped = atomic_get(&sink->dropped),
+                .high_water = atomic_get(&sink->high_water),
+                .queue_len = sink->queue->max_msgs,
+            };
+            err = 0;
+            break;
+        }
+    }
+
+    return err;
+}
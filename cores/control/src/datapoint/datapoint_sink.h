@@ -0,0 +1,133 @@
+#ifndef _DATAPOINT_SINK_H_
+#define _DATAPOINT_SINK_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/slist.h>
+#include <datapoint/czd_datapoint_types.h>
+
+#include <datapoint_queue.h>
+
+/**
+ * @brief A datapoint or window summary as published to the sinks.
+ */
+struct datapoint_sample {
+    /* dp.t is the capture time in milliseconds of uptime */
+    struct datapoint dp;
+    /* enum datapoint_value_type of the queued record, for sinks that keep
+     * raw values */
+    uint8_t type;
+};
+
+/**
+ * @brief What a sink does when its queue is full.
+ */
+enum datapoint_sink_policy {
+    /* Drop the sample being published */
+    DATAPOINT_SINK_DROP_NEWEST,
+    /* Drop the oldest queued sample to make room */
+    DATAPOINT_SINK_DROP_OLDEST,
+};
+
+/**
+ * @brief Sink callbacks. All are called on the sink's own worker thread.
+ */
+struct datapoint_sink_api {
+    /* Optional. Called once before the first sample. A sink that fails to
+     * initialise stops, and its samples are counted as dropped. */
+    int (*init)(void);
+    /* Handle one sample */
+    void (*write)(const struct datapoint_sample *sample);
+    /* Optional. Periodic work, called after each sample and at least once
+     * per CONFIG_DATAPOINT_SINK_POLL_MS */
+    void (*poll)(void);
+    /* Optional. Uptime in milliseconds at which poll next has work, or
+     * INT64_MAX */
+    int64_t (*deadline)(void);
+};
+
+struct datapoint_sink {
+    const char *name;
+    const struct datapoint_sink_api *api;
+    struct k_msgq *queue;
+    enum datapoint_sink_policy policy;
+    atomic_t written;
+    atomic_t dropped;
+    atomic_t high_water;
+    sys_snode_t node;
+};
+
+struct datapoint_sink_stats {
+    const char *name;
+    /* Samples handed to the sink's write callback */
+    uint32_t written;
+    /* Samples lost to a full queue, or to a sink that failed to start */
+    uint32_t dropped;
+    /* Most samples ever waiting in the sink's queue */
+    uint32_t high_water;
+    /* Capacity of the sink's queue */
+    uint32_t queue_len;
+};
+
+/**
+ * @brief Sink worker thread entry point, see DATAPOINT_SINK_DEFINE.
+ */
+void datapoint_sink_worker(void *sink, void *p2, void *p3);
+
+/**
+ * @brief Define and register a datapoint sink with its own queue and worker
+ *        thread.
+ *
+ * @param _name        Sink name, also used for its queue and thread.
+ * @param _api         Sink callbacks, struct datapoint_sink_api.
+ * @param _queue_len   Number of samples the sink's queue holds.
+ * @param _policy      enum datapoint_sink_policy applied when it is full.
+ * @param _stack_size  Stack size of the worker thread.
+ * @param _prio        Priority of the worker thread.
+ */
+#define DATAPOINT_SINK_DEFINE(_name, _api, _queue_len, _policy,            \
+                              _stack_size, _prio)                          \
+    K_MSGQ_DEFINE(_name##_queue, sizeof(struct datapoint_sample),          \
+                  _queue_len, 8);                                          \
+    static struct datapoint_sink _name = {                                 \
+        .name = #_name,                                                    \
+        .api = _api,                                                       \
+        .queue = &_name##_queue,                                           \
+        .policy = _policy,                                                 \
+    };                                                                     \
+    static int _name##_register(void)                                      \
+    {                                                                      \
+        return datapoint_sink_register(&_name);                            \
+    }                                                                      \
+    SYS_INIT(_name##_register, APPLICATION, 1);                            \
+    K_THREAD_DEFINE(_name##_thread, _stack_size, datapoint_sink_worker,    \
+                    &_name, NULL, NULL, _prio, 0, 0)
+
+/**
+ * @brief Add a sink to those that samples are published to.
+ *
+ * Sinks defined with DATAPOINT_SINK_DEFINE are registered at boot. A sink
+ * set up at runtime needs its own worker running datapoint_sink_worker.
+ *
+ * @return 0 on success, or -EINVAL if the sink has no queue or write
+ *         callback.
+ */
+int datapoint_sink_register(struct datapoint_sink *sink);
+
+/**
+ * @brief Publish a sample to every registered sink without blocking.
+ *
+ * Only the datapoint thread publishes.
+ */
+void datapoint_sink_publish(const struct datapoint_sample *sample);
+
+/**
+ * @brief Get the statistics of a registered sink.
+ *
+ * @param index  Sink index, in order of registration.
+ *
+ * @return 0 on success, or -ENOENT if there is no sink at index.
+ */
+int datapoint_sink_stats_get(size_t index, struct datapoint_sink_stats *stats);
+
+#endif /* _DATAPOINT_SINK_H_ */
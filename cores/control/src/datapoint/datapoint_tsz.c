@@ -0,0 +1,120 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include <datapoint_tsz.h>
+
+LOG_MODULE_REGISTER(datapoint_tsz, LOG_LEVEL_INF);
+
+static bool set_empty(const struct dp_tsz_set *set)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(set->series); i++) {
+        if (set->series[i].active) {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+static void series_emit(struct dp_tsz_series *series, dp_tsz_emit_t emit)
+{
+    size_t len = tsz_encoder_finish(&series->enc);
+
+    emit(series, series->buf, len);
+    series->active = false;
+}
+
+static void series_start(struct dp_tsz_set *set, struct dp_tsz_series *series,
+                         const struct datapoint_record *rec)
+{
+    if (set_empty(set)) {
+        set->deadline = k_uptime_get() + CONFIG_DATAPOINT_TSZ_TIMEOUT_MS;
+    }
+
+    series->active = true;
+    series->sensor_id = rec->sensor_id;
+    series->type = rec->type;
+    tsz_encoder_init(&series->enc, series->buf, sizeof(series->buf));
+}
+
+/**
+ * @brief Find the open block for a record's sensor, or start one.
+ */
+static struct dp_tsz_series *series_get(struct dp_tsz_set *set,
+                                        const struct datapoint_record *rec,
+                                        dp_tsz_emit_t emit)
+{
+    struct dp_tsz_series *free = NULL;
+
+    for (size_t i = 0; i < ARRAY_SIZE(set->series); i++) {
+        struct dp_tsz_series *series = &set->series[i];
+
+        if (!series->active) {
+            free = free ? free : series;
+        } else if (series->sensor_id == rec->sensor_id) {
+            if (series->type == rec->type) {
+                return series;
+            }
+
+            /* A block holds a single value type */
+            series_emit(series, emit);
+            free = series;
+            break;
+        }
+    }
+
+    if (free == NULL) {
+        LOG_DBG("All series in use, emitting every block");
+        dp_tsz_flush(set, emit);
+        free = &set->series[0];
+    }
+
+    series_start(set, free, rec);
+
+    return free;
+}
+
+void dp_tsz_append(struct dp_tsz_set *set, const struct datapoint_record *rec,
+                   int64_t uptime_ms, dp_tsz_emit_t emit)
+{
+    struct dp_tsz_series *series = series_get(set, rec, emit);
+    uint32_t value = rec->type == DATAPOINT_VALUE_FLOAT ?
+                     tsz_float_bits(rec->value.f) : (uint32_t)rec->value.i;
+
+    int err = tsz_encoder_append(&series->enc, uptime_ms, value);
+    if (err == 0) {
+        return;
+    }
+
+    /* Full, or an interval too far off to encode. Either way the sample
+     * starts a new block. */
+    series_emit(series, emit);
+    series_start(set, series, rec);
+
+    err = tsz_encoder_append(&series->enc, uptime_ms, value);
+    if (err != 0) {
+        LOG_ERR("Sample does not fit an empty block: %d", err);
+        series->active = false;
+    }
+}
+
+void dp_tsz_flush(struct dp_tsz_set *set, dp_tsz_emit_t emit)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(set->series); i++) {
+        if (set->series[i].active) {
+            series_emit(&set->series[i], emit);
+        }
+    }
+}
+
+int64_t dp_tsz_deadline(const struct dp_tsz_set *set)
+{
+    return set_empty(set) ? INT64_MAX : set->deadline;
+}
+
+void dp_tsz_poll(struct dp_tsz_set *set, dp_tsz_emit_t emit)
+{
+    if (!set_empty(set) && k_uptime_get() >= set->deadline) {
+        dp_tsz_flush(set, emit);
+    }
+}
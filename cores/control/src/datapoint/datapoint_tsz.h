@@ -0,0 +1,68 @@
+#ifndef _DATAPOINT_TSZ_H_
+#define _DATAPOINT_TSZ_H_
+
+#include <zephyr/kernel.h>
+#include <lib/tsz.h>
+
+#include <datapoint_queue.h>
+
+/**
+ * @brief Compressed block of one sensor's samples.
+ *
+ * Timestamps are in milliseconds of uptime, and values are the raw 32 bits
+ * of the record value, interpreted according to type.
+ */
+struct dp_tsz_series {
+    bool active;
+    uint8_t sensor_id;
+    uint8_t type;
+    struct tsz_encoder enc;
+    uint8_t buf[CONFIG_DATAPOINT_TSZ_BLOCK_SIZE];
+};
+
+/**
+ * @brief Open blocks for up to CONFIG_DATAPOINT_TSZ_MAX_SERIES sensors.
+ */
+struct dp_tsz_set {
+    struct dp_tsz_series series[CONFIG_DATAPOINT_TSZ_MAX_SERIES];
+    /* Uptime at which the oldest open block is due */
+    int64_t deadline;
+};
+
+/* Callback type for a finished block */
+typedef void (*dp_tsz_emit_t)(const struct dp_tsz_series *series,
+                              const uint8_t *block, size_t len);
+
+/**
+ * @brief Add a record to the block of its sensor.
+ *
+ * A full block is emitted and a new block started. If all series are in use,
+ * every block is emitted first.
+ *
+ * @param set        Set of open blocks.
+ * @param rec        Record to add.
+ * @param uptime_ms  Capture time of the record in milliseconds of uptime.
+ * @param emit       Called for each finished block.
+ */
+void dp_tsz_append(struct dp_tsz_set *set, const struct datapoint_record *rec,
+                   int64_t uptime_ms, dp_tsz_emit_t emit);
+
+/**
+ * @brief Emit every open block.
+ */
+void dp_tsz_flush(struct dp_tsz_set *set, dp_tsz_emit_t emit);
+
+/**
+ * @brief Get the uptime at which the oldest open block is due.
+ *
+ * @return Deadline in milliseconds of uptime, or INT64_MAX if no block is
+ *         open.
+ */
+int64_t dp_tsz_deadline(const struct dp_tsz_set *set);
+
+/**
+ * @brief Emit every open block once the oldest is due.
+ */
+void dp_tsz_poll(struct dp_tsz_set *set, dp_tsz_emit_t emit);
+
+#endif /* _DATAPOINT_TSZ_H_ */
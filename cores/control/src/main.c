@@ -21,6 +21,10 @@
 
 #include <remote_commands.h>
 
+#ifdef CONFIG_DATAPOINT_CELLULAR_STATS
+#include <datapoint_cellular_stats.h>
+#endif /* CONFIG_DATAPOINT_CELLULAR_STATS */
+
 LOG_MODULE_REGISTER(main, LOG_LEVEL_ERR);
 
 #ifdef CONFIG_ICMP
@@ -66,6 +70,10 @@ int main(void)
 
     remote_commands_init();
 
+#ifdef CONFIG_DATAPOINT_CELLULAR_STATS
+    datapoint_cellular_stats_init();
+#endif /* CONFIG_DATAPOINT_CELLULAR_STATS */
+
 #ifdef CONFIG_ICMP
     icmp_register_target(0, icmp_test_cb);
     icmp_init();
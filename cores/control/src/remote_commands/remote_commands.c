@@ -1,3 +1,4 @@
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/sys/atomic.h>
 #include <zephyr/logging/log.h>
@@ -17,6 +18,13 @@
 #include <imu/imu.h>
 #include <temp_hum/temp_hum.h>
 
+#ifdef CONFIG_DATAPOINT_AGGREGATE
+#include <datapoint_aggregate.h>
+#endif
+#ifdef CONFIG_DATAPOINT_DEADBAND
+#include <datapoint_deadband.h>
+#endif
+
 LOG_MODULE_REGISTER(remote_commands);
 
 static const struct gpio_dt_spec ls_5vh =
@@ -29,34 +37,377 @@ static const char * const data_path[] = {
     "ccd99122-3904-454a-95c7-9fb71f2c3fde", "commands", NULL
 };
 
+static const char * const data_path_alias[] = {
+    CONFIG_REMOTE_COMMANDS_PATH_ALIAS, NULL
+};
+
+/* Header, token and the command path options */
+#define COMMAND_REQUEST_MAX_LEN \
+    (4 + COAP_TOKEN_MAX_LEN + CONFIG_COAP_TEMPLATE_MAX_OPTIONS_LEN)
+
+/* How long a response to a command request is waited for */
+#define COMMAND_RESPONSE_TIMEOUT_MS 30000
+
+static struct coap_request_template poll_template;
+static struct coap_request_template delete_template;
+
+#ifdef CONFIG_REMOTE_COMMANDS_OBSERVE
+static struct coap_request_template observe_template;
+
+/* Re-registrations reuse the token so the server replaces, rather than
+ * duplicates, the observation (RFC 7641 section 3.3.1) */
+static uint8_t observe_token[COAP_TOKEN_MAX_LEN];
+
+/* Freshness of a notification without a Max-Age option, RFC 7252
+ * section 5.10.5 */
+#define OBSERVE_DEFAULT_MAX_AGE_S 60
+
+static struct k_spinlock observe_lock;
+
+/* Uptime of the last registration sent, and of the last notification */
+static int64_t observe_registered_ms;
+static int64_t observe_notified_ms;
+
+/* Uptime until which the last notification is fresh. The observation is
+ * live until then, and lost once no newer notification has arrived. */
+static int64_t observe_fresh_until_ms;
+#endif /* CONFIG_REMOTE_COMMANDS_OBSERVE */
+
+static int init_request_templates(void)
+{
+    const char * const *path = sizeof(CONFIG_REMOTE_COMMANDS_PATH_ALIAS) > 1 ?
+                               data_path_alias : data_path;
+
+#ifdef CONFIG_COAP_CON
+    enum coap_msgtype delete_type = COAP_TYPE_CON;
+#else
+    enum coap_msgtype delete_type = COAP_TYPE_NON_CON;
+#endif /* CONFIG_COAP_CON */
+
+    int err = coap_template_init(&poll_template, COAP_TYPE_NON_CON,
+                                 COAP_METHOD_GET, path);
+    if (err != 0) {
+        return err;
+    }
+
+#ifdef CONFIG_REMOTE_COMMANDS_OBSERVE
+    err = coap_template_init_observe(&observe_template, path, 0);
+    if (err != 0) {
+        return err;
+    }
+
+    memcpy(observe_token, coap_next_token(), sizeof(observe_token));
+#endif /* CONFIG_REMOTE_COMMANDS_OBSERVE */
+
+    return coap_template_init(&delete_template, delete_type,
+                              COAP_METHOD_DELETE, path);
+}
+
+static void handle_command_response(const struct coap_packet *response);
+
+/**
+ * @brief Build a bodiless command request directly in an uplink buffer.
+ *
+ * The token is registered with the response matcher first, so the response
+ * is routed to cb however soon it arrives.
+ */
+static int send_command_request(const struct coap_request_template *tpl,
+                                const uint8_t *token, uint32_t timeout_ms,
+                                uint32_t flags, coap_match_cb_t cb)
+{
+    int err = coap_match_register(token, timeout_ms, flags, cb, NULL);
+    if (err != 0) {
+        return err;
+    }
+
+    struct cellular_uplink_buf buf;
+    err = cellular_uplink_claim(&buf, COMMAND_REQUEST_MAX_LEN,
+                                CELLULAR_PRIORITY_CONTROL);
+    if (err == 0) {
+        buf.tag = "commands";
+
+        int req_size = coap_template_build_token(tpl, token, buf.data,
+                                                 buf.size, false);
+        if (req_size < 0) {
+            cellular_uplink_abort(&buf);
+            err = req_size;
+        } else {
+            err = cellular_uplink_commit(&buf, req_size);
+        }
+    }
+
+    /* A long-lived registration keeps matching earlier requests */
+    if (err != 0 && !(flags & COAP_MATCH_MULTIPLE)) {
+        coap_match_cancel(token);
+    }
+
+    return err;
+}
+
+static void command_response_cb(const struct coap_packet *response,
+                                int result, void *user_data)
+{
+    if (result != 0) {
+        LOG_WRN("No response to command request: %d", result);
+        return;
+    }
+
+    handle_command_response(response);
+}
+
+#ifdef CONFIG_REMOTE_COMMANDS_OBSERVE
+static void observe_response_cb(const struct coap_packet *response,
+                                int result, void *user_data)
+{
+    if (result != 0) {
+        LOG_INF("Commands observation expired");
+        return;
+    }
+
+    /* The registration response is the first notification (RFC 7641
+     * section 3.2). Any other response ends the observation. */
+    bool notification =
+        coap_header_get_code(response) == COAP_RESPONSE_CODE_CONTENT &&
+        coap_get_option_int(response, COAP_OPTION_OBSERVE) >= 0;
+    int max_age_s = coap_get_option_int(response, COAP_OPTION_MAX_AGE);
+    if (max_age_s < 0) {
+        max_age_s = OBSERVE_DEFAULT_MAX_AGE_S;
+    }
+
+    int64_t now = k_uptime_get();
+
+    K_SPINLOCK(&observe_lock) {
+        if (notification) {
+            observe_notified_ms = now;
+            observe_fresh_until_ms = now + (int64_t)max_age_s * MSEC_PER_SEC;
+        } else {
+            observe_fresh_until_ms = 0;
+        }
+    }
+
+    handle_command_response(response);
+}
+
+/**
+ * @brief Check whether notifications are still arriving for the observation.
+ */
+static bool observation_is_live(void)
+{
+    bool live = false;
+    int64_t now = k_uptime_get();
+
+    K_SPINLOCK(&observe_lock) {
+        live = now < observe_fresh_until_ms;
+    }
+
+    return live;
+}
+#endif /* CONFIG_REMOTE_COMMANDS_OBSERVE */
+
+static void delete_response_cb(const struct coap_packet *response,
+                               int result, void *user_data)
+{
+    if (result != 0) {
+        LOG_WRN("No response to command DELETE: %d", result);
+        return;
+    }
+
+    LOG_DBG("Command DELETE answered with %u.%02u",
+            coap_header_get_code(response) >> 5,
+            coap_header_get_code(response) & 0x1f);
+}
+
+#ifdef CONFIG_COAP_CON
+/**
+ * @brief CoAP confirmable transport over the cellular control uplink.
+ */
+static int send_control_packet(const uint8_t *buf, size_t len)
+{
+    struct cellular_uplink_buf ubuf;
+    int err = cellular_uplink_claim(&ubuf, len, CELLULAR_PRIORITY_CONTROL);
+    if (err != 0) {
+        return err;
+    }
+
+    ubuf.tag = "commands";
+    memcpy(ubuf.data, buf, len);
+
+    return cellular_uplink_commit(&ubuf, len);
+}
+
+static void delete_delivery_cb(uint16_t msg_id, enum coap_con_result result,
+                               void *user_data)
+{
+    if (result == COAP_CON_DELIVERED) {
+        LOG_INF("Command DELETE %u acknowledged", msg_id);
+    } else {
+        LOG_WRN("Command DELETE %u not delivered: %d", msg_id, result);
+    }
+}
+#endif /* CONFIG_COAP_CON */
+
+#ifdef CONFIG_COAP_BLOCK
+/**
+ * @brief CoAP block-wise transport over the cellular telemetry uplink.
+ */
+static int send_bulk_packet(const uint8_t *buf, size_t len)
+{
+    struct cellular_uplink_buf ubuf;
+    int err = cellular_uplink_claim(&ubuf, len, CELLULAR_PRIORITY_TELEMETRY);
+    if (err != 0) {
+        return err;
+    }
+
+    ubuf.tag = "block";
+    memcpy(ubuf.data, buf, len);
+
+    return cellular_uplink_commit(&ubuf, len);
+}
+#endif /* CONFIG_COAP_BLOCK */
+
+/**
+ * @brief Acknowledge a confirmable message from the server.
+ */
+static void send_empty_ack(const struct coap_packet *request)
+{
+    struct cellular_uplink_buf buf;
+    struct coap_packet ack;
+
+    int err = cellular_uplink_claim(&buf, COAP_FIXED_HEADER_SIZE +
+                                    COAP_TOKEN_MAX_LEN,
+                                    CELLULAR_PRIORITY_CONTROL);
+    if (err != 0) {
+        LOG_ERR("Failed to claim ACK buffer: %d", err);
+        return;
+    }
+
+    buf.tag = "commands";
+
+    err = coap_ack_init(&ack, request, buf.data, buf.size, COAP_CODE_EMPTY);
+    if (err != 0) {
+        cellular_uplink_abort(&buf);
+        return;
+    }
+
+    cellular_uplink_commit(&buf, ack.offset);
+}
+
+#ifdef CONFIG_REMOTE_COMMANDS_OBSERVE
+/**
+ * @brief Decide whether the commands observation needs a new registration.
+ *
+ * @param next_ms  Set to the delay until the observation should be checked
+ *                 again if it does not.
+ *
+ * @return true if a registration should be sent now.
+ */
+static bool observe_needs_registration(int32_t *next_ms)
+{
+    int64_t now = k_uptime_get();
+    int64_t fresh_until = 0;
+    int64_t refresh_at = 0;
+    int64_t notified = 0;
+
+    K_SPINLOCK(&observe_lock) {
+        fresh_until = observe_fresh_until_ms;
+        notified = observe_notified_ms;
+        refresh_at = observe_registered_ms +
+                     CONFIG_REMOTE_COMMANDS_OBSERVE_LIFETIME * MSEC_PER_SEC;
+    }
+
+    if (now >= fresh_until) {
+        /* Only report a lost observation once */
+        if (fresh_until != 0) {
+            LOG_INF("No notification for %d s. Re-registering.",
+                    (int)((now - notified) / MSEC_PER_SEC));
+
+            K_SPINLOCK(&observe_lock) {
+                if (observe_fresh_until_ms == fresh_until) {
+                    observe_fresh_until_ms = 0;
+                }
+            }
+        }
+        return true;
+    }
+
+    /* Keep the NAT binding notifications arrive through alive */
+    if (now >= refresh_at) {
+        return true;
+    }
+
+    *next_ms = MIN(fresh_until, refresh_at) - now;
+    return false;
+}
+#endif /* CONFIG_REMOTE_COMMANDS_OBSERVE */
+
+/**
+ * @brief Poll for commands, or keep the commands observation alive.
+ *
+ * With CONFIG_REMOTE_COMMANDS_OBSERVE each poll is an Observe registration,
+ * whose response carries the current command. While notifications keep
+ * arriving within their Max-Age no requests are sent, other than a fresh
+ * registration every observe lifetime. Once the last notification is older
+ * than its Max-Age, or the server declines the observation, the
+ * registrations are sent every poll interval again and act as polls.
+ */
 void remote_command_poll_work_handler(struct k_work *work)
 {
+    int32_t delay_ms = atomic_get(&poll_interval_ms);
+
     if (cellular_state_get() != CELLULAR_STATE_RUNNING) {
         LOG_WRN("Cellular interface not ready. Deferring command poll.");
         goto reschedule;
     }
 
-    uint8_t coap_buf[512] = {0};
-    int req_size = coap_build_request(coap_buf, sizeof(coap_buf),
-                                      COAP_TYPE_NON_CON,
-                                      COAP_METHOD_GET,
-                                      data_path,
-                                      NULL, 0);
+#ifdef CONFIG_REMOTE_COMMANDS_OBSERVE
+    if (!observe_needs_registration(&delay_ms)) {
+        goto reschedule;
+    }
 
-    int err = cellular_send_packet(coap_buf, req_size);
+    K_SPINLOCK(&observe_lock) {
+        observe_registered_ms = k_uptime_get();
+    }
+
+    /* The token stays registered until the next registration is due */
+    int err = send_command_request(&observe_template, observe_token,
+                                   CONFIG_REMOTE_COMMANDS_OBSERVE_LIFETIME *
+                                   MSEC_PER_SEC + COMMAND_RESPONSE_TIMEOUT_MS,
+                                   COAP_MATCH_MULTIPLE, observe_response_cb);
+#else
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    memcpy(token, coap_next_token(), sizeof(token));
+
+    int err = send_command_request(&poll_template, token,
+                                   COMMAND_RESPONSE_TIMEOUT_MS, 0,
+                                   command_response_cb);
+#endif /* CONFIG_REMOTE_COMMANDS_OBSERVE */
     if (err == 0) {
-        LOG_INF("Sent CoAP command GET packet (%d B)", req_size);
+        LOG_INF("Sent CoAP command GET packet");
     } else {
         LOG_ERR("Failed to send command GET packet: %d", err);
     }
 
 reschedule:
-    k_work_schedule(&remote_command_poll_work,
-                    K_MSEC(atomic_get(&poll_interval_ms)));
+    k_work_schedule(&remote_command_poll_work, K_MSEC(delay_ms));
 }
 
 int remote_commands_init(void)
 {
+    int err = init_request_templates();
+    if (err != 0) {
+        LOG_ERR("Failed to encode command request templates: %d", err);
+        return err;
+    }
+
+#ifdef CONFIG_COAP_CON
+    coap_con_init(send_control_packet);
+#endif /* CONFIG_COAP_CON */
+
+#ifdef CONFIG_COAP_BLOCK
+    coap_block_init(send_bulk_packet, CONFIG_CELLULAR_UPLINK_BUFFER_SIZE,
+                    CONFIG_CELLULAR_DOWNLINK_BUFFER_SIZE);
+#endif /* CONFIG_COAP_BLOCK */
+
     k_work_init_delayable(&remote_command_poll_work,
                           remote_command_poll_work_handler);
 
@@ -69,6 +420,15 @@ int remote_commands_init(void)
 void remote_commands_set_poll_interval(int32_t interval_ms)
 {
     atomic_set(&poll_interval_ms, interval_ms);
+
+#ifdef CONFIG_REMOTE_COMMANDS_OBSERVE
+    /* Commands are pushed while observed, the interval applies once the
+     * observation is lost */
+    if (observation_is_live()) {
+        return;
+    }
+#endif /* CONFIG_REMOTE_COMMANDS_OBSERVE */
+
     k_work_reschedule(&remote_command_poll_work, K_MSEC(interval_ms));
 }
 
@@ -113,21 +473,94 @@ static void update_voltage_rail_state(enum command_rails rail, bool state)
             command_rail_to_str(rail), state ? "ON" : "OFF");
 }
 
-static void issue_delete_request(void)
+#ifdef CONFIG_DATAPOINT_AGGREGATE
+static void update_aggregate_window(uint32_t sensor_id, int32_t window_s)
 {
-    uint8_t coap_buf[256] = {0};
-    int req_size = coap_build_request(coap_buf, sizeof(coap_buf),
-                                      COAP_TYPE_NON_CON,
-                                      COAP_METHOD_DELETE,
-                                      data_path,
-                                      NULL, 0);
+    if (window_s < 0) {
+        LOG_WRN("Invalid aggregation window: %d", window_s);
+        return;
+    }
+
+    int err = datapoint_aggregate_set_window(sensor_id, window_s);
+    if (err != 0) {
+        LOG_WRN("Unknown datapoint sensor: %u", sensor_id);
+        return;
+    }
+
+    LOG_INF("Set aggregation window of sensor %u to %d s", sensor_id,
+            window_s);
+}
+#endif /* CONFIG_DATAPOINT_AGGREGATE */
+
+#ifdef CONFIG_DATAPOINT_DEADBAND
+static void update_deadband(const struct command *cmd)
+{
+    struct datapoint_deadband deadband;
+
+    /* Fields left out of the command keep their current value */
+    int err = datapoint_deadband_get(cmd->ta, &deadband);
+    if (err != 0) {
+        LOG_WRN("Unknown datapoint sensor: %u", cmd->ta);
+        return;
+    }
 
-    int err = cellular_send_packet(coap_buf, req_size);
+    if (cmd->f_present) {
+        deadband.abs = cmd->f.f;
+    }
+    if (cmd->p_present) {
+        deadband.pct = cmd->p.p;
+    }
+    if (cmd->i_present) {
+        if (cmd->i.i < 0) {
+            LOG_WRN("Invalid heartbeat interval: %d", cmd->i.i);
+            return;
+        }
+        deadband.max_silence_s = cmd->i.i;
+    }
+
+    err = datapoint_deadband_set(cmd->ta, &deadband);
+    if (err != 0) {
+        LOG_WRN("Invalid deadband for sensor %u", cmd->ta);
+        return;
+    }
+
+    LOG_INF("Set deadband of sensor %u to %g or %g%%, heartbeat %u s",
+            cmd->ta, (double)deadband.abs, (double)deadband.pct,
+            deadband.max_silence_s);
+}
+#endif /* CONFIG_DATAPOINT_DEADBAND */
+
+static void issue_delete_request(void)
+{
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    memcpy(token, coap_next_token(), sizeof(token));
+
+#ifdef CONFIG_COAP_CON
+    /* Acknowledge the command reliably, the server would otherwise serve
+     * it again on the next poll */
+    uint8_t coap_buf[COMMAND_REQUEST_MAX_LEN];
+    int err = coap_match_register(token, COMMAND_RESPONSE_TIMEOUT_MS, 0,
+                                  delete_response_cb, NULL);
+    if (err == 0) {
+        err = coap_template_build_token(&delete_template, token, coap_buf,
+                                        sizeof(coap_buf), false);
+    }
+    if (err > 0) {
+        err = coap_con_send(coap_buf, err, delete_delivery_cb, NULL);
+    }
+    if (err != 0) {
+        coap_match_cancel(token);
+    }
+#else
+    int err = send_command_request(&delete_template, token,
+                                   COMMAND_RESPONSE_TIMEOUT_MS, 0,
+                                   delete_response_cb);
+#endif /* CONFIG_COAP_CON */
     if (err) {
         LOG_ERR("Failed to send command DELETE packet: %d", err);
         return;
     }
-    LOG_INF("Sent CoAP command DELETE packet (%d B)", req_size);
+    LOG_INF("Sent CoAP command DELETE packet");
 }
 
 static void process_remote_command(struct command *cmd)
@@ -168,6 +601,34 @@ static void process_remote_command(struct command *cmd)
         update_voltage_rail_state(cmd->ta, cmd->b.b);
         break;
 
+    case CMD_SET_AGGREGATE_WINDOW:
+#ifdef CONFIG_DATAPOINT_AGGREGATE
+        if (!cmd->i_present) {
+            LOG_WRN("SET_AGGREGATE_WINDOW missing 'i' field");
+            return;
+        }
+
+        update_aggregate_window(cmd->ta, cmd->i.i);
+#else
+        /* Still deleted, the server would otherwise serve it forever */
+        LOG_WRN("SET_AGGREGATE_WINDOW not supported, rejecting");
+#endif /* CONFIG_DATAPOINT_AGGREGATE */
+        break;
+
+    case CMD_SET_DEADBAND:
+#ifdef CONFIG_DATAPOINT_DEADBAND
+        if (!cmd->f_present && !cmd->p_present && !cmd->i_present) {
+            LOG_WRN("SET_DEADBAND missing 'f', 'p' and 'i' fields");
+            return;
+        }
+
+        update_deadband(cmd);
+#else
+        /* Still deleted, the server would otherwise serve it forever */
+        LOG_WRN("SET_DEADBAND not supported, rejecting");
+#endif /* CONFIG_DATAPOINT_DEADBAND */
+        break;
+
     default:
         LOG_WRN("Unhandled command type: %u", cmd->ty);
         return;
@@ -176,6 +637,36 @@ static void process_remote_command(struct command *cmd)
     issue_delete_request();
 }
 
+/**
+ * @brief Decode and run the command carried by a commands response.
+ */
+static void handle_command_response(const struct coap_packet *response)
+{
+    /* Only 2.05 Content responses carry a command */
+    if (coap_header_get_code(response) != COAP_RESPONSE_CODE_CONTENT) {
+        LOG_WRN("Command request answered with %u.%02u",
+                coap_header_get_code(response) >> 5,
+                coap_header_get_code(response) & 0x1f);
+        return;
+    }
+
+    uint16_t payload_len = 0;
+    const uint8_t *payload_ptr = coap_packet_get_payload(response,
+                                                         &payload_len);
+    if (payload_ptr == NULL) {
+        LOG_ERR("Failed to extract CoAP payload");
+        return;
+    }
+
+    struct command cmd;
+    int err = cbor_decode_command(payload_ptr, payload_len, &cmd, NULL);
+    if (err != ZCBOR_SUCCESS) {
+        LOG_WRN("Response was not a remote command");
+        return;
+    }
+
+    process_remote_command(&cmd);
+}
 
 void remote_commands_handle_packet(const uint8_t *buf, size_t len)
 {
@@ -188,19 +679,25 @@ void remote_commands_handle_packet(const uint8_t *buf, size_t len)
         return;
     }
 
-    uint16_t payload_len = 0;
-    const uint8_t *payload_ptr = coap_packet_get_payload(&response, &payload_len);
-    if (payload_ptr == NULL) {
-        LOG_ERR("Failed to extract CoAP payload: %d", err);
+#ifdef CONFIG_COAP_CON
+    coap_con_handle_message(&response);
+#endif /* CONFIG_COAP_CON */
+
+#ifdef CONFIG_COAP_BLOCK
+    /* Responses to block-wise transfers carry no command */
+    if (coap_block_handle_message(&response) == 0) {
         return;
     }
+#endif /* CONFIG_COAP_BLOCK */
 
-    struct command cmd;
-    err = cbor_decode_command(payload_ptr, payload_len, &cmd, NULL);
-    if (err != ZCBOR_SUCCESS) {
-        LOG_WRN("Response was not a remote command");
-        return;
+    /* Notifications may be confirmable */
+    if (coap_header_get_type(&response) == COAP_TYPE_CON) {
+        send_empty_ack(&response);
     }
 
-    process_remote_command(&cmd);
+    /* Route the response to whichever request it answers */
+    err = coap_match_handle_message(&response);
+    if (err == -ENOENT && coap_header_get_code(&response) != COAP_CODE_EMPTY) {
+        LOG_WRN("Dropping unmatched or stale response");
+    }
 }
@@ -4,16 +4,19 @@
 #include <zephyr/storage/disk_access.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/fs/fs.h>
+#include <zephyr/sys/byteorder.h>
 #include <string.h>
 
 #include <ff.h>
 
+#include <sd_card.h>
+
 LOG_MODULE_REGISTER(sd_card, CONFIG_SD_CARD_WRITER_LOG_LEVEL);
 
 #define DISK_DRIVE_NAME     "SD"
 #define DISK_MOUNT_PT       "/"DISK_DRIVE_NAME":"
-#define FILE_NAME           DISK_MOUNT_PT"/log.csv"
-#define BUFFER_SIZE         1024
+#define FILE_NAME           DISK_MOUNT_PT"/"CONFIG_SD_CARD_WRITER_FILE_NAME
+#define BUFFER_SIZE         SD_CARD_BUFFER_SIZE
 
 static FATFS fat_fs;
 
@@ -30,16 +33,70 @@ static char *active_buf = buffer_a;
 static char *flush_buf  = buffer_b;
 
 static size_t active_pos = 0;
+static size_t flush_len = 0;
 struct k_work sd_card_writer_work;
 static struct k_mutex buf_mutex;
 
+/* Set from swapping a buffer out until it has been written. The buffers are
+ * not swapped again meanwhile, so that the flush state stays put. */
+static bool flush_busy;
+static struct k_condvar flush_done;
+
+/* Held while the card is powered and mounted */
+static struct k_mutex card_mutex;
+
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+#define INDEX_FILE_NAME     DISK_MOUNT_PT"/"CONFIG_SD_CARD_WRITER_INDEX_FILE_NAME
+
+/* Marks the start of each record in the log */
+#define RECORD_MAGIC        0xdb
+#define RECORD_HEADER_LEN   3
+#define INDEX_ENTRY_LEN     24
+
+/* Index entries completed within one buffer. Any more are left out, and
+ * their records are read back by scanning instead. */
+#define INDEX_PENDING_MAX   4
+
+struct index_entry {
+    /* Offset of the first record, in bytes submitted since boot until the
+     * entry is written */
+    uint64_t offset;
+    uint32_t len;
+    int64_t min_ms;
+    int64_t max_ms;
+};
+
+static struct index_entry index_a[INDEX_PENDING_MAX];
+static struct index_entry index_b[INDEX_PENDING_MAX];
+
+static struct index_entry *index_active = index_a;
+static struct index_entry *index_flush = index_b;
+
+static size_t index_active_len;
+static size_t index_flush_len;
+
+/* Block of records the next index entry is for */
+static struct index_entry block;
+static uint32_t block_records;
+
+/* Bytes submitted since boot, and where in them the flush buffer starts */
+static uint64_t submitted;
+static uint64_t flush_start;
+
+/* Payload of the record being read back */
+static uint8_t read_buf[SD_CARD_RECORD_MAX_LEN];
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+
 #define SD_CARD_NODE DT_NODELABEL(ls_sdcard)
 static const struct gpio_dt_spec ls_sdcard =
     GPIO_DT_SPEC_GET(SD_CARD_NODE, gpios);
 
-void sd_writer_work_handler(struct k_work *work)
+/**
+ * @brief Power the card up and mount it, taking card_mutex.
+ */
+static int card_mount(void)
 {
-    LOG_INF("Flush to SD started");
+    k_mutex_lock(&card_mutex, K_FOREVER);
 
     gpio_pin_set_dt(&ls_sdcard, 1);
     k_sleep(K_MSEC(25));
@@ -47,6 +104,107 @@ void sd_writer_work_handler(struct k_work *work)
 	int res = fs_mount(&mp);
 	if (res != 0) {
         LOG_ERR("Failed to mount: %d", res);
+        gpio_pin_set_dt(&ls_sdcard, 0);
+        k_mutex_unlock(&card_mutex);
+    }
+
+    return res;
+}
+
+static void card_unmount(void)
+{
+	int res = fs_unmount(&mp);
+    if (res != 0) {
+        LOG_ERR("Error unmounting disk: %d", res);
+    }
+    k_sleep(K_MSEC(25));
+    gpio_pin_set_dt(&ls_sdcard, 0);
+
+    k_mutex_unlock(&card_mutex);
+}
+
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+/**
+ * @brief Append the index entries completed in the flushed buffer.
+ *
+ * @param entries  Entries of the flushed buffer.
+ * @param count    Number of entries.
+ * @param delta    Offset in the log of the first byte submitted since boot.
+ */
+static void index_write(const struct index_entry *entries, size_t count,
+                        int64_t delta)
+{
+    struct fs_file_t file;
+    uint8_t entry[INDEX_ENTRY_LEN];
+
+    if (count == 0) {
+        return;
+    }
+
+    fs_file_t_init(&file);
+
+    int res = fs_open(&file, INDEX_FILE_NAME,
+                      FS_O_CREATE | FS_O_WRITE | FS_O_APPEND);
+    if (res != 0) {
+        LOG_ERR("Failed to open index: %d", res);
+        return;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        sys_put_le32(entries[i].offset + delta, &entry[0]);
+        sys_put_le32(entries[i].len, &entry[4]);
+        sys_put_le64(entries[i].min_ms, &entry[8]);
+        sys_put_le64(entries[i].max_ms, &entry[16]);
+
+        res = fs_write(&file, entry, sizeof(entry));
+        if (res < 0) {
+            LOG_ERR("Failed to write index: %d", res);
+            break;
+        }
+    }
+
+    res = fs_close(&file);
+    if (res != 0) {
+        LOG_ERR("Failed to close index: %d", res);
+    }
+}
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+
+/**
+ * @brief Let the buffers be swapped again once a flush is over.
+ */
+static void flush_end(void)
+{
+    k_mutex_lock(&buf_mutex, K_FOREVER);
+
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+    index_flush_len = 0;
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+    flush_busy = false;
+    k_condvar_broadcast(&flush_done);
+
+    k_mutex_unlock(&buf_mutex);
+}
+
+void sd_writer_work_handler(struct k_work *work)
+{
+    LOG_INF("Flush to SD started");
+
+    /* Submitters only swap the buffers while no flush is busy, but the
+     * state is still read under the lock */
+    k_mutex_lock(&buf_mutex, K_FOREVER);
+    const char *buf = flush_buf;
+    size_t len = flush_len;
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+    const struct index_entry *entries = index_flush;
+    size_t entry_count = index_flush_len;
+    uint64_t start = flush_start;
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+    k_mutex_unlock(&buf_mutex);
+
+	int res = card_mount();
+	if (res != 0) {
+        flush_end();
         return;
     }
 
@@ -59,57 +217,326 @@ void sd_writer_work_handler(struct k_work *work)
         goto unmount;
     }
 
-    size_t len = strnlen(flush_buf, BUFFER_SIZE);
-    res = fs_write(&file, flush_buf, len);
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+    /* Index entries are kept in bytes submitted since boot until the log
+     * size is known here */
+    int64_t delta = -1;
+    if (fs_seek(&file, 0, FS_SEEK_END) == 0) {
+        delta = fs_tell(&file) - (int64_t)start;
+    }
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+
+    res = fs_write(&file, buf, len);
     if (res < 0) {
         LOG_ERR("Failed to write to file: %d", res);
     }
 
     /* Note that fs_close() calls fs_sync() to flush caches */
-    res = fs_close(&file);
-	if (res != 0) {
-		LOG_ERR("Failed to close file: %d", res);
+    int close_res = fs_close(&file);
+	if (close_res != 0) {
+		LOG_ERR("Failed to close file: %d", close_res);
     }
 
-unmount:
-	fs_unmount(&mp);
-    if (res != 0) {
-        LOG_ERR("Error unmounting disk: %d", res);
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+    /* Otherwise the entries may not match the log, so the records are left
+     * for readers to find by scanning */
+    if (res == (int)len && delta >= 0) {
+        index_write(entries, entry_count, delta);
     }
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+
+unmount:
+    card_unmount();
+    flush_end();
     LOG_INF("Flush to SD done. Powering down.");
-    k_sleep(K_MSEC(25));
-    gpio_pin_set_dt(&ls_sdcard, 0);
 }
 
-int sd_card_submit_line(const char *line, size_t line_len, k_timeout_t timeout)
+/**
+ * @brief Make room for len bytes in the active buffer, swapping it out to
+ *        be flushed if it is too full. Called with buf_mutex held.
+ *
+ * If the other buffer is still being flushed, waits for it until the
+ * timeout.
+ *
+ * @return 0 on success, or -EAGAIN if the flush did not end in time.
+ */
+static int buffer_reserve(size_t len, k_timeout_t timeout)
 {
-    int err = k_mutex_lock(&buf_mutex, timeout);
-    if (err != 0) {
-        LOG_ERR("Failed to acquire SD card mutex: %d", err);
-        return err;
+    k_timepoint_t end = sys_timepoint_calc(timeout);
+
+    while (flush_busy && active_pos + len >= BUFFER_SIZE) {
+        int err = k_condvar_wait(&flush_done, &buf_mutex,
+                                 sys_timepoint_timeout(end));
+        if (err != 0) {
+            return -EAGAIN;
+        }
     }
 
-    if (active_pos + line_len >= BUFFER_SIZE) {
-        /* Null terminate active buffer then swap it out */
-        active_buf[active_pos] = '\0';
+    if (active_pos + len >= BUFFER_SIZE) {
+        /* Swap the active buffer out, records may be binary so the length
+         * is kept rather than a terminator */
+        flush_len = active_pos;
         char *tmp = active_buf;
         active_buf = flush_buf;
         flush_buf = tmp;
         active_pos = 0;
+
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+        flush_start = submitted - flush_len;
+
+        struct index_entry *entries = index_active;
+        index_active = index_flush;
+        index_flush = entries;
+        index_flush_len = index_active_len;
+        index_active_len = 0;
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+
+        flush_busy = true;
         k_work_submit(&sd_card_writer_work);
     }
 
-    memcpy(&active_buf[active_pos], line, line_len);
-    active_pos += line_len;
+    return 0;
+}
+
+static void buffer_append(const void *data, size_t len)
+{
+    memcpy(&active_buf[active_pos], data, len);
+    active_pos += len;
+
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+    submitted += len;
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+}
+
+int sd_card_submit(const void *data, size_t len, k_timeout_t timeout)
+{
+    /* Anything longer would not fit even an empty buffer */
+    if (len >= BUFFER_SIZE) {
+        return -EINVAL;
+    }
+
+    int err = k_mutex_lock(&buf_mutex, timeout);
+    if (err != 0) {
+        LOG_ERR("Failed to acquire SD card mutex: %d", err);
+        return err;
+    }
+
+    err = buffer_reserve(len, timeout);
+    if (err == 0) {
+        buffer_append(data, len);
+    } else {
+        LOG_WRN("SD card buffer still being flushed");
+    }
+
+    k_mutex_unlock(&buf_mutex);
+
+    return err;
+}
+
+int sd_card_submit_line(const char *line, size_t line_len, k_timeout_t timeout)
+{
+    return sd_card_submit(line, line_len, timeout);
+}
+
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+int sd_card_submit_record(const void *data, size_t len, int64_t time_ms,
+                          k_timeout_t timeout)
+{
+    uint8_t header[RECORD_HEADER_LEN];
+
+    if (len > SD_CARD_RECORD_MAX_LEN) {
+        return -EINVAL;
+    }
+
+    header[0] = RECORD_MAGIC;
+    sys_put_le16(len, &header[1]);
+
+    int err = k_mutex_lock(&buf_mutex, timeout);
+    if (err != 0) {
+        LOG_ERR("Failed to acquire SD card mutex: %d", err);
+        return err;
+    }
+
+    /* The header and payload are kept in one buffer */
+    err = buffer_reserve(sizeof(header) + len, timeout);
+    if (err != 0) {
+        LOG_WRN("SD card buffer still being flushed");
+        k_mutex_unlock(&buf_mutex);
+        return err;
+    }
+
+    if (block_records == 0) {
+        block.offset = submitted;
+        block.min_ms = time_ms;
+        block.max_ms = time_ms;
+    } else {
+        block.min_ms = MIN(block.min_ms, time_ms);
+        block.max_ms = MAX(block.max_ms, time_ms);
+    }
+
+    buffer_append(header, sizeof(header));
+    buffer_append(data, len);
+
+    if (++block_records == CONFIG_SD_CARD_WRITER_INDEX_INTERVAL) {
+        block.len = submitted - block.offset;
+        block_records = 0;
+
+        if (index_active_len < INDEX_PENDING_MAX) {
+            index_active[index_active_len++] = block;
+        } else {
+            LOG_WRN("Index entry dropped");
+        }
+    }
 
     k_mutex_unlock(&buf_mutex);
 
     return 0;
 }
 
+/**
+ * @brief Pass the records found between two offsets of the log to cb.
+ *
+ * Bytes that do not start a whole, valid record, such as those of a
+ * record cut short by a reset, are skipped until the next record marker.
+ *
+ * @return 0 when the end is reached, 1 if cb asked to stop, or a negative
+ *         error code.
+ */
+static int scan_records(struct fs_file_t *file, off_t from, off_t to,
+                        sd_card_record_cb_t cb, void *user_data,
+                        size_t *count)
+{
+    uint8_t header[RECORD_HEADER_LEN];
+    off_t pos = from;
+
+    while (pos + RECORD_HEADER_LEN <= to) {
+        int res = fs_seek(file, pos, FS_SEEK_SET);
+        if (res != 0) {
+            return res;
+        }
+
+        ssize_t n = fs_read(file, header, sizeof(header));
+        if (n < 0) {
+            return n;
+        }
+
+        size_t len = sys_get_le16(&header[1]);
+
+        if (n != sizeof(header) || header[0] != RECORD_MAGIC ||
+            len > sizeof(read_buf) || pos + RECORD_HEADER_LEN + len > to) {
+            pos++;
+            continue;
+        }
+
+        n = fs_read(file, read_buf, len);
+        if (n < 0) {
+            return n;
+        }
+        if (n != len) {
+            pos++;
+            continue;
+        }
+
+        int ret = cb(read_buf, len, user_data);
+        if (ret == -EBADMSG) {
+            pos++;
+            continue;
+        }
+
+        (*count)++;
+        if (ret != 0) {
+            return 1;
+        }
+
+        pos += RECORD_HEADER_LEN + len;
+    }
+
+    return 0;
+}
+
+int sd_card_read_records(int64_t start_ms, int64_t end_ms,
+                         sd_card_record_cb_t cb, void *user_data)
+{
+    struct fs_file_t log;
+    struct fs_file_t index;
+    struct fs_dirent entry;
+    uint8_t raw[INDEX_ENTRY_LEN];
+    size_t count = 0;
+    off_t pos = 0;
+
+    if (cb == NULL || start_ms > end_ms) {
+        return -EINVAL;
+    }
+
+    int res = card_mount();
+    if (res != 0) {
+        return res;
+    }
+
+    res = fs_stat(FILE_NAME, &entry);
+    if (res != 0) {
+        goto unmount;
+    }
+
+    off_t log_size = entry.size;
+
+    fs_file_t_init(&log);
+    res = fs_open(&log, FILE_NAME, FS_O_READ);
+    if (res != 0) {
+        LOG_ERR("Failed to open file: %d", res);
+        goto unmount;
+    }
+
+    /* Without an index, the whole log is scanned */
+    fs_file_t_init(&index);
+    bool indexed = fs_open(&index, INDEX_FILE_NAME, FS_O_READ) == 0;
+
+    while (res == 0 && indexed &&
+           fs_read(&index, raw, sizeof(raw)) == sizeof(raw)) {
+        off_t offset = sys_get_le32(&raw[0]);
+        off_t len = sys_get_le32(&raw[4]);
+        int64_t min_ms = sys_get_le64(&raw[8]);
+        int64_t max_ms = sys_get_le64(&raw[16]);
+
+        /* Entries that overlap ones before them or run past the end of
+         * the log do not describe it, and are skipped */
+        if (offset < pos || offset + len > log_size) {
+            continue;
+        }
+
+        /* Records between blocks, such as those of a block left unfinished
+         * by a reset, are not indexed */
+        res = scan_records(&log, pos, offset, cb, user_data, &count);
+
+        if (res == 0 && min_ms <= end_ms && max_ms >= start_ms) {
+            res = scan_records(&log, offset, offset + len, cb, user_data,
+                               &count);
+        }
+
+        pos = offset + len;
+    }
+
+    if (res == 0) {
+        res = scan_records(&log, pos, log_size, cb, user_data, &count);
+    }
+
+    if (indexed) {
+        fs_close(&index);
+    }
+    fs_close(&log);
+
+unmount:
+    card_unmount();
+
+    return res < 0 ? res : count;
+}
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
+
 int sd_writer_init(void)
 {
     k_mutex_init(&buf_mutex);
+    k_condvar_init(&flush_done);
+    k_mutex_init(&card_mutex);
     k_work_init(&sd_card_writer_work, sd_writer_work_handler);
 
     return 0;
@@ -5,9 +5,80 @@
 
 #include <zephyr/kernel.h>
 
-void sd_card_submit_line(const char *line,
-                         size_t line_len,
-                         k_timeout_t timeout);
+/* Size of each of the two log buffers. Submissions must be shorter. */
+#define SD_CARD_BUFFER_SIZE 1024
+
+int sd_card_submit_line(const char *line,
+                        size_t line_len,
+                        k_timeout_t timeout);
+
+/* Append binary data to the log. The data is written as is, so records
+ * must carry their own framing. Returns -EINVAL if len is not less than
+ * SD_CARD_BUFFER_SIZE, or -EAGAIN if the buffer is full and the previous one
+ * is still being written when the timeout expires. */
+int sd_card_submit(const void *data,
+                   size_t len,
+                   k_timeout_t timeout);
+
+#ifdef CONFIG_SD_CARD_WRITER_INDEX
+/* Largest record payload that sd_card_submit_record() accepts */
+#define SD_CARD_RECORD_MAX_LEN 255
+
+/**
+ * @brief Append a record to the log and to its time index.
+ *
+ * The record is framed with a 0xdb marker and its length (uint16, little
+ * endian). Every CONFIG_SD_CARD_WRITER_INDEX_INTERVAL records, an entry is
+ * added to the index file giving the offset and length of those records in
+ * the log and the earliest and latest of their times.
+ *
+ * Records must only be submitted from one thread.
+ *
+ * @param data     Record payload.
+ * @param len      Length of the payload, up to SD_CARD_RECORD_MAX_LEN.
+ * @param time_ms  Time of the record, used to index it.
+ * @param timeout  Time to wait for the log buffer.
+ *
+ * @return 0 on success, -EINVAL if the record is too long, or the error
+ *         from waiting for the log buffer or for its previous flush.
+ */
+int sd_card_submit_record(const void *data,
+                          size_t len,
+                          int64_t time_ms,
+                          k_timeout_t timeout);
+
+/**
+ * @brief Called for each record read from the log.
+ *
+ * @return 0 to carry on reading, -EBADMSG if the data is not a valid
+ *         record, in which case reading resumes from the next record
+ *         marker after its start, or anything else to stop.
+ */
+typedef int (*sd_card_record_cb_t)(const uint8_t *data, size_t len,
+                                   void *user_data);
+
+/**
+ * @brief Read the records of the log that may fall within a time range.
+ *
+ * Only the blocks of records whose indexed times overlap the range are
+ * read, along with any records the index does not cover, such as those
+ * written since the last index entry. The callback is passed each of
+ * them in log order, and must check the time of the record itself.
+ * Records still buffered in RAM are not read.
+ *
+ * @param start_ms   Start of the range.
+ * @param end_ms     End of the range, inclusive.
+ * @param cb         Called for each record.
+ * @param user_data  Passed to the callback.
+ *
+ * @return Number of valid records passed to the callback, or a negative
+ *         error code if the card or log could not be read.
+ */
+int sd_card_read_records(int64_t start_ms,
+                         int64_t end_ms,
+                         sd_card_record_cb_t cb,
+                         void *user_data);
+#endif /* CONFIG_SD_CARD_WRITER_INDEX */
 
 int sd_writer_init(void);
 
@@ -29,9 +29,11 @@ const struct device *adc1 = DEVICE_DT_GET(ADC1_NODE);
 static struct k_work_delayable adcs_poll_work;
 static atomic_t poll_interval_ms = 3000;
 
-static const char *adc_label_table[2][4] = {
-    {"adc0_0", "adc0_1", "adc0_2", "adc0_3"},
-    {"adc1_0", "adc1_1", "adc1_2", "adc1_3"},
+static const enum datapoint_sensor adc_sensor_table[2][4] = {
+    {DATAPOINT_SENSOR_ADC0_0, DATAPOINT_SENSOR_ADC0_1,
+     DATAPOINT_SENSOR_ADC0_2, DATAPOINT_SENSOR_ADC0_3},
+    {DATAPOINT_SENSOR_ADC1_0, DATAPOINT_SENSOR_ADC1_1,
+     DATAPOINT_SENSOR_ADC1_2, DATAPOINT_SENSOR_ADC1_3},
 };
 
 void poll_ads1015(const struct device *adc, int adc_num)
@@ -117,7 +119,7 @@ void poll_ads1015(const struct device *adc, int adc_num)
                                         adc_cfg.gain,
                                         ADC_SEQUENCE_RESOLUTION_SE,
                                         &val_mv[idx]);
-            submit_int_datapoint(val_mv[idx], adc_label_table[adc_num][chan], "mV");
+            submit_int_datapoint(val_mv[idx], adc_sensor_table[adc_num][chan]);
             LOG_INF("  Sequence[%d]: %" PRIu32 " mv", idx, val_mv[idx]);
         }
     }
@@ -3,7 +3,9 @@
 #include <nrf_modem_gnss.h>
 #include <modem/lte_lc.h>
 #include <modem/nrf_modem_lib.h>
+#include <zephyr/sys/timeutil.h>
 
+#include <datapoint_clock.h>
 #include <datapoint_helpers.h>
 
 LOG_MODULE_REGISTER(gnss, CONFIG_SENSE_CORE_SENSOR_GNSS_LOG_LEVEL);
@@ -139,14 +141,31 @@ static void log_satellite_stats(struct nrf_modem_gnss_pvt_data_frame *pvt_data)
             tracked, in_fix, unhealthy);
 }
 
+static void sync_datapoint_clock(const struct nrf_modem_gnss_datetime *datetime)
+{
+    struct tm tm = {
+        .tm_year = datetime->year - 1900,
+        .tm_mon = datetime->month - 1,
+        .tm_mday = datetime->day,
+        .tm_hour = datetime->hour,
+        .tm_min = datetime->minute,
+        .tm_sec = datetime->seconds,
+    };
+
+    datapoint_clock_sync(timeutil_timegm64(&tm) * MSEC_PER_SEC + datetime->ms);
+}
+
 static void process_fix_data(struct nrf_modem_gnss_pvt_data_frame *pvt_data)
 {
+    /* A fix carries UTC, so use it to timestamp datapoints */
+    sync_datapoint_clock(&pvt_data->datetime);
+
     /* Push PVT data to system state struct */
-    submit_float_datapoint(pvt_data->latitude, "gnss_lat", "deg");
-    submit_float_datapoint(pvt_data->longitude, "gnss_long", "deg");
-    submit_float_datapoint((double)pvt_data->accuracy, "gnss_accuracy", "m");
-    submit_float_datapoint((double)pvt_data->altitude, "gnss_alt", "m");
-    submit_float_datapoint((double)pvt_data->altitude_accuracy, "gnss_alt_accuracy", "m");
+    submit_e7_datapoint(pvt_data->latitude, DATAPOINT_SENSOR_GNSS_LAT);
+    submit_e7_datapoint(pvt_data->longitude, DATAPOINT_SENSOR_GNSS_LONG);
+    submit_float_datapoint((double)pvt_data->accuracy, DATAPOINT_SENSOR_GNSS_ACCURACY);
+    submit_float_datapoint((double)pvt_data->altitude, DATAPOINT_SENSOR_GNSS_ALT);
+    submit_float_datapoint((double)pvt_data->altitude_accuracy, DATAPOINT_SENSOR_GNSS_ALT_ACCURACY);
 
     LOG_INF("Latitude           %.06f", pvt_data->latitude);
     LOG_INF("Longitude:         %.06f", pvt_data->longitude);
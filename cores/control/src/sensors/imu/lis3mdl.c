@@ -28,24 +28,21 @@ void lis3mdl_poll_work_handler(struct k_work *work)
 
     err = get_and_submit_sensor_datapoint(lis3mdl,
                                         SENSOR_CHAN_MAGN_X,
-                                        "lis3mdl_mag_x",
-                                        "G");
+                                        DATAPOINT_SENSOR_LIS3MDL_MAG_X);
     if (err != 0) {
         LOG_ERR("Failed to get magnetometer X from LIS3MDL");
     }
 
     err = get_and_submit_sensor_datapoint(lis3mdl,
                                         SENSOR_CHAN_MAGN_Y,
-                                        "lis3mdl_mag_y",
-                                        "G");
+                                        DATAPOINT_SENSOR_LIS3MDL_MAG_Y);
     if (err != 0) {
         LOG_ERR("Failed to get magnetometer Y from LIS3MDL");
     }
 
     err = get_and_submit_sensor_datapoint(lis3mdl,
                                         SENSOR_CHAN_MAGN_Z,
-                                        "lis3mdl_mag_z",
-                                        "G");
+                                        DATAPOINT_SENSOR_LIS3MDL_MAG_Z);
     if (err != 0) {
         LOG_ERR("Failed to get magnetometer Z from LIS3MDL");
     }
@@ -54,24 +54,21 @@ void lsm6dso_poll_work_handler(struct k_work *work)
 
     err = get_and_submit_sensor_datapoint(lsm6dso,
                                           SENSOR_CHAN_ACCEL_X,
-                                          "lsm6dso_accel_x",
-                                          "m/s^2");
+                                          DATAPOINT_SENSOR_LSM6DSO_ACCEL_X);
     if (err != 0) {
         LOG_ERR("Failed to get accelerometer X from LSM6DSO");
     }
 
     err = get_and_submit_sensor_datapoint(lsm6dso,
                                           SENSOR_CHAN_ACCEL_Y,
-                                          "lsm6dso_accel_y",
-                                          "m/s^2");
+                                          DATAPOINT_SENSOR_LSM6DSO_ACCEL_Y);
     if (err != 0) {
         LOG_ERR("Failed to get accelerometer Y from LSM6DSO");
     }
 
     err = get_and_submit_sensor_datapoint(lsm6dso,
                                           SENSOR_CHAN_ACCEL_Z,
-                                          "lsm6dso_accel_z",
-                                          "m/s^2");
+                                          DATAPOINT_SENSOR_LSM6DSO_ACCEL_Z);
     if (err != 0) {
         LOG_ERR("Failed to get accelerometer Z from LSM6DSO");
     }
@@ -85,24 +82,21 @@ gyro:
 
     err = get_and_submit_sensor_datapoint(lsm6dso,
                                           SENSOR_CHAN_GYRO_X,
-                                          "lsm6dso_gyro_x",
-                                          "rad/s");
+                                          DATAPOINT_SENSOR_LSM6DSO_GYRO_X);
     if (err != 0) {
         LOG_ERR("Failed to get gyroscope X from LSM6DSO");
     }
 
     err = get_and_submit_sensor_datapoint(lsm6dso,
                                           SENSOR_CHAN_GYRO_Y,
-                                          "lsm6dso_gyro_y",
-                                          "rad/s");
+                                          DATAPOINT_SENSOR_LSM6DSO_GYRO_Y);
     if (err != 0) {
         LOG_ERR("Failed to get gyroscope Y from LSM6DSO");
     }
 
     err = get_and_submit_sensor_datapoint(lsm6dso,
                                           SENSOR_CHAN_GYRO_Z,
-                                          "lsm6dso_gyro_z",
-                                          "rad/s");
+                                          DATAPOINT_SENSOR_LSM6DSO_GYRO_Z);
     if (err != 0) {
         LOG_ERR("Failed to get gyroscope Z from LSM6DSO");
     }
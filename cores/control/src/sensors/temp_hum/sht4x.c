@@ -30,16 +30,14 @@ void sht4x_poll_work_handler(struct k_work *work)
 
     err = get_and_submit_sensor_datapoint(sht4x,
                                         SENSOR_CHAN_AMBIENT_TEMP,
-                                        "sht4x_temp",
-                                        "deg C");
+                                        DATAPOINT_SENSOR_SHT4X_TEMP);
     if (err != 0) {
         LOG_ERR("Failed to get temperature from SHT4X");
     }
 
     err = get_and_submit_sensor_datapoint(sht4x,
                                         SENSOR_CHAN_HUMIDITY,
-                                        "sht4x_hum",
-                                        "%");
+                                        DATAPOINT_SENSOR_SHT4X_HUM);
     if (err != 0) {
         LOG_ERR("Failed to get humidity from SHT4X");
     }
@@ -8,6 +8,13 @@ enum command_type {
     CMD_NONE_AVAILABLE = 0,
     CMD_SET_POLL_RATE,
     CMD_SET_RAIL_STATE,
+    /* Target is a sensor ID from the datapoint sensor registry, 'i' the
+     * window in seconds, 0 to send every datapoint */
+    CMD_SET_AGGREGATE_WINDOW,
+    /* Target is a sensor ID from the datapoint sensor registry, 'f' the
+     * absolute deadband, 'p' the deadband in percent and 'i' the heartbeat
+     * in seconds. Fields left out keep their current value. */
+    CMD_SET_DEADBAND,
     CMD_TYPE_UNKNOWN
 };
 
@@ -9,7 +9,9 @@
  * Represents the state of the cellular subsystem. Can be used to check if
  * the module is operational or in an error state.
  *
- * Each of the *_ERROR states indicate that the cellular module has stopped.
+ * Each of the *_ERROR states indicate that the last connection attempt
+ * failed. The cellular module retries with exponential backoff, moving to
+ * CELLULAR_STATE_RECONNECTING for each new attempt.
  */
  typedef enum cellular_state {
     CELLULAR_STATE_UNINITIALISED = 0,   /**< Module not initialised */
@@ -18,18 +20,113 @@
     CELLULAR_STATE_BACKEND_ERROR,       /**< Backend error */
     CELLULAR_STATE_SOCKET_ERROR,        /**< Socket error */
     CELLULAR_STATE_REMOTE_SERVER_ERROR, /**< Remote server error */
+    CELLULAR_STATE_RECONNECTING,        /**< Link lost, reconnecting */
     CELLULAR_STATE_UNDEFINED,           /**< Unknown state */
 } cellular_state_t;
 
-/* Callback type for handling received packets */
+/**
+ * @brief Uplink traffic classes.
+ *
+ * Each class has its own packet pool and queue. Queued control packets are
+ * always sent before any telemetry.
+ */
+enum cellular_priority {
+    CELLULAR_PRIORITY_CONTROL,   /**< Command polls and acknowledgements */
+    CELLULAR_PRIORITY_TELEMETRY, /**< Bulk datapoint uplink */
+    CELLULAR_PRIORITY_COUNT,
+};
+
+/**
+ * @brief Classes of uplink and socket errors counted by the statistics.
+ */
+enum cellular_error_class {
+    CELLULAR_ERROR_WOULD_BLOCK, /**< Send deferred by a full socket */
+    CELLULAR_ERROR_SEND,        /**< Socket send failure */
+    CELLULAR_ERROR_RECV,        /**< Socket receive failure */
+    CELLULAR_ERROR_QUEUE_FULL,  /**< Uplink queue full */
+    CELLULAR_ERROR_NO_MEMORY,   /**< Uplink pool exhausted */
+    CELLULAR_ERROR_CLASS_COUNT,
+};
+
+/* Callback type for handling received packets. Executed on the system
+ * workqueue; the packet is only valid until the callback returns. */
 typedef void (*cellular_recv_cb_t)(const uint8_t *packet, size_t packet_len);
 
+/* Callback type for cellular state changes. Executed on the cellular thread,
+ * so it must not block. */
+typedef void (*cellular_state_cb_t)(cellular_state_t state);
+
+/**
+ * @brief Uplink buffer lent by the cellular module.
+ *
+ * Obtained with cellular_uplink_claim() and handed back with either
+ * cellular_uplink_commit() or cellular_uplink_abort(). The caller encodes the
+ * packet directly into @p data, avoiding intermediate copies.
+ */
+struct cellular_uplink_buf {
+    uint8_t *data;   /**< Writable packet storage */
+    size_t size;     /**< Capacity of data in bytes */
+    const char *tag; /**< Optional static accounting tag, e.g. the path */
+    void *priv;      /**< Internal packet handle */
+};
+
+/**
+ * @brief Cellular link availability summary.
+ */
+struct cellular_link_status {
+    uint32_t reconnects;     /**< Times the link was re-established */
+    int64_t down_since;      /**< Uptime (ms) the link went down, 0 if up */
+    int64_t last_outage_ms;  /**< Duration of the most recent outage */
+    int64_t total_outage_ms; /**< Cumulative outage duration */
+};
+
+#ifdef CONFIG_CELLULAR_STATS
+
+/**
+ * @brief Traffic counters for a period or tag.
+ */
+struct cellular_traffic {
+    uint32_t tx_bytes;
+    uint32_t tx_packets;
+    uint32_t rx_bytes;
+    uint32_t rx_packets;
+};
+
+/**
+ * @brief Cellular link statistics.
+ *
+ * Hour and day windows are aligned to uptime, not wall-clock time.
+ */
+struct cellular_stats {
+    struct cellular_traffic total;     /**< Since boot or reset */
+    struct cellular_traffic hour;      /**< Current hour */
+    struct cellular_traffic last_hour; /**< Previous hour */
+    struct cellular_traffic day;       /**< Current day */
+    struct cellular_traffic last_day;  /**< Previous day */
+    uint32_t errors[CELLULAR_ERROR_CLASS_COUNT];
+    uint32_t queue_high_water[CELLULAR_PRIORITY_COUNT];
+    int64_t time_in_state_ms[CELLULAR_STATE_UNDEFINED + 1];
+    bool signal_valid; /**< True once the signal has been sampled */
+    int16_t rsrp_dbm;  /**< Last sampled RSRP */
+    int16_t rsrq_db;   /**< Last sampled RSRQ */
+};
+
+/**
+ * @brief Uplink traffic attributed to a tag.
+ */
+struct cellular_tag_stats {
+    const char *tag;
+    struct cellular_traffic traffic;
+};
+
+#endif /* CONFIG_CELLULAR_STATS */
+
 /**
  * @brief Initialise the cellular module.
  *
  * Initialises the cellular module, enabling it to send and receive packets
  * to and from a remote server. Incoming packets are delivered to the provided
- * callback function.
+ * callback function from the system workqueue, in the order received.
  *
  * @param[in] cb  Callback function to handle received packets.
  *
@@ -51,6 +148,41 @@ int cellular_init(cellular_recv_cb_t cb);
  */
 int cellular_send_packet(const uint8_t *packet, size_t packet_len);
 
+/**
+ * @brief Borrow an uplink buffer to encode a packet into.
+ *
+ * The claimed size is reserved from the uplink pool until the buffer is
+ * committed, at which point any unused bytes are returned to the pool.
+ *
+ * @param[out] buf       Buffer descriptor to populate.
+ * @param[in]  size      Maximum number of bytes the caller intends to write.
+ * @param[in]  priority  Traffic class the packet is queued under.
+ *
+ * @return 0 on success, -EINVAL if size is invalid, or negative error code
+ *         if no buffer is available.
+ */
+int cellular_uplink_claim(struct cellular_uplink_buf *buf, size_t size,
+                          enum cellular_priority priority);
+
+/**
+ * @brief Queue a claimed uplink buffer for transmission.
+ *
+ * Ownership of the buffer returns to the cellular module, even on failure.
+ *
+ * @param[in] buf  Buffer previously obtained from cellular_uplink_claim().
+ * @param[in] len  Number of bytes written to the buffer.
+ *
+ * @return 0 on success, negative value on error.
+ */
+int cellular_uplink_commit(struct cellular_uplink_buf *buf, size_t len);
+
+/**
+ * @brief Return a claimed uplink buffer without sending it.
+ *
+ * @param[in] buf  Buffer previously obtained from cellular_uplink_claim().
+ */
+void cellular_uplink_abort(struct cellular_uplink_buf *buf);
+
 /**
  * @brief Get the current state of the cellular module.
  *
@@ -60,6 +192,56 @@ int cellular_send_packet(const uint8_t *packet, size_t packet_len);
  */
 cellular_state_t cellular_state_get(void);
 
+/**
+ * @brief Subscribe to cellular state changes.
+ *
+ * The callback is invoked each time the cellular state changes. Subscribers
+ * cannot be removed.
+ *
+ * @param[in] cb  Callback function invoked with the new state.
+ *
+ * @return 0 on success, -EINVAL if cb is NULL, -ENOMEM if the subscriber
+ *         table is full.
+ */
+int cellular_state_subscribe(cellular_state_cb_t cb);
+
+/**
+ * @brief Get the link availability summary.
+ *
+ * @param[out] status  Destination for the link status.
+ */
+void cellular_link_status_get(struct cellular_link_status *status);
+
+#ifdef CONFIG_CELLULAR_STATS
+
+/**
+ * @brief Get a snapshot of the link statistics.
+ *
+ * @param[out] stats  Destination for the statistics.
+ */
+void cellular_stats_get(struct cellular_stats *stats);
+
+/**
+ * @brief Get the uplink traffic for a tag.
+ *
+ * Tags are recorded in the order first seen. Untagged traffic, and traffic
+ * once CONFIG_CELLULAR_STATS_MAX_TAGS tags are in use, is reported under
+ * "other". Received traffic is not attributed to tags.
+ *
+ * @param[in]  index  Index of the tag, starting at 0.
+ * @param[out] stats  Destination for the tag statistics.
+ *
+ * @return 0 on success, -ENOENT if there is no tag at index.
+ */
+int cellular_stats_tag_get(size_t index, struct cellular_tag_stats *stats);
+
+/**
+ * @brief Clear all link statistics.
+ */
+void cellular_stats_reset(void);
+
+#endif /* CONFIG_CELLULAR_STATS */
+
 #endif /* CONFIG_CELLULAR */
 
 #endif /* LIB_CELLULAR_H_ */
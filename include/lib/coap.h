@@ -7,14 +7,14 @@
 #include <zephyr/net/coap.h>
 
 /**
- * @brief Build a simple NON-CON CoAP request.
+ * @brief Build a simple CoAP request.
  *
  * This function builds a CoAP message in the provided buffer using the given
  *  parameters.
  *
  * @param buf          Destination buffer to write the encoded CoAP message.
  * @param buf_len      Length of the destination buffer.
- * @param type         CoAP message type. Must be COAP_TYPE_NON_CON.
+ * @param type         CoAP message type. COAP_TYPE_NON_CON or COAP_TYPE_CON.
  * @param method       CoAP method code (COAP_METHOD_GET, PUT, POST, DELETE).
  * @param uri_path     NULL-terminated array of URI path components. Can be NULL.
  * @param payload      Payload pointer. Can be NULL if no payload.
@@ -28,6 +28,337 @@ int coap_build_request(uint8_t *buf, size_t buf_len,
                        const char * const *uri_path,
                        const uint8_t *payload, size_t payload_len);
 
+/**
+ * @brief Build the header of a CoAP request.
+ *
+ * Encodes the CoAP header, token and URI path options into the provided
+ * buffer, followed by the payload marker if a payload follows. The caller
+ * then encodes the payload directly after the returned length, avoiding an
+ * intermediate payload buffer.
+ *
+ * @param buf              Destination buffer to write the CoAP header.
+ * @param buf_len          Length of the destination buffer.
+ * @param type             CoAP message type. COAP_TYPE_NON_CON or COAP_TYPE_CON.
+ * @param method           CoAP method code (COAP_METHOD_GET, PUT, POST, DELETE).
+ * @param uri_path         NULL-terminated array of URI path components. Can be NULL.
+ * @param payload_follows  Append the payload marker. The caller must then
+ *                         write a non-empty payload.
+ *
+ * @return >0 on success (number of bytes used), or negative errno code on failure.
+ */
+int coap_build_request_header(uint8_t *buf, size_t buf_len,
+                              enum coap_msgtype type,
+                              enum coap_method method,
+                              const char * const *uri_path,
+                              bool payload_follows);
+
+/**
+ * @brief Pre-encoded request for a fixed method and URI path.
+ *
+ * Holds the encoded option block so that building a request only patches in
+ * the header, message ID and token.
+ */
+struct coap_request_template {
+    uint8_t type;
+    uint8_t method;
+    uint16_t options_len;
+    uint8_t options[CONFIG_COAP_TEMPLATE_MAX_OPTIONS_LEN];
+};
+
+/**
+ * @brief Encode a request template.
+ *
+ * @param tpl       Template to initialise.
+ * @param type      CoAP message type. COAP_TYPE_NON_CON or COAP_TYPE_CON.
+ * @param method    CoAP method code (COAP_METHOD_GET, PUT, POST, DELETE).
+ * @param uri_path  NULL-terminated array of URI path components. Can be NULL.
+ *
+ * @return 0 on success, or negative errno code on failure.
+ */
+int coap_template_init(struct coap_request_template *tpl,
+                       enum coap_msgtype type,
+                       enum coap_method method,
+                       const char * const *uri_path);
+
+/**
+ * @brief Encode an Observe (RFC 7641) registration template.
+ *
+ * The template describes a NON-CON GET carrying the Observe option.
+ *
+ * @param tpl       Template to initialise.
+ * @param uri_path  NULL-terminated array of URI path components. Can be NULL.
+ * @param observe   0 to register, 1 to deregister.
+ *
+ * @return 0 on success, or negative errno code on failure.
+ */
+int coap_template_init_observe(struct coap_request_template *tpl,
+                               const char * const *uri_path,
+                               uint32_t observe);
+
+/**
+ * @brief Build a request header from a template.
+ *
+ * Equivalent to coap_build_request_header() with the template's parameters,
+ * using a fresh message ID and token.
+ *
+ * @param tpl              Template from coap_template_init().
+ * @param buf              Destination buffer to write the CoAP header.
+ * @param buf_len          Length of the destination buffer.
+ * @param payload_follows  Append the payload marker. The caller must then
+ *                         write a non-empty payload.
+ *
+ * @return >0 on success (number of bytes used), or negative errno code on failure.
+ */
+int coap_template_build(const struct coap_request_template *tpl,
+                        uint8_t *buf, size_t buf_len,
+                        bool payload_follows);
+
+/**
+ * @brief Build a request header from a template with a caller-chosen token.
+ *
+ * Used where requests must share a token, such as Observe re-registration.
+ *
+ * @param tpl              Template from coap_template_init().
+ * @param token            COAP_TOKEN_MAX_LEN byte token.
+ * @param buf              Destination buffer to write the CoAP header.
+ * @param buf_len          Length of the destination buffer.
+ * @param payload_follows  Append the payload marker.
+ *
+ * @return >0 on success (number of bytes used), or negative errno code on failure.
+ */
+int coap_template_build_token(const struct coap_request_template *tpl,
+                              const uint8_t *token,
+                              uint8_t *buf, size_t buf_len,
+                              bool payload_follows);
+
+#ifdef CONFIG_COAP_CON
+
+/** @brief Outcome of a confirmable message. */
+enum coap_con_result {
+    COAP_CON_DELIVERED, /**< Acknowledged by the peer */
+    COAP_CON_RESET,     /**< Rejected by the peer with a RST */
+    COAP_CON_TIMEOUT,   /**< Retransmissions exhausted */
+};
+
+/* Transport used to send and retransmit confirmable messages */
+typedef int (*coap_con_send_t)(const uint8_t *buf, size_t len);
+
+/* Callback type for confirmable message outcomes. Executed on the system
+ * workqueue or the context calling coap_con_handle_message(). */
+typedef void (*coap_con_cb_t)(uint16_t msg_id, enum coap_con_result result,
+                              void *user_data);
+
+/**
+ * @brief Register the transport for confirmable messages.
+ *
+ * @param send  Function used to send and retransmit messages.
+ *
+ * @return 0 on success, -EINVAL if send is NULL.
+ */
+int coap_con_init(coap_con_send_t send);
+
+/**
+ * @brief Send a confirmable message and track its delivery.
+ *
+ * The message is copied into the pending table and sent immediately. It is
+ * retransmitted with exponential backoff until an ACK or RST with a matching
+ * message ID is passed to coap_con_handle_message(), or
+ * CONFIG_COAP_CON_MAX_RETRANSMIT is reached.
+ *
+ * @param buf        Encoded CoAP message of type COAP_TYPE_CON.
+ * @param len        Length of the message.
+ * @param cb         Callback for the delivery outcome. Can be NULL.
+ * @param user_data  Passed to the callback.
+ *
+ * @return 0 on success, -EINVAL for invalid messages, -ENODEV if no
+ *         transport is registered, -ENOMEM if the pending table is full.
+ */
+int coap_con_send(const uint8_t *buf, size_t len,
+                  coap_con_cb_t cb, void *user_data);
+
+/**
+ * @brief Match a received message against pending confirmable messages.
+ *
+ * Should be called for every received message. A piggybacked response is
+ * still left for the caller to process.
+ *
+ * @param message  Parsed received message.
+ *
+ * @return 0 if the message completed a pending message, -ENOENT if it did
+ *         not, or -EINVAL if message is NULL.
+ */
+int coap_con_handle_message(const struct coap_packet *message);
+
+/**
+ * @brief Get the number of unacknowledged confirmable messages.
+ */
+uint32_t coap_con_pending_count(void);
+
+#endif /* CONFIG_COAP_CON */
+
+#ifdef CONFIG_COAP_BLOCK
+
+/* Transport used to send block-wise requests */
+typedef int (*coap_block_send_t)(const uint8_t *buf, size_t len);
+
+/* Callback type supplying upload data. Must fill exactly len bytes starting
+ * at offset and return len, or a negative errno code to abort the transfer.
+ * Offsets normally advance block by block, but a range can be read again if
+ * the server asks for smaller blocks. */
+typedef int (*coap_block_read_cb_t)(size_t offset, uint8_t *buf, size_t len,
+                                    void *user_data);
+
+/* Callback type consuming downloaded data, called once per block in order.
+ * Return a negative errno code to abort the transfer. */
+typedef int (*coap_block_write_cb_t)(size_t offset, const uint8_t *data,
+                                     size_t len, bool last, void *user_data);
+
+/* Callback type for the transfer outcome. result is 0 on success or a
+ * negative errno code, and code is the CoAP response code of the final
+ * response, or 0 if there was none. */
+typedef void (*coap_block_done_cb_t)(int result, uint8_t code,
+                                     void *user_data);
+
+/* Read, write and done callbacks are executed on the system workqueue or the
+ * context calling coap_block_handle_message(). Read and write callbacks must
+ * not call the coap_block functions. */
+
+/**
+ * @brief Register the transport for block-wise transfers.
+ *
+ * Block sizes are chosen so that a request carrying a block fits in tx_mtu
+ * and a response carrying a block fits in rx_mtu. tx_mtu is capped at
+ * CONFIG_COAP_MAX_MSG_LEN, the size of the buffer kept for each transfer.
+ *
+ * @param send    Function used to send and resend requests.
+ * @param tx_mtu  Largest datagram the transport can send.
+ * @param rx_mtu  Largest datagram the transport can receive.
+ *
+ * @return 0 on success, -EINVAL on invalid arguments.
+ */
+int coap_block_init(coap_block_send_t send, size_t tx_mtu, size_t rx_mtu);
+
+/**
+ * @brief Upload a body with Block1 (RFC 7959) requests.
+ *
+ * The body is read one block at a time as the server acknowledges the
+ * previous block.
+ *
+ * @param method     COAP_METHOD_PUT or COAP_METHOD_POST.
+ * @param uri_path   NULL-terminated array of URI path components. Must remain
+ *                   valid until the transfer completes.
+ * @param total_len  Length of the body in bytes.
+ * @param read       Callback supplying the body.
+ * @param done       Callback for the transfer outcome. Can be NULL.
+ * @param user_data  Passed to the callbacks.
+ *
+ * @return 0 if the transfer started, -EINVAL for invalid arguments, -ENODEV
+ *         if no transport is registered, -EBUSY if all transfer slots are in
+ *         use, -EMSGSIZE if the MTU is too small, or the error returned by
+ *         read for the first block.
+ */
+int coap_block_upload(enum coap_method method, const char * const *uri_path,
+                      size_t total_len, coap_block_read_cb_t read,
+                      coap_block_done_cb_t done, void *user_data);
+
+/**
+ * @brief Download a resource with Block2 (RFC 7959) requests.
+ *
+ * Each block is requested once the previous one has been written.
+ *
+ * @param uri_path   NULL-terminated array of URI path components. Must remain
+ *                   valid until the transfer completes.
+ * @param write      Callback consuming the body.
+ * @param done       Callback for the transfer outcome. Can be NULL.
+ * @param user_data  Passed to the callbacks.
+ *
+ * @return 0 if the transfer started, -EINVAL for invalid arguments, -ENODEV
+ *         if no transport is registered, -EBUSY if all transfer slots are in
+ *         use, or -EMSGSIZE if the MTU is too small.
+ */
+int coap_block_download(const char * const *uri_path,
+                        coap_block_write_cb_t write,
+                        coap_block_done_cb_t done, void *user_data);
+
+/**
+ * @brief Match a received message against active block-wise transfers.
+ *
+ * Should be called for every received message.
+ *
+ * @param response  Parsed received message.
+ *
+ * @return 0 if the message belonged to a transfer, -ENOENT if it did not, or
+ *         -EINVAL if response is NULL.
+ */
+int coap_block_handle_message(const struct coap_packet *response);
+
+/**
+ * @brief Get the number of block-wise transfers in progress.
+ */
+uint32_t coap_block_active_count(void);
+
+#endif /* CONFIG_COAP_BLOCK */
+
+#ifdef CONFIG_COAP_MATCH
+
+/* Keep the token registered after a response, e.g. for Observe
+ * notifications. The entry is removed on expiry or coap_match_cancel(). */
+#define COAP_MATCH_MULTIPLE BIT(0)
+
+/* Callback type for matched responses. result is 0 with the parsed response,
+ * or -ETIMEDOUT with response NULL once the entry expires. The response is
+ * only valid during the callback. Executed on the system workqueue or the
+ * context calling coap_match_handle_message(). */
+typedef void (*coap_match_cb_t)(const struct coap_packet *response,
+                                int result, void *user_data);
+
+/**
+ * @brief Register the token of an outstanding request.
+ *
+ * Should be called before the request is sent. Registering a token that is
+ * already registered replaces its callback and restarts its timeout.
+ *
+ * @param token       COAP_TOKEN_MAX_LEN byte token of the request.
+ * @param timeout_ms  Time after which the callback is invoked with
+ *                    -ETIMEDOUT and the token is forgotten.
+ * @param flags       0 or COAP_MATCH_MULTIPLE.
+ * @param cb          Callback for the response.
+ * @param user_data   Passed to the callback.
+ *
+ * @return 0 on success, -EINVAL for invalid arguments, or -ENOMEM if the
+ *         match table is full.
+ */
+int coap_match_register(const uint8_t *token, uint32_t timeout_ms,
+                        uint32_t flags, coap_match_cb_t cb, void *user_data);
+
+/**
+ * @brief Forget a registered token without invoking its callback.
+ *
+ * @param token  COAP_TOKEN_MAX_LEN byte token.
+ *
+ * @return 0 on success, -EINVAL if token is NULL, or -ENOENT if it is not
+ *         registered.
+ */
+int coap_match_cancel(const uint8_t *token);
+
+/**
+ * @brief Route a received message to the requester that registered its
+ *        token.
+ *
+ * @param response  Parsed received message.
+ *
+ * @return 0 if the message was delivered, -ENOENT if no outstanding request
+ *         matches it, or -EINVAL if response is NULL.
+ */
+int coap_match_handle_message(const struct coap_packet *response);
+
+/**
+ * @brief Get the number of registered tokens.
+ */
+uint32_t coap_match_pending_count(void);
+
+#endif /* CONFIG_COAP_MATCH */
+
 #endif /* CONFIG_COAP_LIB */
 
 #endif /* LIB_COAP_H_ */
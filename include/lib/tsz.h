@@ -0,0 +1,137 @@
+#ifndef LIB_TSZ_H_
+#define LIB_TSZ_H_
+
+#ifdef CONFIG_TSZ
+
+#include <zephyr/kernel.h>
+#include <string.h>
+
+/*
+ * Time series compression in the style of Facebook's Gorilla (VLDB 2015).
+ *
+ * A block holds the samples of one series. Timestamps are stored as the
+ * difference between consecutive intervals (delta of delta), which is zero
+ * for a steady sampling period, and 32-bit values are stored as the XOR with
+ * the previous value, of which only the changed bits are kept.
+ *
+ * Block layout, bit-packed MSB first:
+ *
+ *   count      16 bits, number of samples
+ *   t0         64 bits, timestamp of the first sample
+ *   v0         32 bits, value of the first sample
+ *
+ * then for every further sample a timestamp and a value:
+ *
+ *   '0'                      same interval as the previous sample
+ *   '10'   + 7 bit dod       interval changed by -64..63
+ *   '110'  + 9 bit dod       interval changed by -256..255
+ *   '1110' + 12 bit dod      interval changed by -2048..2047
+ *   '1111' + 32 bit dod      anything else within int32
+ *
+ *   '0'                      same value as the previous sample
+ *   '10'  + bits             changed bits fit the previous window
+ *   '11'  + 5 bit leading zeros + 5 bit length - 1 + bits
+ *
+ * Timestamp units are up to the caller, typically milliseconds.
+ */
+
+/** @brief Block encoder state. */
+struct tsz_encoder {
+    uint8_t *buf;
+    size_t size;
+    size_t bit_pos;
+    uint16_t count;
+    int64_t t_prev;
+    int64_t delta_prev;
+    uint32_t v_prev;
+    uint8_t leading;
+    uint8_t trailing;
+};
+
+/** @brief Block decoder state. */
+struct tsz_decoder {
+    const uint8_t *buf;
+    size_t len;
+    size_t bit_pos;
+    uint16_t count;
+    uint16_t index;
+    int64_t t_prev;
+    int64_t delta_prev;
+    uint32_t v_prev;
+    uint8_t leading;
+    uint8_t trailing;
+};
+
+/**
+ * @brief Start a new block.
+ *
+ * @param enc   Encoder to initialise.
+ * @param buf   Destination buffer for the block.
+ * @param size  Size of the destination buffer, at least 2 bytes.
+ *
+ * @return 0 on success, or -EINVAL for invalid arguments.
+ */
+int tsz_encoder_init(struct tsz_encoder *enc, uint8_t *buf, size_t size);
+
+/**
+ * @brief Append a sample to the block.
+ *
+ * Samples should be appended in time order. A sample that does not fit
+ * leaves the block unchanged, so that the block can be finished and the
+ * sample appended to a new block.
+ *
+ * @param enc    Encoder from tsz_encoder_init().
+ * @param t      Timestamp of the sample.
+ * @param value  Value of the sample, see tsz_float_bits().
+ *
+ * @return 0 on success, -ENOSPC if the block is full, or -ERANGE if the
+ *         interval changed by more than an int32 can hold.
+ */
+int tsz_encoder_append(struct tsz_encoder *enc, int64_t t, uint32_t value);
+
+/**
+ * @brief Finish the block by writing its header.
+ *
+ * The encoder can keep appending afterwards, and the block must then be
+ * finished again.
+ *
+ * @return Length of the block in bytes.
+ */
+size_t tsz_encoder_finish(struct tsz_encoder *enc);
+
+/**
+ * @brief Start decoding a block.
+ *
+ * @return 0 on success, or -EBADMSG if the block is too short.
+ */
+int tsz_decoder_init(struct tsz_decoder *dec, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Decode the next sample of a block.
+ *
+ * @return 0 on success, -ENODATA after the last sample, or -EBADMSG if the
+ *         block is truncated or malformed.
+ */
+int tsz_decoder_next(struct tsz_decoder *dec, int64_t *t, uint32_t *value);
+
+/** @brief Get the bits of a float for tsz_encoder_append(). */
+static inline uint32_t tsz_float_bits(float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+/** @brief Get the float from bits returned by tsz_decoder_next(). */
+static inline float tsz_bits_float(uint32_t bits)
+{
+    float value;
+
+    memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+#endif /* CONFIG_TSZ */
+
+#endif /* LIB_TSZ_H_ */
@@ -3,6 +3,7 @@
 #include <zephyr/posix/fcntl.h>
 #include <zephyr/net/net_ip.h>
 #include <zephyr/sys/atomic.h>
+#include <zephyr/random/random.h>
 #include <zephyr/logging/log.h>
 
 #include <lib/cellular.h>
@@ -10,6 +11,11 @@
 #include "cellular_queue.h"
 #include "cellular_backend.h"
 #include "cellular_packet.h"
+#include "cellular_stats.h"
+
+#ifdef CONFIG_CELLULAR_DNS_CACHE
+#include "cellular_dns.h"
+#endif /* CONFIG_CELLULAR_DNS_CACHE */
 
 LOG_MODULE_REGISTER(cellular, CONFIG_CELLULAR_LOG_LEVEL);
 
@@ -27,16 +33,88 @@ static const struct cellular_backend *backend;
 
 cellular_recv_cb_t recv_callback;
 
+static void cellular_downlink_handler(struct k_work *work);
+K_WORK_DEFINE(cellular_downlink_work, cellular_downlink_handler);
+
 static atomic_t cellular_state = ATOMIC_INIT(CELLULAR_STATE_UNINITIALISED);
 
+static cellular_state_cb_t
+        state_subscribers[CONFIG_CELLULAR_MAX_STATE_SUBSCRIBERS];
+static atomic_t num_state_subscribers = ATOMIC_INIT(0);
+
+static struct k_spinlock link_status_lock;
+static struct cellular_link_status link_status;
+static bool link_was_up;
+
 cellular_state_t cellular_state_get(void)
 {
     return (cellular_state_t)atomic_get(&cellular_state);
 }
 
-static inline void cellular_state_set(cellular_state_t state)
+static void cellular_state_set(cellular_state_t state)
+{
+    cellular_state_t prev =
+        (cellular_state_t)atomic_set(&cellular_state, (atomic_val_t)state);
+
+    if (prev == state) {
+        return;
+    }
+
+    cellular_stats_state(state);
+
+    int count = MIN(atomic_get(&num_state_subscribers),
+                    CONFIG_CELLULAR_MAX_STATE_SUBSCRIBERS);
+    for (int i = 0; i < count; i++) {
+        if (state_subscribers[i] != NULL) {
+            state_subscribers[i](state);
+        }
+    }
+}
+
+int cellular_state_subscribe(cellular_state_cb_t cb)
+{
+    if (cb == NULL) {
+        return -EINVAL;
+    }
+
+    atomic_val_t slot = atomic_inc(&num_state_subscribers);
+    if (slot >= CONFIG_CELLULAR_MAX_STATE_SUBSCRIBERS) {
+        atomic_dec(&num_state_subscribers);
+        return -ENOMEM;
+    }
+
+    state_subscribers[slot] = cb;
+    return 0;
+}
+
+void cellular_link_status_get(struct cellular_link_status *status)
+{
+    K_SPINLOCK(&link_status_lock) {
+        *status = link_status;
+    }
+}
+
+static void link_status_mark_up(void)
 {
-    (void)atomic_set(&cellular_state, (atomic_val_t)state);
+    K_SPINLOCK(&link_status_lock) {
+        if (link_was_up) {
+            int64_t outage = k_uptime_get() - link_status.down_since;
+
+            link_status.reconnects++;
+            link_status.last_outage_ms = outage;
+            link_status.total_outage_ms += outage;
+            LOG_INF("Link restored after %lld ms.", outage);
+        }
+        link_status.down_since = 0;
+        link_was_up = true;
+    }
+}
+
+static void link_status_mark_down(void)
+{
+    K_SPINLOCK(&link_status_lock) {
+        link_status.down_since = k_uptime_get();
+    }
 }
 
 /**
@@ -53,9 +131,8 @@ static inline void cellular_state_set(cellular_state_t state)
  */
 int cellular_init(cellular_recv_cb_t cb)
 {
-    cellular_state_t state = cellular_state_get();
-
-    if (state == CELLULAR_STATE_STARTING || state == CELLULAR_STATE_RUNNING) {
+    /* The cellular thread never exits once started; it reconnects instead. */
+    if (cellular_thread_id != NULL) {
         LOG_ERR("Cellular thread is already running.");
         return -EBUSY;
     }
@@ -75,6 +152,8 @@ int cellular_init(cellular_recv_cb_t cb)
         return -EINVAL;
     }
 
+    cellular_state_set(CELLULAR_STATE_STARTING);
+
     cellular_thread_id = k_thread_create(&cellular_thread,
                                          cellular_thread_stack,
                                          CONFIG_CELLULAR_THREAD_STACK_SIZE,
@@ -84,37 +163,123 @@ int cellular_init(cellular_recv_cb_t cb)
                                          0,
                                          K_NO_WAIT);
 
-    cellular_state_set(CELLULAR_STATE_STARTING);
-
     LOG_INF("Cellular thread created.");
 
     return 0;
 }
 
-int cellular_send_packet(const uint8_t *data, size_t data_len)
+int cellular_uplink_claim(struct cellular_uplink_buf *buf, size_t size,
+                          enum cellular_priority priority)
 {
-    if (data == NULL ||
-            data_len <= 0 ||
-            data_len > CONFIG_CELLULAR_UPLINK_BUFFER_SIZE) {
+    if (buf == NULL ||
+            size == 0 ||
+            size > CONFIG_CELLULAR_UPLINK_BUFFER_SIZE) {
         return -EINVAL;
     }
 
-    int ret = 0;
     struct cellular_packet *packet = NULL;
 
-    ret = cellular_packet_alloc(&packet);
+    int ret = cellular_packet_alloc(&packet, size, priority);
     if (ret != 0) {
         LOG_ERR("Failed to alloc packet: %d", ret);
+        cellular_stats_error(CELLULAR_ERROR_NO_MEMORY);
+        return ret;
+    }
+
+    buf->data = packet->buffer;
+    buf->size = size;
+    buf->tag = NULL;
+    buf->priv = packet;
+
+    return 0;
+}
+
+int cellular_uplink_commit(struct cellular_uplink_buf *buf, size_t len)
+{
+    if (buf == NULL || buf->priv == NULL) {
+        return -EINVAL;
+    }
+
+    struct cellular_packet *packet = buf->priv;
+    buf->priv = NULL;
+
+    if (len == 0 || len > buf->size) {
+        cellular_packet_free(packet);
+        return -EINVAL;
+    }
+
+    /* Return the unused tail of the claim to the pool */
+    if (len < buf->size) {
+        (void)cellular_packet_shrink(&packet, len);
+    }
+
+    packet->len = len;
+    packet->tag = buf->tag;
+
+    enum cellular_priority priority = packet->priority;
+
+    int ret = cellular_uplink_enqueue(&packet, K_NO_WAIT);
+    if (ret != 0) {
+        LOG_ERR("Failed to enqueue packet: %d", ret);
+        cellular_stats_error(CELLULAR_ERROR_QUEUE_FULL);
+        cellular_packet_free(packet);
         return ret;
     }
 
-    memcpy(packet->buffer, data, data_len);
-    packet->len = data_len;
+    cellular_stats_queue_depth(priority, cellular_uplink_queue_depth(priority));
+
+    return ret;
+}
+
+void cellular_uplink_abort(struct cellular_uplink_buf *buf)
+{
+    if (buf == NULL || buf->priv == NULL) {
+        return;
+    }
+
+    cellular_packet_free(buf->priv);
+    buf->priv = NULL;
+}
+
+int cellular_send_packet(const uint8_t *data, size_t data_len)
+{
+    if (data == NULL) {
+        return -EINVAL;
+    }
+
+    struct cellular_uplink_buf buf;
+
+    int ret = cellular_uplink_claim(&buf, data_len,
+                                    CELLULAR_PRIORITY_TELEMETRY);
+    if (ret != 0) {
+        return ret;
+    }
+
+    memcpy(buf.data, data, data_len);
+
+    return cellular_uplink_commit(&buf, data_len);
+}
+
+/**
+ * @brief Deliver queued downlink packets to the receive callback.
+ *
+ * Runs on the system workqueue so slow consumers do not stall the socket
+ * loop. Each packet is handed over in place and free'd once the callback
+ * returns.
+ */
+static void cellular_downlink_handler(struct k_work *work)
+{
+    ARG_UNUSED(work);
+
+    struct cellular_downlink_packet *packet;
 
-    return cellular_uplink_enqueue(&packet, K_NO_WAIT);
+    while (cellular_downlink_dequeue(&packet, K_NO_WAIT) == 0) {
+        recv_callback(packet->buffer, packet->len);
+        cellular_downlink_packet_free(packet);
+    }
 }
 
-static int resolve_remote_server(void)
+static int resolve_remote_server(struct in_addr *addr)
 {
     int err;
     struct addrinfo *result;
@@ -134,22 +299,154 @@ static int resolve_remote_server(void)
 		return -ENOENT;
 	}
 
+    addr->s_addr = ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
+
+    char ipv4_addr[NET_IPV4_ADDR_LEN];
+
+    inet_ntop(AF_INET, &addr->s_addr, ipv4_addr, sizeof(ipv4_addr));
+    LOG_INF("Found IPv4 address of remote server: %s", ipv4_addr);
+
+    freeaddrinfo(result);
+
+    return 0;
+}
+
+static void set_remote_server(const struct in_addr *addr)
+{
     struct sockaddr_in *server = ((struct sockaddr_in *)&remote_server);
 
-    server->sin_addr.s_addr =
-            ((struct sockaddr_in *)result->ai_addr)->sin_addr.s_addr;
+    server->sin_addr.s_addr = addr->s_addr;
     server->sin_family = AF_INET;
     server->sin_port = htons(CONFIG_REMOTE_SERVER_PORT);
+}
 
-    char ipv4_addr[NET_IPV4_ADDR_LEN];
+#ifdef CONFIG_CELLULAR_DNS_CACHE
+/*
+ * The cached address is revalidated on its own work queue, as resolving
+ * blocks for a network round trip. The cellular thread only picks up the
+ * result, between uplinks.
+ */
+K_THREAD_STACK_DEFINE(dns_work_q_stack, CONFIG_CELLULAR_DNS_CACHE_STACK_SIZE);
+static struct k_work_q dns_work_q;
+static bool dns_work_q_started;
 
-    inet_ntop(AF_INET, &server->sin_addr.s_addr, ipv4_addr, sizeof(ipv4_addr));
-    LOG_INF("Found IPv4 address of remote server: %s", ipv4_addr);
+static void dns_revalidate_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(dns_revalidate_work, dns_revalidate_handler);
 
-    freeaddrinfo(result);
+static struct k_spinlock dns_result_lock;
+static struct in_addr dns_result;
+static bool dns_result_pending;
+
+static void dns_revalidate_handler(struct k_work *work)
+{
+    struct in_addr addr;
+
+    if (resolve_remote_server(&addr) != 0) {
+        LOG_WRN("Remote server revalidation failed. Keeping cached address.");
+        k_work_reschedule_for_queue(&dns_work_q, &dns_revalidate_work,
+                                    K_SECONDS(CONFIG_CELLULAR_DNS_CACHE_RETRY_S));
+        return;
+    }
+
+    (void)cellular_dns_cache_store(&addr);
+
+    K_SPINLOCK(&dns_result_lock) {
+        dns_result = addr;
+        dns_result_pending = true;
+    }
+
+    k_work_reschedule_for_queue(&dns_work_q, &dns_revalidate_work,
+                                K_SECONDS(CONFIG_CELLULAR_DNS_CACHE_TTL));
+}
+
+/**
+ * @brief Schedule the next revalidation, unless one is already scheduled.
+ */
+static void dns_revalidate_schedule(k_timeout_t delay)
+{
+    if (!dns_work_q_started) {
+        k_work_queue_start(&dns_work_q, dns_work_q_stack,
+                           K_THREAD_STACK_SIZEOF(dns_work_q_stack),
+                           K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+        dns_work_q_started = true;
+    }
+
+    k_work_schedule_for_queue(&dns_work_q, &dns_revalidate_work, delay);
+}
+
+/**
+ * @brief Resolve the remote server, preferring the persistent cache.
+ *
+ * A cached address is used immediately and revalidated in the background,
+ * removing a DNS round trip from time-to-first-uplink.
+ */
+static int lookup_remote_server(void)
+{
+    int err;
+    struct in_addr addr;
+
+    if (cellular_dns_cache_load(&addr) == 0) {
+        LOG_INF("Using cached remote server address.");
+        set_remote_server(&addr);
+        /* Uptime does not persist, so the cached address is revalidated
+         * once after boot, and from then on every TTL */
+        dns_revalidate_schedule(K_NO_WAIT);
+        return 0;
+    }
+
+    err = resolve_remote_server(&addr);
+    if (err != 0) {
+        return err;
+    }
+
+    set_remote_server(&addr);
+    (void)cellular_dns_cache_store(&addr);
+    dns_revalidate_schedule(K_SECONDS(CONFIG_CELLULAR_DNS_CACHE_TTL));
+
+    return 0;
+}
+
+/**
+ * @brief Take up the result of a background revalidation, if any.
+ *
+ * @return 0 if the address is unchanged, -EADDRNOTAVAIL if the server moved
+ *         and the socket must be reconnected.
+ */
+static int revalidate_remote_server(void)
+{
+    struct in_addr addr;
+    bool pending = false;
+
+    K_SPINLOCK(&dns_result_lock) {
+        pending = dns_result_pending;
+        addr = dns_result;
+        dns_result_pending = false;
+    }
+
+    struct sockaddr_in *server = ((struct sockaddr_in *)&remote_server);
+    if (pending && server->sin_addr.s_addr != addr.s_addr) {
+        LOG_INF("Remote server address changed.");
+        set_remote_server(&addr);
+        return -EADDRNOTAVAIL;
+    }
 
     return 0;
 }
+#else
+static int lookup_remote_server(void)
+{
+    struct in_addr addr;
+
+    int err = resolve_remote_server(&addr);
+    if (err != 0) {
+        return err;
+    }
+
+    set_remote_server(&addr);
+
+    return 0;
+}
+#endif /* CONFIG_CELLULAR_DNS_CACHE */
 
 /** @brief Setup socket */
 static int initialise_socket(void)
@@ -192,7 +489,7 @@ static int init_cellular_stack(void)
         return err;
     }
 
-    err = resolve_remote_server();
+    err = lookup_remote_server();
     if (err != 0) {
         LOG_ERR("Failed to resolve remote server.");
         cellular_state_set(CELLULAR_STATE_REMOTE_SERVER_ERROR);
@@ -209,26 +506,52 @@ static int init_cellular_stack(void)
     return 0;
 }
 
-static void cellular_thread_function(void *p1, void *p2, void *p3)
+#ifdef CONFIG_CELLULAR_STATS
+/** @brief Periodically sample the backend's signal quality, if supported. */
+static void sample_signal(void)
 {
-    ARG_UNUSED(p1);
-    ARG_UNUSED(p2);
-    ARG_UNUSED(p3);
+    static int64_t next_sample_at;
+    int16_t rsrp_dbm;
+    int16_t rsrq_db;
 
-    if (init_cellular_stack() != 0 ) {
-        LOG_ERR("Cellular init failed. Thread exiting.");
+    if (backend->signal_get == NULL || k_uptime_get() < next_sample_at) {
         return;
     }
 
-    cellular_state_set(CELLULAR_STATE_RUNNING);
+    next_sample_at = k_uptime_get() +
+                     CONFIG_CELLULAR_STATS_SIGNAL_INTERVAL * MSEC_PER_SEC;
 
+    if (backend->signal_get(&rsrp_dbm, &rsrq_db) == 0) {
+        cellular_stats_signal(rsrp_dbm, rsrq_db);
+    }
+}
+#endif /* CONFIG_CELLULAR_STATS */
+
+/**
+ * @brief Service the socket until the link or socket fails.
+ *
+ * @return Negative error code describing why the link was torn down.
+ */
+static int cellular_socket_loop(void)
+{
+    int ret = 0;
     ssize_t num_bytes = 0;
+    int socket_errors = 0;
     struct cellular_packet *uplink_packet;
-    uint8_t rx_buffer[CONFIG_CELLULAR_DOWNLINK_BUFFER_SIZE] = {0};
+    struct cellular_downlink_packet *downlink_packet = NULL;
 
     while (true) {
 
+        if (backend->link_is_up != NULL && !backend->link_is_up()) {
+            LOG_WRN("Cellular link lost.");
+            ret = -ENETDOWN;
+            break;
+        }
+
+        bool uplink_idle = true;
+
         if (cellular_uplink_dequeue(&uplink_packet, K_NO_WAIT) == 0) {
+            uplink_idle = false;
 
             num_bytes = send(remote_server_socket,
                              uplink_packet->buffer,
@@ -238,32 +561,167 @@ static void cellular_thread_function(void *p1, void *p2, void *p3)
             if (num_bytes == -1) {
                 if (errno == EAGAIN || errno == EWOULDBLOCK) {
                     LOG_INF("Operation would block. Message not sent.");
+                    cellular_stats_error(CELLULAR_ERROR_WOULD_BLOCK);
                 } else {
                     LOG_ERR("Error in send: %d", errno);
+                    cellular_stats_error(CELLULAR_ERROR_SEND);
+                    socket_errors++;
                 }
             } else {
                 LOG_INF ("Sent uplink bytes: %d", num_bytes);
+                cellular_stats_tx(uplink_packet->tag, num_bytes);
+                socket_errors = 0;
             }
 
             cellular_packet_free(uplink_packet);
         }
 
+#ifdef CONFIG_CELLULAR_DNS_CACHE
+        /* Move to a new address only while idle so queued uplinks go
+         * first */
+        if (uplink_idle && revalidate_remote_server() != 0) {
+            ret = -EADDRNOTAVAIL;
+            break;
+        }
+#endif /* CONFIG_CELLULAR_DNS_CACHE */
+
+#ifdef CONFIG_CELLULAR_STATS
+        if (uplink_idle) {
+            sample_signal();
+        }
+#endif /* CONFIG_CELLULAR_STATS */
+
+#if !defined(CONFIG_CELLULAR_DNS_CACHE) && !defined(CONFIG_CELLULAR_STATS)
+        ARG_UNUSED(uplink_idle);
+#endif
+
+        /* Leave data in the socket while every downlink buffer is busy */
+        if (downlink_packet == NULL &&
+            cellular_downlink_packet_alloc(&downlink_packet) != 0) {
+            LOG_DBG("No free downlink buffers.");
+            downlink_packet = NULL;
+            k_sleep(K_MSEC(5));
+            continue;
+        }
+
         num_bytes = recv(remote_server_socket,
-                         rx_buffer, sizeof(rx_buffer), 0);
+                         downlink_packet->buffer,
+                         sizeof(downlink_packet->buffer), 0);
 
         if (num_bytes == -1) {
             if (errno == EAGAIN || errno == EWOULDBLOCK) {
                 LOG_DBG("No data available on socket.");
             } else {
                 LOG_ERR("Error in recv: %d", errno);
+                cellular_stats_error(CELLULAR_ERROR_RECV);
+                socket_errors++;
             }
 
         } else {
             LOG_INF("Downlink bytes received: %d", num_bytes);
-            recv_callback(rx_buffer, num_bytes);
+            cellular_stats_rx(num_bytes);
+            socket_errors = 0;
+
+            /* The queue has a slot for every buffer, so this can't fail */
+            downlink_packet->len = num_bytes;
+            (void)cellular_downlink_enqueue(&downlink_packet, K_NO_WAIT);
+            downlink_packet = NULL;
+            k_work_submit(&cellular_downlink_work);
+        }
+
+        if (socket_errors >= CONFIG_CELLULAR_MAX_SOCKET_ERRORS) {
+            LOG_ERR("Too many consecutive socket errors.");
+            ret = -EIO;
+            break;
         }
 
         k_sleep(K_MSEC(5));
     }
+
+    if (downlink_packet != NULL) {
+        cellular_downlink_packet_free(downlink_packet);
+    }
+
+    return ret;
 }
 
+/** @brief Apply up to 50% random jitter to a backoff period. */
+static uint32_t backoff_with_jitter(uint32_t backoff_ms)
+{
+    uint32_t half = backoff_ms / 2;
+
+    return half + (half > 0 ? sys_rand32_get() % (half + 1) : 0);
+}
+
+/** @brief Check the backend's link, for backends that report it. */
+static bool backend_link_is_up(void)
+{
+    return backend->link_is_up == NULL || backend->link_is_up();
+}
+
+static void cellular_thread_function(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    uint32_t backoff_ms = CONFIG_CELLULAR_RECONNECT_BACKOFF_MIN_MS;
+
+    link_status_mark_down();
+
+    while (true) {
+        bool connected = init_cellular_stack() == 0;
+
+        /* A backend can come up before its link does */
+        if (connected && !backend_link_is_up()) {
+            LOG_WRN("Cellular link not up yet.");
+            close(remote_server_socket);
+            connected = false;
+        }
+
+        if (!connected) {
+            uint32_t delay_ms = backoff_with_jitter(backoff_ms);
+
+            LOG_WRN("Cellular init failed. Retrying in %u ms.", delay_ms);
+            k_sleep(K_MSEC(delay_ms));
+
+            backoff_ms = MIN(backoff_ms * 2,
+                             CONFIG_CELLULAR_RECONNECT_BACKOFF_MAX_MS);
+            cellular_state_set(CELLULAR_STATE_RECONNECTING);
+            continue;
+        }
+
+        link_status_mark_up();
+        cellular_state_set(CELLULAR_STATE_RUNNING);
+
+        int64_t up_at = k_uptime_get();
+        int err = cellular_socket_loop();
+
+#ifdef CONFIG_CELLULAR_DNS_CACHE
+        /* Persistent socket errors may mean the cached address is stale */
+        if (err == -EIO) {
+            cellular_dns_cache_invalidate();
+        }
+#endif /* CONFIG_CELLULAR_DNS_CACHE */
+
+        LOG_WRN("Cellular link down (%d). Reconnecting.", err);
+        close(remote_server_socket);
+        link_status_mark_down();
+        cellular_state_set(CELLULAR_STATE_RECONNECTING);
+
+        /* Only a link that stayed up resets the backoff. One that drops
+         * straight away is retried like a failed attempt, so a flapping
+         * link does not spin. */
+        if (k_uptime_get() - up_at >= CONFIG_CELLULAR_LINK_STABLE_MS) {
+            backoff_ms = CONFIG_CELLULAR_RECONNECT_BACKOFF_MIN_MS;
+        } else {
+            uint32_t delay_ms = backoff_with_jitter(backoff_ms);
+
+            LOG_WRN("Cellular link unstable. Retrying in %u ms.", delay_ms);
+            k_sleep(K_MSEC(delay_ms));
+
+            backoff_ms = MIN(backoff_ms * 2,
+                             CONFIG_CELLULAR_RECONNECT_BACKOFF_MAX_MS);
+        }
+    }
+}
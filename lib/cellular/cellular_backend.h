@@ -1,8 +1,19 @@
 #ifndef _LIB_CELLULAR_BACKEND_H_
 #define _LIB_CELLULAR_BACKEND_H_
 
+#include <stdbool.h>
+#include <stdint.h>
+
 struct cellular_backend {
     int (*init)(void);
+
+    /* Optional. Returns false once the backend has lost its link. The
+     * cellular thread then tears down the socket and reconnects. */
+    bool (*link_is_up)(void);
+
+    /* Optional. Samples the serving cell signal quality for the link
+     * statistics. Returns 0 on success. */
+    int (*signal_get)(int16_t *rsrp_dbm, int16_t *rsrq_db);
 };
 
 const struct cellular_backend *cellular_get_selected_backend(void);
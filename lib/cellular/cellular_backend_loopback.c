@@ -0,0 +1,27 @@
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+
+#include "cellular_backend.h"
+
+LOG_MODULE_DECLARE(cellular);
+
+/* The loopback backend is intended for native_sim builds. Sockets are
+ * offloaded to the host (CONFIG_NET_NATIVE_OFFLOADED_SOCKETS), so there is no
+ * link to bring up. The remote server is expected to be a local stand-in,
+ * e.g. scripts/loopback/coap_server.py. */
+static int initialise_loopback(void)
+{
+    LOG_INF("Loopback backend ready. Remote server: %s:%d",
+            CONFIG_REMOTE_SERVER_HOSTNAME, CONFIG_REMOTE_SERVER_PORT);
+
+    return 0;
+}
+
+const struct cellular_backend cellular_backend_loopback = {
+    .init = initialise_loopback,
+};
+
+const struct cellular_backend *cellular_get_selected_backend(void)
+{
+    return &cellular_backend_loopback;
+}
@@ -12,14 +12,21 @@ LOG_MODULE_DECLARE(cellular);
 
 K_SEM_DEFINE(lte_connected_sem, 0, 1);
 
+static atomic_t lte_registered = ATOMIC_INIT(0);
+static bool lte_handler_registered;
+
 static void lte_event_handler(const struct lte_lc_evt *const evt)
 {
     switch (evt->type) {
     case LTE_LC_EVT_NW_REG_STATUS:
         if ((evt->nw_reg_status != LTE_LC_NW_REG_REGISTERED_HOME) &&
             (evt->nw_reg_status != LTE_LC_NW_REG_REGISTERED_ROAMING)) {
+            if (atomic_set(&lte_registered, 0) != 0) {
+                LOG_WRN("Network registration lost: %d", evt->nw_reg_status);
+            }
             break;
         }
+		atomic_set(&lte_registered, 1);
 		LOG_INF("Network registration status: %s",
 				evt->nw_reg_status == LTE_LC_NW_REG_REGISTERED_HOME ?
 				"Connected - home network" : "Connected - roaming");
@@ -45,7 +52,15 @@ static int initialise_modem(void)
         return err;
     }
 
-    lte_lc_register_handler(lte_event_handler);
+    /* Initialisation is re-run on every reconnect attempt */
+    if (!lte_handler_registered) {
+        lte_lc_register_handler(lte_event_handler);
+        lte_handler_registered = true;
+    }
+
+    if (!atomic_get(&lte_registered)) {
+        k_sem_reset(&lte_connected_sem);
+    }
 
     err =  lte_lc_func_mode_set(LTE_LC_FUNC_MODE_ACTIVATE_LTE);
     if (err != 0) {
@@ -53,25 +68,72 @@ static int initialise_modem(void)
         return err;
     }
 
-    LOG_ERR("Waiting for LTE connected semaphore.");
-	err = k_sem_take(&lte_connected_sem, K_MSEC(MSEC_PER_SEC * CONFIG_CELLULAR_CONN_TIMEOUT));
-    if (err != 0) {
-        LOG_ERR("Failed to take LTE connection semaphore: %d", err);
-        return err;
+    if (!atomic_get(&lte_registered)) {
+        LOG_ERR("Waiting for LTE connected semaphore.");
+        err = k_sem_take(&lte_connected_sem,
+                         K_MSEC(MSEC_PER_SEC * CONFIG_CELLULAR_CONN_TIMEOUT));
+        if (err != 0) {
+            LOG_ERR("Failed to take LTE connection semaphore: %d", err);
+            return err;
+        }
     }
 
-    struct nrf_in_addr dns;
-    dns.s_addr = 16843009;  // Cloudflare DNS, 1.1.1.1
-    nrf_setdnsaddr(NRF_AF_INET, &dns, sizeof(dns));
-    LOG_INF("Manually set DNS server via nrf_setdnsaddr");
+    if (sizeof(CONFIG_CELLULAR_NRF_DNS_SERVER) > 1) {
+        struct nrf_in_addr dns;
+
+        err = nrf_inet_pton(NRF_AF_INET, CONFIG_CELLULAR_NRF_DNS_SERVER, &dns);
+        if (err != 1) {
+            LOG_ERR("Invalid DNS server address: %s",
+                    CONFIG_CELLULAR_NRF_DNS_SERVER);
+            return -EINVAL;
+        }
+
+        err = nrf_setdnsaddr(NRF_AF_INET, &dns, sizeof(dns));
+        if (err != 0) {
+            LOG_WRN("Failed to set DNS server: %d", errno);
+        } else {
+            LOG_INF("Set DNS server to %s", CONFIG_CELLULAR_NRF_DNS_SERVER);
+        }
+    }
 
     LOG_ERR("LTE connection established.");
 
     return 0;
 }
 
+static bool modem_link_is_up(void)
+{
+    return atomic_get(&lte_registered) != 0;
+}
+
+#ifdef CONFIG_CELLULAR_STATS
+/* %CONEVAL reports signal levels as indices, see the AT command reference */
+#define CONEVAL_RSRP_TO_DBM(idx) ((idx) - 140)
+#define CONEVAL_RSRQ_TO_DB(idx)  (((idx) - 39) / 2)
+
+static int modem_signal_get(int16_t *rsrp_dbm, int16_t *rsrq_db)
+{
+    struct lte_lc_conn_eval_params params = {0};
+
+    int err = lte_lc_conn_eval_params_get(&params);
+    if (err != 0) {
+        LOG_DBG("Connection evaluation failed: %d", err);
+        return err < 0 ? err : -EAGAIN;
+    }
+
+    *rsrp_dbm = CONEVAL_RSRP_TO_DBM(params.rsrp);
+    *rsrq_db = CONEVAL_RSRQ_TO_DB(params.rsrq);
+
+    return 0;
+}
+#endif /* CONFIG_CELLULAR_STATS */
+
 const struct cellular_backend cellular_backend_nrf = {
     .init = initialise_modem,
+    .link_is_up = modem_link_is_up,
+#ifdef CONFIG_CELLULAR_STATS
+    .signal_get = modem_signal_get,
+#endif /* CONFIG_CELLULAR_STATS */
 };
 
 const struct cellular_backend *cellular_get_selected_backend(void)
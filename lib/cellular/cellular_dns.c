@@ -0,0 +1,139 @@
+#include <zephyr/kernel.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+
+#include "cellular_dns.h"
+
+LOG_MODULE_DECLARE(cellular);
+
+#define DNS_CACHE_SUBTREE "cellular"
+#define DNS_CACHE_KEY     "dns"
+
+struct dns_cache_entry {
+    uint32_t hostname_crc;
+    uint32_t s_addr;
+};
+
+/* The entry is written from the DNS result callback and read from the
+ * cellular thread, so it is only accessed under cache_lock */
+static struct k_spinlock cache_lock;
+static struct dns_cache_entry cache_entry;
+static bool cache_valid;
+static bool cache_loaded;
+
+static uint32_t hostname_crc(void)
+{
+    return crc32_ieee((const uint8_t *)CONFIG_REMOTE_SERVER_HOSTNAME,
+                      strlen(CONFIG_REMOTE_SERVER_HOSTNAME));
+}
+
+static int dns_cache_settings_set(const char *name, size_t len,
+                                  settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+
+    if (!settings_name_steq(name, DNS_CACHE_KEY, &next) || next != NULL) {
+        return -ENOENT;
+    }
+
+    if (len != sizeof(struct dns_cache_entry)) {
+        LOG_WRN("Discarding DNS cache entry of unexpected size: %d", len);
+        return 0;
+    }
+
+    struct dns_cache_entry entry;
+    ssize_t rc = read_cb(cb_arg, &entry, sizeof(entry));
+    if (rc != sizeof(entry)) {
+        return -EIO;
+    }
+
+    if (entry.hostname_crc != hostname_crc()) {
+        LOG_INF("Cached address is for a different hostname. Ignoring.");
+        return 0;
+    }
+
+    K_SPINLOCK(&cache_lock) {
+        cache_entry = entry;
+        cache_valid = true;
+    }
+
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(cellular_dns, DNS_CACHE_SUBTREE, NULL,
+                               dns_cache_settings_set, NULL, NULL);
+
+int cellular_dns_cache_load(struct in_addr *addr)
+{
+    if (!cache_loaded) {
+        int err = settings_subsys_init();
+        if (err != 0) {
+            LOG_ERR("Failed to initialise settings: %d", err);
+            return -ENOENT;
+        }
+
+        err = settings_load_subtree(DNS_CACHE_SUBTREE);
+        if (err != 0) {
+            LOG_ERR("Failed to load DNS cache: %d", err);
+        }
+
+        cache_loaded = true;
+    }
+
+    int err = -ENOENT;
+
+    K_SPINLOCK(&cache_lock) {
+        if (cache_valid) {
+            addr->s_addr = cache_entry.s_addr;
+            err = 0;
+        }
+    }
+
+    return err;
+}
+
+int cellular_dns_cache_store(const struct in_addr *addr)
+{
+    bool cached = false;
+
+    K_SPINLOCK(&cache_lock) {
+        cached = cache_valid && cache_entry.s_addr == addr->s_addr;
+    }
+
+    if (cached) {
+        return 0;
+    }
+
+    struct dns_cache_entry entry = {
+        .hostname_crc = hostname_crc(),
+        .s_addr = addr->s_addr,
+    };
+
+    int err = settings_save_one(DNS_CACHE_SUBTREE "/" DNS_CACHE_KEY,
+                                &entry, sizeof(entry));
+    if (err != 0) {
+        LOG_ERR("Failed to store DNS cache entry: %d", err);
+        return err;
+    }
+
+    K_SPINLOCK(&cache_lock) {
+        cache_entry = entry;
+        cache_valid = true;
+    }
+
+    return 0;
+}
+
+void cellular_dns_cache_invalidate(void)
+{
+    K_SPINLOCK(&cache_lock) {
+        cache_valid = false;
+    }
+
+    int err = settings_delete(DNS_CACHE_SUBTREE "/" DNS_CACHE_KEY);
+    if (err != 0) {
+        LOG_WRN("Failed to delete DNS cache entry: %d", err);
+    }
+}
@@ -0,0 +1,37 @@
+#ifndef _LIB_CELLULAR_DNS_H_
+#define _LIB_CELLULAR_DNS_H_
+
+#include <zephyr/kernel.h>
+#include <zephyr/net/net_ip.h>
+
+/**
+ * @brief Load the cached remote server address.
+ *
+ * The cache is read from settings on first use. Entries resolved for a
+ * different CONFIG_REMOTE_SERVER_HOSTNAME are ignored.
+ *
+ * @param[out] addr  Destination for the cached IPv4 address.
+ *
+ * @return 0 on success, -ENOENT if no valid entry exists.
+ */
+int cellular_dns_cache_load(struct in_addr *addr);
+
+/**
+ * @brief Store a freshly resolved remote server address.
+ *
+ * The entry is only written to flash if it differs from the cached one.
+ *
+ * @param[in] addr  Resolved IPv4 address.
+ *
+ * @return 0 on success, negative error code otherwise.
+ */
+int cellular_dns_cache_store(const struct in_addr *addr);
+
+/**
+ * @brief Invalidate the cached address so the next connection resolves it.
+ *
+ * The persisted entry is deleted as well.
+ */
+void cellular_dns_cache_invalidate(void);
+
+#endif /* _LIB_CELLULAR_DNS_H_ */
@@ -1,24 +1,90 @@
 #include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
 
 #include "cellular_packet.h"
 
-K_MEM_SLAB_DEFINE(cellular_packet_slab,
-                  sizeof(struct cellular_packet),
-                  CONFIG_CELLULAR_UPLINK_QUEUE_MAX_ITEMS,
+/* Packets are carved from a byte-granular heap rather than fixed slots, so a
+ * short request only consumes its own length plus the chunk header. Control
+ * traffic has its own heap so telemetry bursts cannot starve it. */
+K_HEAP_DEFINE(cellular_control_packet_heap,
+              CONFIG_CELLULAR_UPLINK_CONTROL_POOL_SIZE);
+K_HEAP_DEFINE(cellular_packet_heap, CONFIG_CELLULAR_UPLINK_POOL_SIZE);
+
+static struct k_heap *packet_heap(enum cellular_priority priority)
+{
+    return priority == CELLULAR_PRIORITY_CONTROL ?
+           &cellular_control_packet_heap : &cellular_packet_heap;
+}
+
+static atomic_t allocated_count;
+
+K_MEM_SLAB_DEFINE(cellular_downlink_packet_slab,
+                  sizeof(struct cellular_downlink_packet),
+                  CONFIG_CELLULAR_DOWNLINK_QUEUE_MAX_ITEMS,
                   4);
 
+int cellular_packet_alloc(struct cellular_packet **packet, size_t size,
+                          enum cellular_priority priority)
+{
+    if (priority >= CELLULAR_PRIORITY_COUNT) {
+        return -EINVAL;
+    }
 
-int cellular_packet_alloc(struct cellular_packet **packet)
+    struct cellular_packet *p = k_heap_alloc(packet_heap(priority),
+                                             sizeof(*p) + size,
+                                             K_NO_WAIT);
+    if (p == NULL) {
+        return -ENOMEM;
+    }
+
+    p->len = 0;
+    p->priority = priority;
+    p->tag = NULL;
+    atomic_inc(&allocated_count);
+    *packet = p;
+
+    return 0;
+}
+
+int cellular_packet_shrink(struct cellular_packet **packet, size_t len)
 {
-    return k_mem_slab_alloc(&cellular_packet_slab, (void **)packet, K_NO_WAIT);
+    /* Shrinking is done in place, the tail is returned to the heap */
+    struct cellular_packet *p = k_heap_realloc(packet_heap((*packet)->priority),
+                                               *packet,
+                                               sizeof(*p) + len,
+                                               K_NO_WAIT);
+    if (p == NULL) {
+        return -ENOMEM;
+    }
+
+    *packet = p;
+
+    return 0;
 }
 
 void cellular_packet_free(struct cellular_packet *packet)
 {
-    return k_mem_slab_free(&cellular_packet_slab, (void *)packet);
+    k_heap_free(packet_heap(packet->priority), packet);
+    atomic_dec(&allocated_count);
 }
 
 uint32_t cellular_packet_allocated_count(void)
 {
-    return k_mem_slab_num_used_get(&cellular_packet_slab);
+    return atomic_get(&allocated_count);
+}
+
+int cellular_downlink_packet_alloc(struct cellular_downlink_packet **packet)
+{
+    return k_mem_slab_alloc(&cellular_downlink_packet_slab,
+                            (void **)packet, K_NO_WAIT);
+}
+
+void cellular_downlink_packet_free(struct cellular_downlink_packet *packet)
+{
+    k_mem_slab_free(&cellular_downlink_packet_slab, (void *)packet);
+}
+
+uint32_t cellular_downlink_packet_allocated_count(void)
+{
+    return k_mem_slab_num_used_get(&cellular_downlink_packet_slab);
 }
@@ -3,15 +3,33 @@
 
 #include <zephyr/kernel.h>
 
+#include <lib/cellular.h>
+
 struct cellular_packet {
-    uint8_t buffer[CONFIG_CELLULAR_UPLINK_BUFFER_SIZE];
     size_t len;
+    enum cellular_priority priority;
+    const char *tag;
+    uint8_t buffer[];
+};
+
+struct cellular_downlink_packet {
+    size_t len;
+    uint8_t buffer[CONFIG_CELLULAR_DOWNLINK_BUFFER_SIZE];
 };
 
-int cellular_packet_alloc(struct cellular_packet **packet);
+int cellular_packet_alloc(struct cellular_packet **packet, size_t size,
+                          enum cellular_priority priority);
+
+int cellular_packet_shrink(struct cellular_packet **packet, size_t len);
 
 void cellular_packet_free(struct cellular_packet *packet);
 
 uint32_t cellular_packet_allocated_count(void);
 
+int cellular_downlink_packet_alloc(struct cellular_downlink_packet **packet);
+
+void cellular_downlink_packet_free(struct cellular_downlink_packet *packet);
+
+uint32_t cellular_downlink_packet_allocated_count(void);
+
 #endif /* _LIB_CELLULAR_PACKET_H */
@@ -5,19 +5,59 @@
 
 #define CELLULAR_QUEUE_ALIGNMENT 4
 
+K_MSGQ_DEFINE(cellular_uplink_control_queue,
+              sizeof(struct cellular_packet *),
+              CONFIG_CELLULAR_UPLINK_CONTROL_QUEUE_MAX_ITEMS,
+              CELLULAR_QUEUE_ALIGNMENT);
+
 K_MSGQ_DEFINE(cellular_uplink_queue,
               sizeof(struct cellular_packet *),
               CONFIG_CELLULAR_UPLINK_QUEUE_MAX_ITEMS,
               CELLULAR_QUEUE_ALIGNMENT);
 
+K_MSGQ_DEFINE(cellular_downlink_queue,
+              sizeof(struct cellular_downlink_packet *),
+              CONFIG_CELLULAR_DOWNLINK_QUEUE_MAX_ITEMS,
+              CELLULAR_QUEUE_ALIGNMENT);
+
+static struct k_msgq *uplink_queue(enum cellular_priority priority)
+{
+    return priority == CELLULAR_PRIORITY_CONTROL ?
+           &cellular_uplink_control_queue : &cellular_uplink_queue;
+}
+
 int cellular_uplink_enqueue(struct cellular_packet **packet,
                             k_timeout_t timeout)
 {
-    return k_msgq_put(&cellular_uplink_queue, (void **)packet, timeout);
+    return k_msgq_put(uplink_queue((*packet)->priority),
+                      (void **)packet, timeout);
 }
 
 int cellular_uplink_dequeue(struct cellular_packet **packet,
                             k_timeout_t timeout)
 {
+    /* Strict priority: telemetry only goes out once control is drained */
+    if (k_msgq_get(&cellular_uplink_control_queue,
+                   (void **)packet, K_NO_WAIT) == 0) {
+        return 0;
+    }
+
     return k_msgq_get(&cellular_uplink_queue, (void **)packet, timeout);
 }
+
+uint32_t cellular_uplink_queue_depth(enum cellular_priority priority)
+{
+    return k_msgq_num_used_get(uplink_queue(priority));
+}
+
+int cellular_downlink_enqueue(struct cellular_downlink_packet **packet,
+                              k_timeout_t timeout)
+{
+    return k_msgq_put(&cellular_downlink_queue, (void **)packet, timeout);
+}
+
+int cellular_downlink_dequeue(struct cellular_downlink_packet **packet,
+                              k_timeout_t timeout)
+{
+    return k_msgq_get(&cellular_downlink_queue, (void **)packet, timeout);
+}
@@ -11,4 +11,12 @@ int cellular_uplink_enqueue(struct cellular_packet **packet,
 int cellular_uplink_dequeue(struct cellular_packet **packet,
                             k_timeout_t timeout);
 
+uint32_t cellular_uplink_queue_depth(enum cellular_priority priority);
+
+int cellular_downlink_enqueue(struct cellular_downlink_packet **packet,
+                              k_timeout_t timeout);
+
+int cellular_downlink_dequeue(struct cellular_downlink_packet **packet,
+                              k_timeout_t timeout);
+
 #endif /* _CELLULAR_QUEUE_H_ */
@@ -0,0 +1,98 @@
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+
+#include <lib/cellular.h>
+
+static const char * const state_names[] = {
+    [CELLULAR_STATE_UNINITIALISED] = "uninitialised",
+    [CELLULAR_STATE_STARTING] = "starting",
+    [CELLULAR_STATE_RUNNING] = "running",
+    [CELLULAR_STATE_BACKEND_ERROR] = "backend error",
+    [CELLULAR_STATE_SOCKET_ERROR] = "socket error",
+    [CELLULAR_STATE_REMOTE_SERVER_ERROR] = "server error",
+    [CELLULAR_STATE_RECONNECTING] = "reconnecting",
+    [CELLULAR_STATE_UNDEFINED] = "undefined",
+};
+
+static const char * const error_names[] = {
+    [CELLULAR_ERROR_WOULD_BLOCK] = "would block",
+    [CELLULAR_ERROR_SEND] = "send",
+    [CELLULAR_ERROR_RECV] = "recv",
+    [CELLULAR_ERROR_QUEUE_FULL] = "queue full",
+    [CELLULAR_ERROR_NO_MEMORY] = "no memory",
+};
+
+static void print_traffic(const struct shell *sh, const char *name,
+                          const struct cellular_traffic *t)
+{
+    shell_print(sh, "  %-10s tx %8u B %6u pkts  rx %8u B %6u pkts",
+                name, t->tx_bytes, t->tx_packets, t->rx_bytes, t->rx_packets);
+}
+
+static int cmd_cellular_stats(const struct shell *sh, size_t argc, char **argv)
+{
+    struct cellular_stats stats;
+    struct cellular_tag_stats tag;
+
+    cellular_stats_get(&stats);
+
+    shell_print(sh, "Traffic:");
+    print_traffic(sh, "total", &stats.total);
+    print_traffic(sh, "hour", &stats.hour);
+    print_traffic(sh, "last hour", &stats.last_hour);
+    print_traffic(sh, "day", &stats.day);
+    print_traffic(sh, "last day", &stats.last_day);
+
+    shell_print(sh, "Uplink by tag:");
+    for (size_t i = 0; cellular_stats_tag_get(i, &tag) == 0; i++) {
+        print_traffic(sh, tag.tag, &tag.traffic);
+    }
+
+    shell_print(sh, "Errors:");
+    for (size_t i = 0; i < CELLULAR_ERROR_CLASS_COUNT; i++) {
+        shell_print(sh, "  %-12s %u", error_names[i], stats.errors[i]);
+    }
+
+    shell_print(sh, "Queue high-water: control %u, telemetry %u",
+                stats.queue_high_water[CELLULAR_PRIORITY_CONTROL],
+                stats.queue_high_water[CELLULAR_PRIORITY_TELEMETRY]);
+
+    shell_print(sh, "Time in state:");
+    for (size_t i = 0; i < ARRAY_SIZE(state_names); i++) {
+        if (stats.time_in_state_ms[i] > 0) {
+            shell_print(sh, "  %-14s %lld s", state_names[i],
+                        stats.time_in_state_ms[i] / MSEC_PER_SEC);
+        }
+    }
+
+    if (stats.signal_valid) {
+        shell_print(sh, "Signal: RSRP %d dBm, RSRQ %d dB",
+                    stats.rsrp_dbm, stats.rsrq_db);
+    } else {
+        shell_print(sh, "Signal: not sampled");
+    }
+
+    return 0;
+}
+
+static int cmd_cellular_stats_reset(const struct shell *sh, size_t argc,
+                                    char **argv)
+{
+    cellular_stats_reset();
+    shell_print(sh, "Cellular statistics cleared");
+
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_cellular_stats,
+    SHELL_CMD(reset, NULL, "Clear the statistics", cmd_cellular_stats_reset),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_cellular,
+    SHELL_CMD(stats, &sub_cellular_stats, "Show link statistics",
+              cmd_cellular_stats),
+    SHELL_SUBCMD_SET_END
+);
+
+SHELL_CMD_REGISTER(cellular, &sub_cellular, "Cellular link commands", NULL);
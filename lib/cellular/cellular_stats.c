@@ -0,0 +1,197 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+
+#include <lib/cellular.h>
+
+#include "cellular_stats.h"
+
+#define MS_PER_HOUR (60LL * 60 * MSEC_PER_SEC)
+#define MS_PER_DAY  (24 * MS_PER_HOUR)
+
+/* Untagged traffic and traffic beyond the tag table are grouped together */
+#define OTHER_TAG "other"
+
+static struct k_spinlock stats_lock;
+static struct cellular_stats stats;
+static struct cellular_tag_stats tags[CONFIG_CELLULAR_STATS_MAX_TAGS + 1];
+static size_t num_tags;
+
+static int64_t hour_index;
+static int64_t day_index;
+
+static cellular_state_t current_state = CELLULAR_STATE_UNINITIALISED;
+static int64_t state_entered_at;
+
+/**
+ * @brief Start new hour and day windows if the uptime has moved past them.
+ *
+ * Must be called with stats_lock held.
+ */
+static void roll_windows(int64_t now)
+{
+    int64_t hour = now / MS_PER_HOUR;
+    int64_t day = now / MS_PER_DAY;
+
+    if (hour != hour_index) {
+        stats.last_hour = (hour == hour_index + 1) ?
+                          stats.hour : (struct cellular_traffic){0};
+        stats.hour = (struct cellular_traffic){0};
+        hour_index = hour;
+    }
+
+    if (day != day_index) {
+        stats.last_day = (day == day_index + 1) ?
+                         stats.day : (struct cellular_traffic){0};
+        stats.day = (struct cellular_traffic){0};
+        day_index = day;
+    }
+}
+
+/**
+ * @brief Find or add the traffic counters for a tag.
+ *
+ * Must be called with stats_lock held. Once the table is full, new tags are
+ * accounted under OTHER_TAG.
+ */
+static struct cellular_traffic *tag_traffic(const char *tag)
+{
+    if (tag == NULL) {
+        tag = OTHER_TAG;
+    }
+
+    for (size_t i = 0; i < num_tags; i++) {
+        if (tags[i].tag == tag || strcmp(tags[i].tag, tag) == 0) {
+            return &tags[i].traffic;
+        }
+    }
+
+    if (num_tags >= CONFIG_CELLULAR_STATS_MAX_TAGS &&
+        strcmp(tag, OTHER_TAG) != 0) {
+        return tag_traffic(OTHER_TAG);
+    }
+
+    tags[num_tags].tag = tag;
+    return &tags[num_tags++].traffic;
+}
+
+void cellular_stats_tx(const char *tag, size_t len)
+{
+    K_SPINLOCK(&stats_lock) {
+        roll_windows(k_uptime_get());
+
+        struct cellular_traffic *windows[] = {
+            &stats.total, &stats.hour, &stats.day, tag_traffic(tag),
+        };
+
+        for (size_t i = 0; i < ARRAY_SIZE(windows); i++) {
+            windows[i]->tx_bytes += len;
+            windows[i]->tx_packets++;
+        }
+    }
+}
+
+void cellular_stats_rx(size_t len)
+{
+    K_SPINLOCK(&stats_lock) {
+        roll_windows(k_uptime_get());
+
+        struct cellular_traffic *windows[] = {
+            &stats.total, &stats.hour, &stats.day,
+        };
+
+        for (size_t i = 0; i < ARRAY_SIZE(windows); i++) {
+            windows[i]->rx_bytes += len;
+            windows[i]->rx_packets++;
+        }
+    }
+}
+
+void cellular_stats_error(enum cellular_error_class error)
+{
+    if (error >= CELLULAR_ERROR_CLASS_COUNT) {
+        return;
+    }
+
+    K_SPINLOCK(&stats_lock) {
+        stats.errors[error]++;
+    }
+}
+
+void cellular_stats_queue_depth(enum cellular_priority priority,
+                                uint32_t depth)
+{
+    if (priority >= CELLULAR_PRIORITY_COUNT) {
+        return;
+    }
+
+    K_SPINLOCK(&stats_lock) {
+        stats.queue_high_water[priority] =
+            MAX(stats.queue_high_water[priority], depth);
+    }
+}
+
+void cellular_stats_state(cellular_state_t state)
+{
+    K_SPINLOCK(&stats_lock) {
+        int64_t now = k_uptime_get();
+
+        if (current_state <= CELLULAR_STATE_UNDEFINED) {
+            stats.time_in_state_ms[current_state] += now - state_entered_at;
+        }
+        current_state = state;
+        state_entered_at = now;
+    }
+}
+
+void cellular_stats_signal(int16_t rsrp_dbm, int16_t rsrq_db)
+{
+    K_SPINLOCK(&stats_lock) {
+        stats.signal_valid = true;
+        stats.rsrp_dbm = rsrp_dbm;
+        stats.rsrq_db = rsrq_db;
+    }
+}
+
+void cellular_stats_get(struct cellular_stats *out)
+{
+    K_SPINLOCK(&stats_lock) {
+        int64_t now = k_uptime_get();
+
+        roll_windows(now);
+        *out = stats;
+
+        /* Include the time spent in the current state so far */
+        if (current_state <= CELLULAR_STATE_UNDEFINED) {
+            out->time_in_state_ms[current_state] += now - state_entered_at;
+        }
+    }
+}
+
+int cellular_stats_tag_get(size_t index, struct cellular_tag_stats *out)
+{
+    int ret = -ENOENT;
+
+    K_SPINLOCK(&stats_lock) {
+        if (index < num_tags) {
+            *out = tags[index];
+            ret = 0;
+        }
+    }
+
+    return ret;
+}
+
+void cellular_stats_reset(void)
+{
+    K_SPINLOCK(&stats_lock) {
+        int64_t now = k_uptime_get();
+
+        memset(&stats, 0, sizeof(stats));
+        memset(tags, 0, sizeof(tags));
+        num_tags = 0;
+        hour_index = now / MS_PER_HOUR;
+        day_index = now / MS_PER_DAY;
+        state_entered_at = now;
+    }
+}
@@ -0,0 +1,35 @@
+#ifndef _LIB_CELLULAR_STATS_H_
+#define _LIB_CELLULAR_STATS_H_
+
+#include <zephyr/kernel.h>
+
+#include <lib/cellular.h>
+
+#ifdef CONFIG_CELLULAR_STATS
+
+void cellular_stats_tx(const char *tag, size_t len);
+
+void cellular_stats_rx(size_t len);
+
+void cellular_stats_error(enum cellular_error_class error);
+
+void cellular_stats_queue_depth(enum cellular_priority priority,
+                                uint32_t depth);
+
+void cellular_stats_state(cellular_state_t state);
+
+void cellular_stats_signal(int16_t rsrp_dbm, int16_t rsrq_db);
+
+#else
+
+static inline void cellular_stats_tx(const char *tag, size_t len) {}
+static inline void cellular_stats_rx(size_t len) {}
+static inline void cellular_stats_error(enum cellular_error_class error) {}
+static inline void cellular_stats_queue_depth(enum cellular_priority priority,
+                                              uint32_t depth) {}
+static inline void cellular_stats_state(cellular_state_t state) {}
+static inline void cellular_stats_signal(int16_t rsrp_dbm, int16_t rsrq_db) {}
+
+#endif /* CONFIG_CELLULAR_STATS */
+
+#endif /* _LIB_CELLULAR_STATS_H_ */
@@ -1,42 +1,56 @@
 #include <zephyr/kernel.h>
 #include <zephyr/net/coap.h>
+#include <zephyr/sys/byteorder.h>
 #include <zephyr/logging/log.h>
 
 #include <lib/coap.h>
 
+#include "coap_internal.h"
+
 LOG_MODULE_REGISTER(coap_lib, CONFIG_COAP_LIB_LOG_LEVEL);
 
-int coap_build_request(uint8_t *buf, size_t buf_len,
-                       enum coap_msgtype type,
-                       enum coap_method method,
-                       const char * const *uri_path,
-                       const uint8_t *payload, size_t payload_len)
+int coap_init_request(struct coap_packet *request,
+                      uint8_t *buf, size_t buf_len,
+                      enum coap_msgtype type,
+                      enum coap_method method,
+                      const char * const *uri_path,
+                      int observe,
+                      const uint8_t *token)
 {
     int ret;
-    struct coap_packet request;
 
     if (method < COAP_METHOD_GET || method > COAP_METHOD_DELETE) {
         LOG_ERR("Invalid method. Only GET PUT POST and DELETE are supported.");
         return -EINVAL;
     }
 
-    if (type != COAP_TYPE_NON_CON) {
-        LOG_ERR("Invalid msg type. Only NON-CON messages are supported.");
+    if (type != COAP_TYPE_NON_CON && type != COAP_TYPE_CON) {
+        LOG_ERR("Invalid msg type. Only CON and NON-CON requests are supported.");
         return -EINVAL;
     }
 
-    ret = coap_packet_init(&request, buf, buf_len,
+    ret = coap_packet_init(request, buf, buf_len,
                            COAP_VERSION_1, type,
-                           COAP_TOKEN_MAX_LEN, coap_next_token(),
+                           COAP_TOKEN_MAX_LEN,
+                           token != NULL ? token : coap_next_token(),
                            method, coap_next_id());
     if (ret != 0) {
         LOG_ERR("Failed to init CoAP message: %d", ret);
         return ret;
     }
 
+    /* Options are encoded in ascending order, Observe (6) before Uri-Path */
+    if (observe != NO_OBSERVE) {
+        ret = coap_append_option_int(request, COAP_OPTION_OBSERVE, observe);
+        if (ret != 0) {
+            LOG_ERR("Unable to add OBSERVE option: %d", ret);
+            return ret;
+        }
+    }
+
     if (uri_path) {
         for (const char * const *p = uri_path; *p; ++p) {
-            ret = coap_packet_append_option(&request, COAP_OPTION_URI_PATH,
+            ret = coap_packet_append_option(request, COAP_OPTION_URI_PATH,
                                             *p, strlen(*p));
             if (ret != 0) {
                 LOG_ERR("Unable to add URI_PATH option: %d", ret);
@@ -45,6 +59,50 @@ int coap_build_request(uint8_t *buf, size_t buf_len,
         }
     }
 
+    return 0;
+}
+
+int coap_build_request_header(uint8_t *buf, size_t buf_len,
+                              enum coap_msgtype type,
+                              enum coap_method method,
+                              const char * const *uri_path,
+                              bool payload_follows)
+{
+    int ret;
+    struct coap_packet request;
+
+    ret = coap_init_request(&request, buf, buf_len, type, method, uri_path,
+                            NO_OBSERVE, NULL);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (payload_follows) {
+        ret = coap_packet_append_payload_marker(&request);
+        if (ret != 0) {
+            LOG_ERR("Failed to add payload marker: %d", ret);
+            return ret;
+        }
+    }
+
+    return request.offset;
+}
+
+int coap_build_request(uint8_t *buf, size_t buf_len,
+                       enum coap_msgtype type,
+                       enum coap_method method,
+                       const char * const *uri_path,
+                       const uint8_t *payload, size_t payload_len)
+{
+    int ret;
+    struct coap_packet request;
+
+    ret = coap_init_request(&request, buf, buf_len, type, method, uri_path,
+                            NO_OBSERVE, NULL);
+    if (ret != 0) {
+        return ret;
+    }
+
     if ((method == COAP_METHOD_PUT || method == COAP_METHOD_POST) &&
         (payload && payload_len > 0)) {
         ret = coap_packet_append_payload_marker(&request);
@@ -62,3 +120,95 @@ int coap_build_request(uint8_t *buf, size_t buf_len,
 
     return request.offset;
 }
+
+static int template_init(struct coap_request_template *tpl,
+                         enum coap_msgtype type,
+                         enum coap_method method,
+                         const char * const *uri_path,
+                         int observe)
+{
+    if (tpl == NULL) {
+        return -EINVAL;
+    }
+
+    /* Encode a throwaway request and keep everything after the token */
+    uint8_t scratch[COAP_TOKEN_MAX_LEN + COAP_FIXED_HEADER_SIZE +
+                    CONFIG_COAP_TEMPLATE_MAX_OPTIONS_LEN];
+    struct coap_packet request;
+
+    int ret = coap_init_request(&request, scratch, sizeof(scratch), type,
+                                method, uri_path, observe, NULL);
+    if (ret != 0) {
+        LOG_ERR("Failed to encode template options: %d", ret);
+        return ret;
+    }
+
+    size_t options_start = COAP_FIXED_HEADER_SIZE + COAP_TOKEN_MAX_LEN;
+
+    tpl->type = type;
+    tpl->method = method;
+    tpl->options_len = request.offset - options_start;
+    memcpy(tpl->options, &scratch[options_start], tpl->options_len);
+
+    return 0;
+}
+
+int coap_template_init(struct coap_request_template *tpl,
+                       enum coap_msgtype type,
+                       enum coap_method method,
+                       const char * const *uri_path)
+{
+    return template_init(tpl, type, method, uri_path, NO_OBSERVE);
+}
+
+int coap_template_init_observe(struct coap_request_template *tpl,
+                               const char * const *uri_path,
+                               uint32_t observe)
+{
+    if (observe > 1) {
+        return -EINVAL;
+    }
+
+    return template_init(tpl, COAP_TYPE_NON_CON, COAP_METHOD_GET, uri_path,
+                         observe);
+}
+
+int coap_template_build(const struct coap_request_template *tpl,
+                        uint8_t *buf, size_t buf_len,
+                        bool payload_follows)
+{
+    return coap_template_build_token(tpl, coap_next_token(), buf, buf_len,
+                                     payload_follows);
+}
+
+int coap_template_build_token(const struct coap_request_template *tpl,
+                              const uint8_t *token,
+                              uint8_t *buf, size_t buf_len,
+                              bool payload_follows)
+{
+    if (tpl == NULL || token == NULL || buf == NULL) {
+        return -EINVAL;
+    }
+
+    size_t len = COAP_FIXED_HEADER_SIZE + COAP_TOKEN_MAX_LEN +
+                 tpl->options_len + (payload_follows ? 1 : 0);
+    if (len > buf_len) {
+        return -ENOMEM;
+    }
+
+    /* Patch in the per-request fields, see RFC 7252 section 3 */
+    buf[0] = (COAP_VERSION_1 << 6) | (tpl->type << 4) | COAP_TOKEN_MAX_LEN;
+    buf[1] = tpl->method;
+    sys_put_be16(coap_next_id(), &buf[2]);
+    memcpy(&buf[COAP_FIXED_HEADER_SIZE], token, COAP_TOKEN_MAX_LEN);
+
+    uint8_t *p = &buf[COAP_FIXED_HEADER_SIZE + COAP_TOKEN_MAX_LEN];
+    memcpy(p, tpl->options, tpl->options_len);
+    p += tpl->options_len;
+
+    if (payload_follows) {
+        *p = COAP_MARKER;
+    }
+
+    return len;
+}
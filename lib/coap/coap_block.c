@@ -0,0 +1,556 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+#include <lib/coap.h>
+
+#include "coap_internal.h"
+#include "coap_pending.h"
+
+LOG_MODULE_DECLARE(coap_lib, CONFIG_COAP_LIB_LOG_LEVEL);
+
+/*
+ * Block-wise transfers (RFC 7959)
+ *
+ * Each transfer occupies a slot in the transfer table, whose lock and
+ * response timer are managed by coap_pending. A transfer has at most
+ * one block in flight. The encoded request is kept in the slot so it can be
+ * resent unchanged, and the next block is only read or requested once the
+ * response to the current one arrives. Bodies are streamed through the read
+ * and write callbacks, so only one block is ever held in RAM.
+ *
+ * Requests are NON-CON. When the timer expires, every overdue block is resent
+ * with a doubled timeout and transfers that have exhausted
+ * CONFIG_COAP_BLOCK_MAX_RETRANSMIT are failed. Each resend
+ * gets a fresh message ID, as a server would otherwise drop it as a duplicate
+ * (RFC 7252 section 4.5). Responses are matched by token and block number,
+ * so an answer to any of the copies is accepted.
+ *
+ * The block size is the largest power of two that, with the message
+ * overhead, fits the MTUs given to coap_block_init(). Requests are also
+ * bounded by CONFIG_COAP_MAX_MSG_LEN, which sizes the slot buffers. A server
+ * may reduce the block size further by answering with a smaller SZX, which
+ * is adopted for the rest of the transfer.
+ *
+ * Completion callbacks are always invoked without the lock held.
+ */
+
+BUILD_ASSERT(IS_POWER_OF_TWO(CONFIG_COAP_BLOCK_MAX_SIZE),
+             "CoAP block sizes are powers of two");
+
+/* Block option value fields, RFC 7959 section 2.2 */
+#define BLOCK_NUM(value)   ((uint32_t)(value) >> 4)
+#define BLOCK_MORE(value)  (((value) & 0x8) != 0)
+#define BLOCK_SZX(value)   ((enum coap_block_size)((value) & 0x7))
+#define BLOCK_VALUE(num, more, szx) \
+    (((num) << 4) | ((more) ? 0x8 : 0) | (szx))
+
+/* Block1 (1 + 1 byte delta + 3) and Size1 (1 + 1 byte delta + 4) options
+ * plus the payload marker */
+#define BLOCK1_OPTIONS_MAX_LEN 12
+
+/* Header, token, ETag, Content-Format, Block2, Size2 and the payload marker
+ * of a Block2 response */
+#define BLOCK2_RESPONSE_OVERHEAD                                             \
+    (COAP_FIXED_HEADER_SIZE + COAP_TOKEN_MAX_LEN + 9 + 3 + 5 + 6 + 1)
+
+/* Largest request: uploads never use more than the transmit MTU, which
+ * coap_block_init() caps at CONFIG_COAP_MAX_MSG_LEN */
+#define BLOCK_MSG_MAX_LEN                                                    \
+    MIN(CONFIG_COAP_MAX_MSG_LEN,                                             \
+        COAP_FIXED_HEADER_SIZE + COAP_TOKEN_MAX_LEN +                        \
+        CONFIG_COAP_TEMPLATE_MAX_OPTIONS_LEN + BLOCK1_OPTIONS_MAX_LEN +      \
+        CONFIG_COAP_BLOCK_MAX_SIZE)
+
+struct coap_block_transfer {
+    bool upload;
+    enum coap_method method;
+    const char * const *uri_path;
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    enum coap_block_size block_size;
+    /* Body offset and payload length of the block in flight */
+    size_t offset;
+    size_t block_len;
+    size_t total_len;
+    uint8_t retransmits;
+    uint32_t timeout_ms;
+    coap_block_read_cb_t read;
+    coap_block_write_cb_t write;
+    coap_block_done_cb_t done;
+    void *user_data;
+    /* Encoded request of the block in flight */
+    uint8_t *buf;
+    size_t len;
+};
+
+static int coap_block_retry(int slot, int64_t now, int64_t *deadline);
+static void coap_block_expire(int slot);
+
+COAP_PENDING_DEFINE(block_pending, CONFIG_COAP_BLOCK_MAX_TRANSFERS,
+                    coap_block_retry, coap_block_expire);
+
+static struct coap_block_transfer transfers[CONFIG_COAP_BLOCK_MAX_TRANSFERS];
+static uint8_t transfer_bufs[CONFIG_COAP_BLOCK_MAX_TRANSFERS][BLOCK_MSG_MAX_LEN];
+
+static coap_block_send_t transport_send;
+static size_t transport_tx_mtu;
+static size_t transport_rx_mtu;
+
+/**
+ * @brief Largest block size that fits in the MTU after the given overhead.
+ */
+static int block_size_for_mtu(size_t mtu, size_t overhead,
+                              enum coap_block_size *block_size)
+{
+    for (int szx = COAP_BLOCK_1024; szx >= COAP_BLOCK_16; szx--) {
+        size_t bytes = coap_block_size_to_bytes(szx);
+
+        if (bytes <= CONFIG_COAP_BLOCK_MAX_SIZE && overhead + bytes <= mtu) {
+            *block_size = szx;
+            return 0;
+        }
+    }
+
+    return -EMSGSIZE;
+}
+
+/**
+ * @brief Encode the request for the block at xfer->offset.
+ *
+ * Uploads read the block payload straight into the message buffer.
+ */
+static int encode_block(struct coap_block_transfer *xfer)
+{
+    struct coap_packet request;
+    size_t block_bytes = coap_block_size_to_bytes(xfer->block_size);
+    uint32_t num = xfer->offset / block_bytes;
+
+    int ret = coap_init_request(&request, xfer->buf, BLOCK_MSG_MAX_LEN,
+                                COAP_TYPE_NON_CON, xfer->method,
+                                xfer->uri_path, NO_OBSERVE, xfer->token);
+    if (ret != 0) {
+        return ret;
+    }
+
+    if (!xfer->upload) {
+        ret = coap_append_option_int(&request, COAP_OPTION_BLOCK2,
+                                     BLOCK_VALUE(num, false,
+                                                 xfer->block_size));
+        if (ret != 0) {
+            return ret;
+        }
+
+        xfer->len = request.offset;
+        return 0;
+    }
+
+    xfer->block_len = MIN(block_bytes, xfer->total_len - xfer->offset);
+    bool more = xfer->offset + xfer->block_len < xfer->total_len;
+
+    ret = coap_append_option_int(&request, COAP_OPTION_BLOCK1,
+                                 BLOCK_VALUE(num, more, xfer->block_size));
+    if (ret != 0) {
+        return ret;
+    }
+
+    /* Announce the body size up front so the server can reject it early */
+    if (xfer->offset == 0) {
+        ret = coap_append_option_int(&request, COAP_OPTION_SIZE1,
+                                     xfer->total_len);
+        if (ret != 0) {
+            return ret;
+        }
+    }
+
+    if (xfer->block_len > 0) {
+        ret = coap_packet_append_payload_marker(&request);
+        if (ret != 0) {
+            return ret;
+        }
+
+        if (request.max_len - request.offset < xfer->block_len) {
+            return -ENOMEM;
+        }
+
+        ret = xfer->read(xfer->offset, &xfer->buf[request.offset],
+                         xfer->block_len, xfer->user_data);
+        if (ret < 0) {
+            return ret;
+        }
+
+        if ((size_t)ret != xfer->block_len) {
+            LOG_ERR("Short read at offset %zu: %d", xfer->offset, ret);
+            return -EIO;
+        }
+
+        request.offset += xfer->block_len;
+    }
+
+    xfer->len = request.offset;
+    return 0;
+}
+
+/**
+ * @brief Encode and send the block at xfer->offset.
+ *
+ * Must be called with the lock held.
+ */
+static int send_block(struct coap_block_transfer *xfer)
+{
+    int err = encode_block(xfer);
+    if (err != 0) {
+        LOG_ERR("Failed to encode block at offset %zu: %d", xfer->offset,
+                err);
+        return err;
+    }
+
+    xfer->retransmits = 0;
+    xfer->timeout_ms = CONFIG_COAP_BLOCK_TIMEOUT_MS;
+    coap_pending_schedule(&block_pending, xfer - transfers,
+                          k_uptime_get() + xfer->timeout_ms);
+
+    /* A failed transmission is retried like a lost message */
+    err = transport_send(xfer->buf, xfer->len);
+    if (err != 0) {
+        LOG_WRN("Transmission of block at offset %zu failed: %d",
+                xfer->offset, err);
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Process the response to an upload block.
+ *
+ * @return 1 if the transfer continues, 0 if it is complete, or negative
+ *         errno code if it failed.
+ */
+static int handle_upload_response(struct coap_block_transfer *xfer,
+                                  const struct coap_packet *response)
+{
+    uint8_t code = coap_header_get_code(response);
+    int block1 = coap_get_option_int(response, COAP_OPTION_BLOCK1);
+
+    /* The server may ask for smaller blocks by rejecting the first one */
+    if (code == COAP_RESPONSE_CODE_REQUEST_TOO_LARGE && block1 >= 0 &&
+        xfer->offset == 0 && BLOCK_SZX(block1) < xfer->block_size) {
+        xfer->block_size = BLOCK_SZX(block1);
+        LOG_INF("Server requested %u byte blocks",
+                coap_block_size_to_bytes(xfer->block_size));
+        int err = send_block(xfer);
+        return err == 0 ? 1 : err;
+    }
+
+    if (code >> 5 != 2) {
+        LOG_WRN("Upload rejected with %u.%02u", code >> 5, code & 0x1f);
+        return -EIO;
+    }
+
+    size_t acked = xfer->block_len;
+
+    if (block1 >= 0) {
+        enum coap_block_size szx = BLOCK_SZX(block1);
+        size_t block_bytes = coap_block_size_to_bytes(szx);
+
+        if (szx > xfer->block_size) {
+            return -EPROTO;
+        }
+
+        /* A late response to an earlier block */
+        if (BLOCK_NUM(block1) * block_bytes != xfer->offset) {
+            return 1;
+        }
+
+        /* A smaller SZX acknowledges only the first block_bytes */
+        acked = MIN(acked, block_bytes);
+        xfer->block_size = szx;
+    }
+
+    if (xfer->offset + acked >= xfer->total_len) {
+        return 0;
+    }
+
+    xfer->offset += acked;
+
+    int err = send_block(xfer);
+    return err == 0 ? 1 : err;
+}
+
+/**
+ * @brief Process the response to a download block request.
+ *
+ * @return 1 if the transfer continues, 0 if it is complete, or negative
+ *         errno code if it failed.
+ */
+static int handle_download_response(struct coap_block_transfer *xfer,
+                                    const struct coap_packet *response)
+{
+    uint8_t code = coap_header_get_code(response);
+    uint16_t payload_len;
+    const uint8_t *payload = coap_packet_get_payload(response, &payload_len);
+
+    if (code != COAP_RESPONSE_CODE_CONTENT) {
+        LOG_WRN("Download failed with %u.%02u", code >> 5, code & 0x1f);
+        return -EIO;
+    }
+
+    int block2 = coap_get_option_int(response, COAP_OPTION_BLOCK2);
+
+    /* The whole body fitted in a single response */
+    if (block2 < 0) {
+        if (xfer->offset != 0) {
+            return -EPROTO;
+        }
+
+        int err = xfer->write(0, payload, payload_len, true,
+                              xfer->user_data);
+        return err < 0 ? err : 0;
+    }
+
+    enum coap_block_size szx = BLOCK_SZX(block2);
+    size_t block_bytes = coap_block_size_to_bytes(szx);
+    bool more = BLOCK_MORE(block2);
+
+    if (szx > xfer->block_size || (more && payload_len != block_bytes)) {
+        return -EPROTO;
+    }
+
+    /* A late response to an earlier block */
+    if (BLOCK_NUM(block2) * block_bytes != xfer->offset) {
+        return 1;
+    }
+
+    int err = xfer->write(xfer->offset, payload, payload_len, !more,
+                          xfer->user_data);
+    if (err < 0) {
+        return err;
+    }
+
+    if (!more) {
+        return 0;
+    }
+
+    xfer->block_size = szx;
+    xfer->offset += payload_len;
+
+    err = send_block(xfer);
+    return err == 0 ? 1 : err;
+}
+
+static int coap_block_retry(int slot, int64_t now, int64_t *deadline)
+{
+    struct coap_block_transfer *xfer = &transfers[slot];
+
+    if (xfer->retransmits >= CONFIG_COAP_BLOCK_MAX_RETRANSMIT) {
+        LOG_WRN("No response for block at offset %zu", xfer->offset);
+        return -ETIMEDOUT;
+    }
+
+    xfer->retransmits++;
+    xfer->timeout_ms *= 2;
+    *deadline = now + xfer->timeout_ms;
+
+    LOG_INF("Resending block at offset %zu (%u/%u)", xfer->offset,
+            xfer->retransmits, CONFIG_COAP_BLOCK_MAX_RETRANSMIT);
+
+    sys_put_be16(coap_next_id(), &xfer->buf[2]);
+
+    int err = transport_send(xfer->buf, xfer->len);
+    if (err != 0) {
+        LOG_WRN("Retransmission of block failed: %d", err);
+    }
+
+    return 0;
+}
+
+static void coap_block_expire(int slot)
+{
+    struct coap_block_transfer *xfer = &transfers[slot];
+
+    if (xfer->done != NULL) {
+        xfer->done(-ETIMEDOUT, 0, xfer->user_data);
+    }
+}
+
+/**
+ * @brief Claim a transfer slot and send the first block.
+ */
+static int start_transfer(struct coap_block_transfer *init)
+{
+    k_mutex_lock(&block_pending.lock, K_FOREVER);
+
+    if (transport_send == NULL) {
+        k_mutex_unlock(&block_pending.lock);
+        return -ENODEV;
+    }
+
+    int slot = coap_pending_claim(&block_pending);
+    if (slot < 0) {
+        k_mutex_unlock(&block_pending.lock);
+        LOG_WRN("No free block transfer slots.");
+        return -EBUSY;
+    }
+
+    struct coap_block_transfer *xfer = &transfers[slot];
+    *xfer = *init;
+    xfer->buf = transfer_bufs[slot];
+    memcpy(xfer->token, coap_next_token(), sizeof(xfer->token));
+
+    /* Size blocks to the MTU, accounting for this request's own header */
+    size_t overhead = BLOCK2_RESPONSE_OVERHEAD;
+    size_t mtu = transport_rx_mtu;
+    if (xfer->upload) {
+        struct coap_packet request;
+
+        int err = coap_init_request(&request, xfer->buf, BLOCK_MSG_MAX_LEN,
+                                    COAP_TYPE_NON_CON, xfer->method,
+                                    xfer->uri_path, NO_OBSERVE, xfer->token);
+        if (err != 0) {
+            k_mutex_unlock(&block_pending.lock);
+            return err;
+        }
+
+        overhead = request.offset + BLOCK1_OPTIONS_MAX_LEN;
+        mtu = transport_tx_mtu;
+    }
+
+    int err = block_size_for_mtu(mtu, overhead, &xfer->block_size);
+    if (err != 0) {
+        k_mutex_unlock(&block_pending.lock);
+        LOG_ERR("MTU of %zu too small for block-wise transfer", mtu);
+        return err;
+    }
+
+    err = send_block(xfer);
+
+    k_mutex_unlock(&block_pending.lock);
+
+    if (err != 0) {
+        return err;
+    }
+
+    LOG_INF("Started block-wise %s with %u byte blocks",
+            init->upload ? "upload" : "download",
+            coap_block_size_to_bytes(xfer->block_size));
+
+    return 0;
+}
+
+int coap_block_init(coap_block_send_t send, size_t tx_mtu, size_t rx_mtu)
+{
+    if (send == NULL || tx_mtu == 0 || rx_mtu == 0) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&block_pending.lock, K_FOREVER);
+    transport_send = send;
+    transport_tx_mtu = MIN(tx_mtu, BLOCK_MSG_MAX_LEN);
+    transport_rx_mtu = rx_mtu;
+    k_mutex_unlock(&block_pending.lock);
+
+    return 0;
+}
+
+int coap_block_upload(enum coap_method method, const char * const *uri_path,
+                      size_t total_len, coap_block_read_cb_t read,
+                      coap_block_done_cb_t done, void *user_data)
+{
+    if ((method != COAP_METHOD_PUT && method != COAP_METHOD_POST) ||
+        read == NULL) {
+        return -EINVAL;
+    }
+
+    struct coap_block_transfer init = {
+        .upload = true,
+        .method = method,
+        .uri_path = uri_path,
+        .total_len = total_len,
+        .read = read,
+        .done = done,
+        .user_data = user_data,
+    };
+
+    return start_transfer(&init);
+}
+
+int coap_block_download(const char * const *uri_path,
+                        coap_block_write_cb_t write,
+                        coap_block_done_cb_t done, void *user_data)
+{
+    if (write == NULL) {
+        return -EINVAL;
+    }
+
+    struct coap_block_transfer init = {
+        .upload = false,
+        .method = COAP_METHOD_GET,
+        .uri_path = uri_path,
+        .write = write,
+        .done = done,
+        .user_data = user_data,
+    };
+
+    return start_transfer(&init);
+}
+
+int coap_block_handle_message(const struct coap_packet *response)
+{
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+
+    if (response == NULL) {
+        return -EINVAL;
+    }
+
+    if (coap_header_get_token(response, token) != COAP_TOKEN_MAX_LEN) {
+        return -ENOENT;
+    }
+
+    int slot = -ENOENT;
+    int result = 0;
+
+    k_mutex_lock(&block_pending.lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_COAP_BLOCK_MAX_TRANSFERS; i++) {
+        struct coap_block_transfer *xfer = &transfers[i];
+
+        if (!(block_pending.active & BIT(i)) ||
+            memcmp(xfer->token, token, sizeof(token)) != 0) {
+            continue;
+        }
+
+        result = xfer->upload ? handle_upload_response(xfer, response) :
+                                handle_download_response(xfer, response);
+        if (result <= 0) {
+            coap_pending_finish(&block_pending, i);
+        }
+
+        slot = i;
+        break;
+    }
+
+    k_mutex_unlock(&block_pending.lock);
+
+    if (slot < 0) {
+        return slot;
+    }
+
+    if (result <= 0) {
+        struct coap_block_transfer *xfer = &transfers[slot];
+
+        if (xfer->done != NULL) {
+            xfer->done(result, coap_header_get_code(response),
+                       xfer->user_data);
+        }
+
+        coap_pending_release(&block_pending, slot);
+    }
+
+    return 0;
+}
+
+uint32_t coap_block_active_count(void)
+{
+    return coap_pending_count(&block_pending);
+}
@@ -0,0 +1,203 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/random/random.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/logging/log.h>
+
+#include <lib/coap.h>
+
+#include "coap_pending.h"
+
+LOG_MODULE_DECLARE(coap_lib, CONFIG_COAP_LIB_LOG_LEVEL);
+
+/*
+ * Confirmable message transmission
+ *
+ * Each confirmable message occupies a slot in the pending table until it is
+ * acknowledged, reset, or runs out of retransmissions. The table, its lock
+ * and the retransmission timer are managed by coap_pending.
+ *
+ * When the timer expires, every due message is resent with a doubled timeout
+ * (RFC 7252 section 4.2) and any that have exhausted
+ * CONFIG_COAP_CON_MAX_RETRANSMIT are failed.
+ *
+ * Delivery callbacks are always invoked without the lock held.
+ */
+
+struct coap_con_entry {
+    uint16_t msg_id;
+    uint8_t retransmits;
+    uint32_t timeout_ms;
+    coap_con_cb_t callback;
+    void *user_data;
+    size_t len;
+    uint8_t buf[CONFIG_COAP_MAX_MSG_LEN];
+};
+
+static int coap_con_retry(int slot, int64_t now, int64_t *deadline);
+static void coap_con_expire(int slot);
+
+COAP_PENDING_DEFINE(con_pending, CONFIG_COAP_CON_MAX_PENDING,
+                    coap_con_retry, coap_con_expire);
+
+static struct coap_con_entry pending_table[CONFIG_COAP_CON_MAX_PENDING];
+
+static coap_con_send_t transport_send;
+
+/** @brief Initial timeout between ACK_TIMEOUT and ACK_TIMEOUT * 1.5. */
+static uint32_t initial_timeout_ms(void)
+{
+    uint32_t spread = CONFIG_COAP_CON_ACK_TIMEOUT_MS / 2;
+
+    return CONFIG_COAP_CON_ACK_TIMEOUT_MS + sys_rand32_get() % (spread + 1);
+}
+
+static int coap_con_retry(int slot, int64_t now, int64_t *deadline)
+{
+    struct coap_con_entry *entry = &pending_table[slot];
+
+    if (entry->retransmits >= CONFIG_COAP_CON_MAX_RETRANSMIT) {
+        LOG_WRN("CON message %u not acknowledged", entry->msg_id);
+        return -ETIMEDOUT;
+    }
+
+    entry->retransmits++;
+    entry->timeout_ms *= 2;
+    *deadline = now + entry->timeout_ms;
+
+    LOG_INF("Retransmitting CON message %u (%u/%u)", entry->msg_id,
+            entry->retransmits, CONFIG_COAP_CON_MAX_RETRANSMIT);
+
+    int err = transport_send(entry->buf, entry->len);
+    if (err != 0) {
+        LOG_WRN("Retransmission of %u failed: %d", entry->msg_id, err);
+    }
+
+    return 0;
+}
+
+static void coap_con_expire(int slot)
+{
+    struct coap_con_entry *entry = &pending_table[slot];
+
+    if (entry->callback != NULL) {
+        entry->callback(entry->msg_id, COAP_CON_TIMEOUT, entry->user_data);
+    }
+}
+
+int coap_con_init(coap_con_send_t send)
+{
+    if (send == NULL) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&con_pending.lock, K_FOREVER);
+    transport_send = send;
+    k_mutex_unlock(&con_pending.lock);
+
+    return 0;
+}
+
+int coap_con_send(const uint8_t *buf, size_t len,
+                  coap_con_cb_t cb, void *user_data)
+{
+    if (buf == NULL || len < COAP_FIXED_HEADER_SIZE ||
+        len > CONFIG_COAP_MAX_MSG_LEN) {
+        return -EINVAL;
+    }
+
+    /* Only confirmable messages are tracked, see RFC 7252 section 3 */
+    uint8_t type = (buf[0] >> 4) & 0x3;
+    if (type != COAP_TYPE_CON) {
+        LOG_ERR("Message is not confirmable.");
+        return -EINVAL;
+    }
+
+    uint16_t msg_id = sys_get_be16(&buf[2]);
+
+    k_mutex_lock(&con_pending.lock, K_FOREVER);
+
+    if (transport_send == NULL) {
+        k_mutex_unlock(&con_pending.lock);
+        return -ENODEV;
+    }
+
+    int slot = coap_pending_claim(&con_pending);
+    if (slot < 0) {
+        k_mutex_unlock(&con_pending.lock);
+        LOG_WRN("No free CON slots.");
+        return slot;
+    }
+
+    struct coap_con_entry *entry = &pending_table[slot];
+    entry->msg_id = msg_id;
+    entry->retransmits = 0;
+    entry->timeout_ms = initial_timeout_ms();
+    entry->callback = cb;
+    entry->user_data = user_data;
+    entry->len = len;
+    memcpy(entry->buf, buf, len);
+
+    /* A failed first transmission is retried like a lost message */
+    int err = transport_send(entry->buf, entry->len);
+    if (err != 0) {
+        LOG_WRN("Transmission of %u failed: %d", msg_id, err);
+    }
+
+    coap_pending_schedule(&con_pending, slot,
+                          k_uptime_get() + entry->timeout_ms);
+
+    k_mutex_unlock(&con_pending.lock);
+
+    return 0;
+}
+
+int coap_con_handle_message(const struct coap_packet *message)
+{
+    if (message == NULL) {
+        return -EINVAL;
+    }
+
+    uint8_t type = coap_header_get_type(message);
+    if (type != COAP_TYPE_ACK && type != COAP_TYPE_RESET) {
+        return -ENOENT;
+    }
+
+    uint16_t msg_id = coap_header_get_id(message);
+    int slot = -ENOENT;
+
+    k_mutex_lock(&con_pending.lock, K_FOREVER);
+
+    for (int i = 0; i < CONFIG_COAP_CON_MAX_PENDING; i++) {
+        if ((con_pending.active & BIT(i)) &&
+            pending_table[i].msg_id == msg_id) {
+            coap_pending_finish(&con_pending, i);
+            slot = i;
+            break;
+        }
+    }
+
+    k_mutex_unlock(&con_pending.lock);
+
+    if (slot < 0) {
+        return slot;
+    }
+
+    struct coap_con_entry *entry = &pending_table[slot];
+    if (entry->callback != NULL) {
+        entry->callback(msg_id,
+                        type == COAP_TYPE_ACK ? COAP_CON_DELIVERED :
+                                                COAP_CON_RESET,
+                        entry->user_data);
+    }
+
+    coap_pending_release(&con_pending, slot);
+
+    return 0;
+}
+
+uint32_t coap_con_pending_count(void)
+{
+    return coap_pending_count(&con_pending);
+}
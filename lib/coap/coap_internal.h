@@ -0,0 +1,24 @@
+#ifndef _LIB_COAP_INTERNAL_H_
+#define _LIB_COAP_INTERNAL_H_
+
+#include <zephyr/net/coap.h>
+
+/* Marks a request without an Observe option */
+#define NO_OBSERVE -1
+
+/**
+ * @brief Start a request with the given Observe value and URI path options.
+ *
+ * @param token  COAP_TOKEN_MAX_LEN byte token, or NULL for a fresh token.
+ *
+ * @return 0 on success, or negative errno code on failure.
+ */
+int coap_init_request(struct coap_packet *request,
+                      uint8_t *buf, size_t buf_len,
+                      enum coap_msgtype type,
+                      enum coap_method method,
+                      const char * const *uri_path,
+                      int observe,
+                      const uint8_t *token);
+
+#endif /* _LIB_COAP_INTERNAL_H_ */
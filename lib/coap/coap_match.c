@@ -0,0 +1,167 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/net/coap.h>
+#include <zephyr/logging/log.h>
+
+#include <lib/coap.h>
+
+#include "coap_pending.h"
+
+LOG_MODULE_DECLARE(coap_lib, CONFIG_COAP_LIB_LOG_LEVEL);
+
+/*
+ * Response matching
+ *
+ * Each outstanding request occupies a slot in the match table, keyed by its
+ * token, until a response arrives or the entry expires. The table, its lock
+ * and the expiry timer are managed by coap_pending. Entries registered with
+ * COAP_MATCH_MULTIPLE, such as Observe registrations, stay in the table after
+ * a match and are only removed on expiry or cancellation.
+ *
+ * When the timer expires, every expired entry is failed with -ETIMEDOUT.
+ *
+ * Callbacks are always invoked without the lock held.
+ */
+
+struct coap_match_entry {
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    uint32_t flags;
+    coap_match_cb_t callback;
+    void *user_data;
+};
+
+static void coap_match_expire(int slot);
+
+COAP_PENDING_DEFINE(match_pending, CONFIG_COAP_MATCH_MAX_PENDING, NULL,
+                    coap_match_expire);
+
+static struct coap_match_entry match_table[CONFIG_COAP_MATCH_MAX_PENDING];
+
+/**
+ * @brief Find the slot holding a token.
+ *
+ * Must be called with the lock held.
+ *
+ * @return Slot index, or -ENOENT if the token is not registered.
+ */
+static int find_token(const uint8_t *token)
+{
+    for (int i = 0; i < CONFIG_COAP_MATCH_MAX_PENDING; i++) {
+        if ((match_pending.active & BIT(i)) &&
+            memcmp(match_table[i].token, token, COAP_TOKEN_MAX_LEN) == 0) {
+            return i;
+        }
+    }
+
+    return -ENOENT;
+}
+
+static void coap_match_expire(int slot)
+{
+    struct coap_match_entry *entry = &match_table[slot];
+
+    entry->callback(NULL, -ETIMEDOUT, entry->user_data);
+}
+
+int coap_match_register(const uint8_t *token, uint32_t timeout_ms,
+                        uint32_t flags, coap_match_cb_t cb, void *user_data)
+{
+    if (token == NULL || cb == NULL) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&match_pending.lock, K_FOREVER);
+
+    /* Registering a token again refreshes it */
+    int slot = find_token(token);
+    if (slot < 0) {
+        slot = coap_pending_claim(&match_pending);
+    }
+
+    if (slot < 0) {
+        k_mutex_unlock(&match_pending.lock);
+        LOG_WRN("No free response match slots.");
+        return slot;
+    }
+
+    struct coap_match_entry *entry = &match_table[slot];
+    memcpy(entry->token, token, COAP_TOKEN_MAX_LEN);
+    entry->flags = flags;
+    entry->callback = cb;
+    entry->user_data = user_data;
+
+    coap_pending_schedule(&match_pending, slot, k_uptime_get() + timeout_ms);
+
+    k_mutex_unlock(&match_pending.lock);
+
+    return 0;
+}
+
+int coap_match_cancel(const uint8_t *token)
+{
+    if (token == NULL) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&match_pending.lock, K_FOREVER);
+
+    int slot = find_token(token);
+    if (slot >= 0) {
+        coap_pending_remove(&match_pending, slot);
+    }
+
+    k_mutex_unlock(&match_pending.lock);
+
+    return slot < 0 ? slot : 0;
+}
+
+int coap_match_handle_message(const struct coap_packet *response)
+{
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+
+    if (response == NULL) {
+        return -EINVAL;
+    }
+
+    /* Requests and empty messages never answer one of ours */
+    uint8_t code = coap_header_get_code(response);
+    if (code == COAP_CODE_EMPTY || (code >> 5) == 0) {
+        return -ENOENT;
+    }
+
+    if (coap_header_get_token(response, token) != COAP_TOKEN_MAX_LEN) {
+        return -ENOENT;
+    }
+
+    coap_match_cb_t callback = NULL;
+    void *user_data = NULL;
+
+    k_mutex_lock(&match_pending.lock, K_FOREVER);
+
+    int slot = find_token(token);
+    if (slot >= 0) {
+        /* Entries kept for further responses may be re-registered or
+         * cancelled while the callback runs */
+        callback = match_table[slot].callback;
+        user_data = match_table[slot].user_data;
+
+        if (!(match_table[slot].flags & COAP_MATCH_MULTIPLE)) {
+            coap_pending_remove(&match_pending, slot);
+        }
+    }
+
+    k_mutex_unlock(&match_pending.lock);
+
+    if (slot < 0) {
+        return slot;
+    }
+
+    callback(response, 0, user_data);
+
+    return 0;
+}
+
+uint32_t coap_match_pending_count(void)
+{
+    return coap_pending_count(&match_pending);
+}
@@ -0,0 +1,123 @@
+#include <zephyr/kernel.h>
+
+#include "coap_pending.h"
+
+/**
+ * @brief Arm the timer for the earliest deadline.
+ *
+ * Must be called with the lock held.
+ */
+static void rearm_timer(struct coap_pending *pending)
+{
+    int64_t earliest = INT64_MAX;
+
+    for (int i = 0; i < pending->size; i++) {
+        if (pending->active & BIT(i)) {
+            earliest = MIN(earliest, pending->deadlines[i]);
+        }
+    }
+
+    if (earliest == INT64_MAX) {
+        k_timer_stop(&pending->timer);
+        return;
+    }
+
+    int64_t delay = MAX(earliest - k_uptime_get(), 0);
+    k_timer_start(&pending->timer, K_MSEC(delay), K_NO_WAIT);
+}
+
+void coap_pending_timer_expiry(struct k_timer *timer)
+{
+    struct coap_pending *pending =
+        CONTAINER_OF(timer, struct coap_pending, timer);
+
+    k_work_submit(&pending->timeout_work);
+}
+
+void coap_pending_timeout_handler(struct k_work *work)
+{
+    struct coap_pending *pending =
+        CONTAINER_OF(work, struct coap_pending, timeout_work);
+    uint32_t expired = 0;
+
+    k_mutex_lock(&pending->lock, K_FOREVER);
+
+    int64_t now = k_uptime_get();
+
+    for (int i = 0; i < pending->size; i++) {
+        if (!(pending->active & BIT(i)) || pending->deadlines[i] > now) {
+            continue;
+        }
+
+        if (pending->retry == NULL ||
+            pending->retry(i, now, &pending->deadlines[i]) != 0) {
+            expired |= BIT(i);
+        }
+    }
+
+    pending->active &= ~expired;
+    pending->finished |= expired;
+    rearm_timer(pending);
+
+    k_mutex_unlock(&pending->lock);
+
+    for (int i = 0; i < pending->size; i++) {
+        if (expired & BIT(i)) {
+            pending->expire(i);
+        }
+    }
+
+    k_mutex_lock(&pending->lock, K_FOREVER);
+    pending->finished &= ~expired;
+    k_mutex_unlock(&pending->lock);
+}
+
+int coap_pending_claim(struct coap_pending *pending)
+{
+    uint32_t used = pending->active | pending->finished;
+
+    for (int i = 0; i < pending->size; i++) {
+        if (!(used & BIT(i))) {
+            return i;
+        }
+    }
+
+    return -ENOMEM;
+}
+
+void coap_pending_schedule(struct coap_pending *pending, int slot,
+                           int64_t deadline)
+{
+    pending->deadlines[slot] = deadline;
+    pending->active |= BIT(slot);
+    rearm_timer(pending);
+}
+
+void coap_pending_remove(struct coap_pending *pending, int slot)
+{
+    pending->active &= ~BIT(slot);
+    rearm_timer(pending);
+}
+
+void coap_pending_finish(struct coap_pending *pending, int slot)
+{
+    pending->active &= ~BIT(slot);
+    pending->finished |= BIT(slot);
+    rearm_timer(pending);
+}
+
+void coap_pending_release(struct coap_pending *pending, int slot)
+{
+    k_mutex_lock(&pending->lock, K_FOREVER);
+    pending->finished &= ~BIT(slot);
+    k_mutex_unlock(&pending->lock);
+}
+
+uint32_t coap_pending_count(struct coap_pending *pending)
+{
+    k_mutex_lock(&pending->lock, K_FOREVER);
+    uint32_t count = popcount(pending->active);
+    k_mutex_unlock(&pending->lock);
+
+    return count;
+}
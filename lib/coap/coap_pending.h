@@ -0,0 +1,117 @@
+#ifndef _LIB_COAP_PENDING_H_
+#define _LIB_COAP_PENDING_H_
+
+#include <zephyr/kernel.h>
+
+/*
+ * Pending table
+ *
+ * Shared bookkeeping for the fixed-size tables of confirmable messages,
+ * block-wise transfers and response matches. The table tracks which slots
+ * are in use and when each is due; the entries themselves live in an array
+ * owned by the user, indexed by slot.
+ *
+ * A single timer is armed for the earliest deadline. When it expires, the
+ * timeout work item runs on the system workqueue and calls retry for every
+ * overdue slot with the lock held. Slots for which retry fails, or every
+ * overdue slot if retry is NULL, are finished: expire is then called for
+ * each without the lock held.
+ *
+ * A finished slot is no longer active but cannot be claimed again until it
+ * is released, so its entry can be read without the lock while callbacks
+ * run.
+ */
+
+/* Resend the entry of an overdue slot and set its next deadline. Return 0
+ * to keep the slot, or a negative errno code to expire it. Called with the
+ * lock held. */
+typedef int (*coap_pending_retry_t)(int slot, int64_t now, int64_t *deadline);
+
+/* Report the expiry of a slot. Called without the lock held, before the slot
+ * is released. */
+typedef void (*coap_pending_expire_t)(int slot);
+
+struct coap_pending {
+    struct k_mutex lock;
+    struct k_timer timer;
+    struct k_work timeout_work;
+    int64_t *deadlines;
+    uint8_t size;
+    /* Slots in use, and slots finished but not yet released */
+    uint32_t active;
+    uint32_t finished;
+    coap_pending_retry_t retry;
+    coap_pending_expire_t expire;
+};
+
+void coap_pending_timer_expiry(struct k_timer *timer);
+void coap_pending_timeout_handler(struct k_work *work);
+
+/**
+ * @brief Statically define a pending table.
+ *
+ * @param _name    Name of the table.
+ * @param _size    Number of slots, at most 32.
+ * @param _retry   Retry function, or NULL to expire slots on their deadline.
+ * @param _expire  Expiry function.
+ */
+#define COAP_PENDING_DEFINE(_name, _size, _retry, _expire)                   \
+    BUILD_ASSERT((_size) <= 32, "A pending table holds at most 32 slots");   \
+    static int64_t _name##_deadlines[_size];                                 \
+    static struct coap_pending _name = {                                     \
+        .lock = Z_MUTEX_INITIALIZER(_name.lock),                             \
+        .timer = Z_TIMER_INITIALIZER(_name.timer,                            \
+                                     coap_pending_timer_expiry, NULL),       \
+        .timeout_work = Z_WORK_INITIALIZER(coap_pending_timeout_handler),    \
+        .deadlines = _name##_deadlines,                                      \
+        .size = (_size),                                                     \
+        .retry = (_retry),                                                   \
+        .expire = (_expire),                                                 \
+    }
+
+/**
+ * @brief Find a slot that is neither active nor finished.
+ *
+ * Must be called with the lock held.
+ *
+ * @return Slot index, or -ENOMEM if the table is full.
+ */
+int coap_pending_claim(struct coap_pending *pending);
+
+/**
+ * @brief Mark a slot active and set its deadline.
+ *
+ * Also moves the deadline of an already active slot. Must be called with the
+ * lock held.
+ */
+void coap_pending_schedule(struct coap_pending *pending, int slot,
+                           int64_t deadline);
+
+/**
+ * @brief Free an active slot without reporting it.
+ *
+ * Must be called with the lock held.
+ */
+void coap_pending_remove(struct coap_pending *pending, int slot);
+
+/**
+ * @brief Deactivate a slot whose completion is about to be reported.
+ *
+ * The slot stays reserved until coap_pending_release(). Must be called with
+ * the lock held.
+ */
+void coap_pending_finish(struct coap_pending *pending, int slot);
+
+/**
+ * @brief Free a finished slot.
+ *
+ * Must be called without the lock held.
+ */
+void coap_pending_release(struct coap_pending *pending, int slot);
+
+/**
+ * @brief Get the number of active slots.
+ */
+uint32_t coap_pending_count(struct coap_pending *pending);
+
+#endif /* _LIB_COAP_PENDING_H_ */
@@ -0,0 +1,327 @@
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include <lib/tsz.h>
+
+#define TSZ_HEADER_BITS 16
+
+/* No value window has been set yet */
+#define WINDOW_NONE UINT8_MAX
+
+struct dod_bucket {
+    uint8_t prefix;
+    uint8_t prefix_bits;
+    uint8_t value_bits;
+};
+
+/* Delta of delta buckets, tried in order */
+static const struct dod_bucket dod_buckets[] = {
+    {.prefix = 0x2, .prefix_bits = 2, .value_bits = 7},
+    {.prefix = 0x6, .prefix_bits = 3, .value_bits = 9},
+    {.prefix = 0xe, .prefix_bits = 4, .value_bits = 12},
+    {.prefix = 0xf, .prefix_bits = 4, .value_bits = 32},
+};
+
+static bool put_bits(struct tsz_encoder *enc, uint64_t value, uint8_t n)
+{
+    if (enc->bit_pos + n > enc->size * 8) {
+        return false;
+    }
+
+    while (n > 0) {
+        uint8_t *byte = &enc->buf[enc->bit_pos / 8];
+        uint8_t room = 8 - enc->bit_pos % 8;
+        uint8_t take = MIN(room, n);
+        uint8_t shift = room - take;
+        uint8_t mask = BIT_MASK(take) << shift;
+        uint8_t bits = (value >> (n - take)) & BIT_MASK(take);
+
+        /* Clear as well as set, a failed append may have left bits here */
+        *byte = (*byte & ~mask) | (bits << shift);
+        enc->bit_pos += take;
+        n -= take;
+    }
+
+    return true;
+}
+
+static bool get_bits(struct tsz_decoder *dec, uint8_t n, uint64_t *value)
+{
+    if (dec->bit_pos + n > dec->len * 8) {
+        return false;
+    }
+
+    *value = 0;
+
+    while (n > 0) {
+        uint8_t byte = dec->buf[dec->bit_pos / 8];
+        uint8_t room = 8 - dec->bit_pos % 8;
+        uint8_t take = MIN(room, n);
+        uint8_t shift = room - take;
+
+        *value = (*value << take) | ((byte >> shift) & BIT_MASK(take));
+        dec->bit_pos += take;
+        n -= take;
+    }
+
+    return true;
+}
+
+static int64_t sign_extend(uint64_t value, uint8_t bits)
+{
+    uint64_t sign = BIT64(bits - 1);
+
+    return (int64_t)((value ^ sign) - sign);
+}
+
+static bool put_dod(struct tsz_encoder *enc, int64_t dod)
+{
+    if (dod == 0) {
+        return put_bits(enc, 0, 1);
+    }
+
+    for (size_t i = 0; i < ARRAY_SIZE(dod_buckets); i++) {
+        const struct dod_bucket *bucket = &dod_buckets[i];
+        int64_t limit = BIT64(bucket->value_bits - 1);
+
+        if (dod >= -limit && dod < limit) {
+            return put_bits(enc, bucket->prefix, bucket->prefix_bits) &&
+                   put_bits(enc, (uint64_t)dod & BIT64_MASK(bucket->value_bits),
+                            bucket->value_bits);
+        }
+    }
+
+    return false;
+}
+
+static bool put_value(struct tsz_encoder *enc, uint32_t value)
+{
+    uint32_t xor = value ^ enc->v_prev;
+
+    if (xor == 0) {
+        return put_bits(enc, 0, 1);
+    }
+
+    uint8_t leading = __builtin_clz(xor);
+    uint8_t trailing = __builtin_ctz(xor);
+
+    if (enc->leading != WINDOW_NONE && leading >= enc->leading &&
+        trailing >= enc->trailing) {
+        uint8_t len = 32 - enc->leading - enc->trailing;
+
+        return put_bits(enc, 0x2, 2) &&
+               put_bits(enc, xor >> enc->trailing, len);
+    }
+
+    uint8_t len = 32 - leading - trailing;
+
+    enc->leading = leading;
+    enc->trailing = trailing;
+
+    return put_bits(enc, 0x3, 2) &&
+           put_bits(enc, leading, 5) &&
+           put_bits(enc, len - 1, 5) &&
+           put_bits(enc, xor >> trailing, len);
+}
+
+int tsz_encoder_init(struct tsz_encoder *enc, uint8_t *buf, size_t size)
+{
+    if (enc == NULL || buf == NULL || size < TSZ_HEADER_BITS / 8) {
+        return -EINVAL;
+    }
+
+    *enc = (struct tsz_encoder) {
+        .buf = buf,
+        .size = size,
+        .bit_pos = TSZ_HEADER_BITS,
+        .leading = WINDOW_NONE,
+    };
+
+    return 0;
+}
+
+int tsz_encoder_append(struct tsz_encoder *enc, int64_t t, uint32_t value)
+{
+    if (enc->count == UINT16_MAX) {
+        return -ENOSPC;
+    }
+
+    /* Restored if the sample does not fit */
+    struct tsz_encoder saved = *enc;
+    bool ok;
+
+    if (enc->count == 0) {
+        ok = put_bits(enc, (uint64_t)t, 64) && put_bits(enc, value, 32);
+        enc->delta_prev = 0;
+    } else {
+        int64_t delta = t - enc->t_prev;
+        int64_t dod = delta - enc->delta_prev;
+
+        if (dod < INT32_MIN || dod > INT32_MAX) {
+            return -ERANGE;
+        }
+
+        ok = put_dod(enc, dod) && put_value(enc, value);
+        enc->delta_prev = delta;
+    }
+
+    if (!ok) {
+        *enc = saved;
+        return -ENOSPC;
+    }
+
+    enc->t_prev = t;
+    enc->v_prev = value;
+    enc->count++;
+
+    return 0;
+}
+
+size_t tsz_encoder_finish(struct tsz_encoder *enc)
+{
+    sys_put_be16(enc->count, enc->buf);
+
+    /* Clear the unused bits of the last byte */
+    if (enc->bit_pos % 8 != 0) {
+        enc->buf[enc->bit_pos / 8] &= ~BIT_MASK(8 - enc->bit_pos % 8);
+    }
+
+    return DIV_ROUND_UP(enc->bit_pos, 8);
+}
+
+int tsz_decoder_init(struct tsz_decoder *dec, const uint8_t *buf, size_t len)
+{
+    if (dec == NULL || buf == NULL || len < TSZ_HEADER_BITS / 8) {
+        return -EBADMSG;
+    }
+
+    *dec = (struct tsz_decoder) {
+        .buf = buf,
+        .len = len,
+        .bit_pos = TSZ_HEADER_BITS,
+        .count = sys_get_be16(buf),
+        .leading = WINDOW_NONE,
+    };
+
+    return 0;
+}
+
+static bool get_dod(struct tsz_decoder *dec, int64_t *dod)
+{
+    uint64_t bit;
+
+    if (!get_bits(dec, 1, &bit)) {
+        return false;
+    }
+
+    if (bit == 0) {
+        *dod = 0;
+        return true;
+    }
+
+    /* Count further set prefix bits to find the bucket */
+    size_t i = 0;
+
+    while (i < ARRAY_SIZE(dod_buckets) - 1) {
+        if (!get_bits(dec, 1, &bit)) {
+            return false;
+        }
+        if (bit == 0) {
+            break;
+        }
+        i++;
+    }
+
+    uint64_t raw;
+    uint8_t bits = dod_buckets[i].value_bits;
+
+    if (!get_bits(dec, bits, &raw)) {
+        return false;
+    }
+
+    *dod = sign_extend(raw, bits);
+    return true;
+}
+
+static bool get_value(struct tsz_decoder *dec, uint32_t *value)
+{
+    uint64_t bits;
+
+    if (!get_bits(dec, 1, &bits)) {
+        return false;
+    }
+
+    if (bits == 0) {
+        *value = dec->v_prev;
+        return true;
+    }
+
+    if (!get_bits(dec, 1, &bits)) {
+        return false;
+    }
+
+    if (bits == 1) {
+        uint64_t leading;
+        uint64_t len;
+
+        if (!get_bits(dec, 5, &leading) || !get_bits(dec, 5, &len)) {
+            return false;
+        }
+
+        len++;
+        if (leading + len > 32) {
+            return false;
+        }
+
+        dec->leading = leading;
+        dec->trailing = 32 - leading - len;
+    } else if (dec->leading == WINDOW_NONE) {
+        return false;
+    }
+
+    uint64_t xor;
+
+    if (!get_bits(dec, 32 - dec->leading - dec->trailing, &xor)) {
+        return false;
+    }
+
+    *value = dec->v_prev ^ ((uint32_t)xor << dec->trailing);
+    return true;
+}
+
+int tsz_decoder_next(struct tsz_decoder *dec, int64_t *t, uint32_t *value)
+{
+    if (dec->index == dec->count) {
+        return -ENODATA;
+    }
+
+    if (dec->index == 0) {
+        uint64_t t0;
+        uint64_t v0;
+
+        if (!get_bits(dec, 64, &t0) || !get_bits(dec, 32, &v0)) {
+            return -EBADMSG;
+        }
+
+        dec->t_prev = (int64_t)t0;
+        dec->v_prev = v0;
+    } else {
+        int64_t dod;
+        uint32_t v;
+
+        if (!get_dod(dec, &dod) || !get_value(dec, &v)) {
+            return -EBADMSG;
+        }
+
+        dec->delta_prev += dod;
+        dec->t_prev += dec->delta_prev;
+        dec->v_prev = v;
+    }
+
+    dec->index++;
+    *t = dec->t_prev;
+    *value = dec->v_prev;
+
+    return 0;
+}
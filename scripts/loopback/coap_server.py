@@ -0,0 +1,615 @@
+"""
+Scripted stand-in for the SENSE remote CoAP server.
+
+The server listens on a local UDP port and implements just enough of the
+remote server behaviour to exercise the firmware end to end on native_sim
+with the loopback cellular backend (CONFIG_CELLULAR_BACKEND_LOOPBACK):
+
+  * POST .../data      accepts CBOR datapoints, SenML-CBOR packs of
+                       datapoints or compressed series blocks, and records
+                       throughput.
+  * POST .../sensors   accepts pages of the sensor dictionary, used to name
+                       datapoints that only carry a sensor ID.
+  * GET .../commands   returns the next scripted command, or
+                       CMD_NONE_AVAILABLE when none is pending.
+  * DELETE .../commands acknowledges (removes) the pending command and
+                       records the command round-trip latency.
+  * GET .../commands with Observe: 0 registers for notifications (RFC 7641).
+                       Observers are pushed each command as it becomes
+                       available.
+
+Commands are scripted with a JSON file containing a list of entries:
+
+    [
+        {"at": 5.0, "command": {"ty": 1, "ta": 3, "i": 1000}},
+        {"at": 9.0, "command": {"ty": 2, "ta": 0, "b": true}},
+        {"at": 12.0, "command": {"ty": 3, "ta": 3, "i": 60}},
+        {"at": 15.0, "command": {"ty": 4, "ta": 9, "i": 600, "f": 0.1}}
+    ]
+
+where "at" is the number of seconds after server start at which the command
+becomes available. Command fields are encoded in the order given, which must
+be that of the command schema, and "f" and "p" must be written as floats.
+
+Short path aliases (CONFIG_DATAPOINT_PATH_ALIAS and
+CONFIG_REMOTE_COMMANDS_PATH_ALIAS) are mapped to their resources with
+--alias, e.g. --alias d=data --alias c=commands.
+
+Example:
+
+    python scripts/loopback/coap_server.py --port 5683 \\
+        --script scripts/loopback/commands.example.json
+"""
+
+import argparse
+import json
+import socket
+import struct
+import sys
+import time
+
+COAP_VERSION = 1
+
+COAP_TYPE_CON = 0
+COAP_TYPE_NON_CON = 1
+COAP_TYPE_ACK = 2
+COAP_TYPE_RESET = 3
+
+COAP_METHOD_GET = 0x01
+COAP_METHOD_POST = 0x02
+COAP_METHOD_PUT = 0x03
+COAP_METHOD_DELETE = 0x04
+
+COAP_RESPONSE_CREATED = 0x41
+COAP_RESPONSE_DELETED = 0x42
+COAP_RESPONSE_CHANGED = 0x44
+COAP_RESPONSE_CONTENT = 0x45
+COAP_RESPONSE_NOT_FOUND = 0x84
+COAP_RESPONSE_METHOD_NOT_ALLOWED = 0x85
+
+# SenML CBOR labels (RFC 8428)
+SENML_BN = -2
+SENML_N = 0
+
+COAP_OPTION_OBSERVE = 6
+COAP_OPTION_URI_PATH = 11
+COAP_OPTION_MAX_AGE = 14
+
+# Notifications are only sent when a command becomes available, so each one
+# stays fresh for the firmware's default observe lifetime
+OBSERVE_MAX_AGE = 900
+
+CMD_NONE_AVAILABLE = 0
+
+
+# ==== Minimal CBOR ==========================================================
+
+def _cbor_head(major, value):
+    if value < 24:
+        return bytes([(major << 5) | value])
+    if value < 0x100:
+        return bytes([(major << 5) | 24, value])
+    if value < 0x10000:
+        return bytes([(major << 5) | 25]) + struct.pack(">H", value)
+    if value < 0x100000000:
+        return bytes([(major << 5) | 26]) + struct.pack(">I", value)
+    return bytes([(major << 5) | 27]) + struct.pack(">Q", value)
+
+
+def cbor_encode(obj):
+    """Encode the small subset of CBOR used by the command schema."""
+    if obj is True:
+        return b"\xf5"
+    if obj is False:
+        return b"\xf4"
+    if obj is None:
+        return b"\xf6"
+    if isinstance(obj, int):
+        if obj >= 0:
+            return _cbor_head(0, obj)
+        return _cbor_head(1, -1 - obj)
+    if isinstance(obj, float):
+        return b"\xfb" + struct.pack(">d", obj)
+    if isinstance(obj, bytes):
+        return _cbor_head(2, len(obj)) + obj
+    if isinstance(obj, str):
+        raw = obj.encode("utf-8")
+        return _cbor_head(3, len(raw)) + raw
+    if isinstance(obj, (list, tuple)):
+        return _cbor_head(4, len(obj)) + b"".join(cbor_encode(o) for o in obj)
+    if isinstance(obj, dict):
+        out = _cbor_head(5, len(obj))
+        for key, value in obj.items():
+            out += cbor_encode(key) + cbor_encode(value)
+        return out
+    raise TypeError(f"Unsupported CBOR type: {type(obj)}")
+
+
+def _half_to_float(h):
+    sign = -1.0 if h & 0x8000 else 1.0
+    exp = (h >> 10) & 0x1F
+    frac = h & 0x3FF
+    if exp == 0:
+        return sign * frac * 2.0 ** -24
+    if exp == 31:
+        return sign * float("inf") if frac == 0 else float("nan")
+    return sign * (1 + frac / 1024.0) * 2.0 ** (exp - 15)
+
+
+CBOR_BREAK = 0xFF
+
+
+def _cbor_decode_indefinite(data, offset, major):
+    """Decode the items of an indefinite-length array or map."""
+    items = [] if major == 4 else {}
+    while data[offset] != CBOR_BREAK:
+        if major == 4:
+            item, offset = cbor_decode(data, offset)
+            items.append(item)
+        else:
+            key, offset = cbor_decode(data, offset)
+            items[key], offset = cbor_decode(data, offset)
+    return items, offset + 1
+
+
+def cbor_decode(data, offset=0):
+    """Decode one CBOR item. Returns (item, next_offset)."""
+    initial = data[offset]
+    major = initial >> 5
+    info = initial & 0x1F
+    offset += 1
+
+    if major == 7:
+        if info == 20:
+            return False, offset
+        if info == 21:
+            return True, offset
+        if info in (22, 23):
+            return None, offset
+        if info == 25:
+            (h,) = struct.unpack_from(">H", data, offset)
+            return _half_to_float(h), offset + 2
+        if info == 26:
+            return struct.unpack_from(">f", data, offset)[0], offset + 4
+        if info == 27:
+            return struct.unpack_from(">d", data, offset)[0], offset + 8
+        raise ValueError(f"Unsupported simple value: {info}")
+
+    if info < 24:
+        value = info
+    elif info == 24:
+        value = data[offset]
+        offset += 1
+    elif info == 25:
+        (value,) = struct.unpack_from(">H", data, offset)
+        offset += 2
+    elif info == 26:
+        (value,) = struct.unpack_from(">I", data, offset)
+        offset += 4
+    elif info == 27:
+        (value,) = struct.unpack_from(">Q", data, offset)
+        offset += 8
+    elif info == 31 and major in (4, 5):
+        return _cbor_decode_indefinite(data, offset, major)
+    else:
+        raise ValueError("Indefinite strings are not supported")
+
+    if major == 0:
+        return value, offset
+    if major == 1:
+        return -1 - value, offset
+    if major == 2:
+        return bytes(data[offset:offset + value]), offset + value
+    if major == 3:
+        return data[offset:offset + value].decode("utf-8"), offset + value
+    if major == 4:
+        items = []
+        for _ in range(value):
+            item, offset = cbor_decode(data, offset)
+            items.append(item)
+        return items, offset
+    if major == 5:
+        items = {}
+        for _ in range(value):
+            key, offset = cbor_decode(data, offset)
+            items[key], offset = cbor_decode(data, offset)
+        return items, offset
+    if major == 6:
+        return cbor_decode(data, offset)
+    raise ValueError(f"Unsupported major type: {major}")
+
+
+# ==== Minimal CoAP ==========================================================
+
+class CoapMessage:
+    def __init__(self, mtype, code, mid, token, options, payload):
+        self.mtype = mtype
+        self.code = code
+        self.mid = mid
+        self.token = token
+        self.options = options
+        self.payload = payload
+
+    def option(self, number):
+        for (num, value) in self.options:
+            if num == number:
+                return value
+        return None
+
+    @property
+    def uri_path(self):
+        return [v.decode("utf-8", "replace")
+                for (num, v) in self.options if num == COAP_OPTION_URI_PATH]
+
+
+def _read_ext(value, data, i):
+    if value == 13:
+        return data[i] + 13, i + 1
+    if value == 14:
+        return struct.unpack_from(">H", data, i)[0] + 269, i + 2
+    if value == 15:
+        raise ValueError("Reserved option nibble")
+    return value, i
+
+
+def coap_parse(data):
+    if len(data) < 4:
+        raise ValueError("Datagram too short")
+
+    version = data[0] >> 6
+    if version != COAP_VERSION:
+        raise ValueError(f"Unsupported CoAP version: {version}")
+
+    mtype = (data[0] >> 4) & 0x03
+    tkl = data[0] & 0x0F
+    code = data[1]
+    (mid,) = struct.unpack_from(">H", data, 2)
+    token = bytes(data[4:4 + tkl])
+
+    i = 4 + tkl
+    number = 0
+    options = []
+    payload = b""
+    while i < len(data):
+        if data[i] == 0xFF:
+            payload = bytes(data[i + 1:])
+            break
+        delta = data[i] >> 4
+        length = data[i] & 0x0F
+        i += 1
+        delta, i = _read_ext(delta, data, i)
+        length, i = _read_ext(length, data, i)
+        number += delta
+        options.append((number, bytes(data[i:i + length])))
+        i += length
+
+    return CoapMessage(mtype, code, mid, token, options, payload)
+
+
+def _option_nibble(value):
+    if value < 13:
+        return value, b""
+    if value < 269:
+        return 13, bytes([value - 13])
+    return 14, struct.pack(">H", value - 269)
+
+
+def coap_encode_options(options):
+    out = b""
+    number = 0
+    for (num, value) in sorted(options):
+        delta, delta_ext = _option_nibble(num - number)
+        length, length_ext = _option_nibble(len(value))
+        out += bytes([(delta << 4) | length]) + delta_ext + length_ext + value
+        number = num
+    return out
+
+
+def coap_uint(value):
+    """Minimal big-endian encoding of a uint option value."""
+    return value.to_bytes((value.bit_length() + 7) // 8, "big")
+
+
+def coap_encode(mtype, code, mid, token, options=(), payload=b""):
+    out = bytes([(COAP_VERSION << 6) | (mtype << 4) | len(token), code]) \
+        + struct.pack(">H", mid) + token + coap_encode_options(options)
+    if payload:
+        out += b"\xff" + payload
+    return out
+
+
+def coap_response(request, code, payload=b"", options=()):
+    mtype = COAP_TYPE_ACK if request.mtype == COAP_TYPE_CON \
+        else COAP_TYPE_NON_CON
+    mid = request.mid if mtype == COAP_TYPE_ACK \
+        else (request.mid + 0x8000) & 0xFFFF
+
+    return coap_encode(mtype, code, mid, request.token, options, payload)
+
+
+# ==== Server ================================================================
+
+class Stats:
+    def __init__(self):
+        self.start = time.monotonic()
+        self.datagrams = 0
+        self.bytes = 0
+        self.datapoints = 0
+        self.decode_errors = 0
+        self.per_sensor = {}
+        self.command_polls = 0
+        self.notifications = 0
+        self.command_latency = []
+        self.window_start = self.start
+        self.window_datapoints = 0
+
+    def report(self, final=False):
+        now = time.monotonic()
+        elapsed = max(now - self.start, 1e-9)
+        window = max(now - self.window_start, 1e-9)
+
+        print("---- {} ({:.1f} s) ----".format(
+            "final" if final else "stats", elapsed))
+        print(f"  datagrams: {self.datagrams} ({self.bytes} B, "
+              f"{self.bytes / elapsed:.1f} B/s)")
+        print(f"  datapoints: {self.datapoints} "
+              f"(avg {self.datapoints / elapsed:.2f}/s, "
+              f"window {self.window_datapoints / window:.2f}/s)")
+        if self.decode_errors:
+            print(f"  decode errors: {self.decode_errors}")
+        print(f"  command polls: {self.command_polls}, "
+              f"notifications: {self.notifications}")
+        if self.command_latency:
+            lat = self.command_latency
+            print(f"  command latency: n={len(lat)} "
+                  f"min={min(lat) * 1000:.1f} ms "
+                  f"avg={sum(lat) / len(lat) * 1000:.1f} ms "
+                  f"max={max(lat) * 1000:.1f} ms")
+        if final:
+            for name, count in sorted(self.per_sensor.items()):
+                print(f"    {name}: {count}")
+        sys.stdout.flush()
+
+        self.window_start = now
+        self.window_datapoints = 0
+
+
+class ScriptedServer:
+    def __init__(self, sock, script, stats, verbose, aliases=None):
+        self.sock = sock
+        self.aliases = aliases or {}
+        self.pending = sorted(script, key=lambda e: e["at"])
+        self.active = None
+        self.observers = {}
+        self.observe_seq = 0
+        self.next_mid = 0x4000
+        self.stats = stats
+        self.verbose = verbose
+        self.sensors = {}
+
+    def _sensor_name(self, sensor_id):
+        return self.sensors.get(sensor_id, (str(sensor_id),))[0]
+
+    def handle_sensors(self, msg):
+        try:
+            page, _ = cbor_decode(msg.payload)
+            first = page["o"]
+            for offset, entry in enumerate(page["s"]):
+                self.sensors[first + offset] = tuple(entry)
+        except (ValueError, IndexError, KeyError, TypeError,
+                UnicodeDecodeError):
+            self.stats.decode_errors += 1
+            return COAP_RESPONSE_CHANGED, b""
+
+        if self.verbose:
+            print(f"sensor dictionary {page['h']:08x}: "
+                  f"{len(self.sensors)} sensors")
+
+        return COAP_RESPONSE_CHANGED, b""
+
+    def _promote(self):
+        """Make the next scripted command active once its time has come."""
+        if self.active is not None or not self.pending:
+            return
+        now = time.monotonic() - self.stats.start
+        if self.pending[0]["at"] <= now:
+            self.active = self.pending.pop(0)
+            self.active["available_at"] = time.monotonic()
+
+    def handle_data(self, msg):
+        try:
+            dp, _ = cbor_decode(msg.payload)
+        except (ValueError, IndexError, UnicodeDecodeError):
+            self.stats.decode_errors += 1
+            return COAP_RESPONSE_CHANGED, b""
+
+        records = dp if isinstance(dp, list) else [dp]
+        base_name = ""
+        for record in records:
+            count = 1
+            if not isinstance(record, dict):
+                name = "?"
+            elif "b" in record:
+                # Compressed series blocks start with their sample count
+                name = self._sensor_name(record.get("d"))
+                count = int.from_bytes(record["b"][:2], "big")
+            elif SENML_BN in record or SENML_N in record:
+                # SenML names are the base name followed by the record name
+                base_name = record.get(SENML_BN, base_name)
+                name = base_name + record.get(SENML_N, "")
+                # Names after the IMEI tail may be sensor IDs, followed by
+                # the statistic of a window summary
+                prefix, _, suffix = name.rpartition(":")
+                sensor, slash, stat = suffix.partition("/")
+                if sensor.isdigit():
+                    name = (prefix + ":" + self._sensor_name(int(sensor)) +
+                            slash + stat)
+            elif "c" in record:
+                # Window summaries stand for the samples they aggregate
+                name = record.get("s") or self._sensor_name(record.get("d"))
+                count = record["c"]
+            elif "s" in record:
+                name = record["s"]
+            elif "d" in record:
+                name = self._sensor_name(record["d"])
+            else:
+                name = "?"
+            self.stats.per_sensor[name] = \
+                self.stats.per_sensor.get(name, 0) + count
+            self.stats.datapoints += count
+            self.stats.window_datapoints += count
+
+        if self.verbose:
+            print(f"data: {dp}")
+
+        return COAP_RESPONSE_CHANGED, b""
+
+    def _current_command(self):
+        if self.active is None:
+            return {"ty": CMD_NONE_AVAILABLE, "ta": 0}
+        return self.active["command"]
+
+    def _observe_options(self):
+        return [(COAP_OPTION_OBSERVE, coap_uint(self.observe_seq)),
+                (COAP_OPTION_MAX_AGE, coap_uint(OBSERVE_MAX_AGE))]
+
+    def tick(self):
+        """Notify observers when a scripted command becomes available."""
+        was_active = self.active
+        self._promote()
+        if self.active is None or self.active is was_active:
+            return
+
+        self.observe_seq += 1
+        payload = cbor_encode(self.active["command"])
+        for addr, token in self.observers.items():
+            self.next_mid = (self.next_mid + 1) & 0xFFFF
+            self.sock.sendto(coap_encode(
+                COAP_TYPE_NON_CON, COAP_RESPONSE_CONTENT, self.next_mid,
+                token, self._observe_options(), payload), addr)
+            self.stats.notifications += 1
+            if self.verbose:
+                print(f"notified {addr}: {self.active['command']}")
+
+    def handle_commands(self, msg, addr):
+        self._promote()
+
+        if msg.code == COAP_METHOD_GET:
+            self.stats.command_polls += 1
+            options = []
+            observe = msg.option(COAP_OPTION_OBSERVE)
+            if observe is not None:
+                if int.from_bytes(observe, "big") == 0:
+                    self.observers[addr] = msg.token
+                    options = self._observe_options()
+                else:
+                    self.observers.pop(addr, None)
+            return COAP_RESPONSE_CONTENT, \
+                cbor_encode(self._current_command()), options
+
+        if msg.code == COAP_METHOD_DELETE:
+            if self.active is not None:
+                latency = time.monotonic() - self.active["available_at"]
+                self.stats.command_latency.append(latency)
+                if self.verbose:
+                    print(f"command acked after {latency * 1000:.1f} ms: "
+                          f"{self.active['command']}")
+                self.active = None
+            return COAP_RESPONSE_DELETED, b"", []
+
+        return COAP_RESPONSE_METHOD_NOT_ALLOWED, b"", []
+
+    def handle(self, data, addr):
+        self.stats.datagrams += 1
+        self.stats.bytes += len(data)
+
+        try:
+            msg = coap_parse(data)
+        except (ValueError, IndexError, struct.error) as err:
+            self.stats.decode_errors += 1
+            if self.verbose:
+                print(f"bad datagram from {addr}: {err}")
+            return
+
+        # Empty ACK/RST messages carry no request.
+        if msg.code == 0:
+            return
+
+        path = msg.uri_path
+        resource = path[-1] if path else ""
+        if len(path) == 1:
+            resource = self.aliases.get(resource, resource)
+        if resource == "data" and msg.code in (COAP_METHOD_POST,
+                                               COAP_METHOD_PUT):
+            code, payload = self.handle_data(msg)
+            options = []
+        elif resource == "sensors" and msg.code == COAP_METHOD_POST:
+            code, payload = self.handle_sensors(msg)
+            options = []
+        elif resource == "commands":
+            code, payload, options = self.handle_commands(msg, addr)
+        else:
+            code, payload, options = COAP_RESPONSE_NOT_FOUND, b"", []
+
+        self.sock.sendto(coap_response(msg, code, payload, options), addr)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("--host", default="127.0.0.1",
+                        help="Address to bind to (default: 127.0.0.1)")
+    parser.add_argument("--port", type=int, default=5683,
+                        help="UDP port to bind to (default: 5683)")
+    parser.add_argument("--script", default=None,
+                        help="JSON command script")
+    parser.add_argument("--report-interval", type=float, default=5.0,
+                        help="Seconds between statistics reports")
+    parser.add_argument("--duration", type=float, default=0,
+                        help="Stop after this many seconds (0 = run forever)")
+    parser.add_argument("--alias", action="append", default=[],
+                        metavar="ALIAS=RESOURCE",
+                        help="Map a single-segment path alias to a resource")
+    parser.add_argument("-v", "--verbose", action="store_true")
+    args = parser.parse_args()
+
+    script = []
+    if args.script:
+        with open(args.script, "r") as f:
+            script = json.load(f)
+
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind((args.host, args.port))
+    sock.settimeout(0.1)
+
+    stats = Stats()
+    aliases = dict(a.split("=", 1) for a in args.alias)
+    server = ScriptedServer(sock, script, stats, args.verbose, aliases)
+    print(f"Listening on {args.host}:{args.port} "
+          f"({len(script)} scripted commands)")
+
+    next_report = time.monotonic() + args.report_interval
+    try:
+        while True:
+            try:
+                data, addr = sock.recvfrom(2048)
+                server.handle(data, addr)
+            except socket.timeout:
+                pass
+
+            server.tick()
+
+            now = time.monotonic()
+            if now >= next_report:
+                stats.report()
+                next_report = now + args.report_interval
+
+            if args.duration and now - stats.start >= args.duration:
+                break
+    except KeyboardInterrupt:
+        pass
+
+    stats.report(final=True)
+
+
+if __name__ == "__main__":
+    main()
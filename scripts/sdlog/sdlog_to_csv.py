@@ -0,0 +1,278 @@
+"""
+Convert a binary SD card datapoint log to CSV.
+
+With CONFIG_DATAPOINT_SD_CBOR, the control core logs each datapoint to the
+SD card as a CZD datapoint map (lib/czd/schemas/datapoint.cddl), framed as
+
+    0xdb marker | payload length (uint16, little endian) | CBOR map
+
+in the log file (log.cbr by default). Every CONFIG_SD_CARD_WRITER_INDEX_INTERVAL
+records, a 24 byte little-endian entry is appended to the index file
+(log.idx by default):
+
+    offset (uint32) | length (uint32) | earliest ms (int64) | latest ms (int64)
+
+giving the span of a block of records in the log and the range of their
+times. With --start and --end, only the blocks whose times overlap the range
+and the records the index does not cover are read, as on the device.
+
+The output has the columns of the CSV log, timestamp,name,int,float,string,
+unit, with timestamps in UTC seconds unless --ms is given. Sensor names and
+units are looked up by sensor ID in the firmware's sensor registry,
+cores/control/src/datapoint/datapoint_sensors.h. Window summaries are
+written as one line per statistic, as the CSV log does.
+
+Example:
+
+    python scripts/sdlog/sdlog_to_csv.py /media/sd/LOG.CBR \\
+        --start 1700000000 --end 1700003600 -o hour.csv
+"""
+
+import argparse
+import math
+import os
+import re
+import struct
+import sys
+
+RECORD_MAGIC = 0xDB
+RECORD_HEADER = struct.Struct("<BH")
+INDEX_ENTRY = struct.Struct("<IIqq")
+
+DEFAULT_SENSORS = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                               "..", "..", "cores", "control", "src",
+                               "datapoint", "datapoint_sensors.h")
+
+
+# ==== Minimal CBOR ==========================================================
+
+def _half_to_float(h):
+    sign = -1.0 if h & 0x8000 else 1.0
+    exp = (h >> 10) & 0x1F
+    frac = h & 0x3FF
+    if exp == 0:
+        return sign * frac * 2.0 ** -24
+    if exp == 31:
+        return sign * float("inf") if frac == 0 else float("nan")
+    return sign * (1 + frac / 1024.0) * 2.0 ** (exp - 15)
+
+
+def cbor_decode(data, offset=0):
+    """Decode one definite-length CBOR item. Returns (item, next_offset)."""
+    initial = data[offset]
+    major = initial >> 5
+    info = initial & 0x1F
+    offset += 1
+
+    if major == 7:
+        if info == 25:
+            (h,) = struct.unpack_from(">H", data, offset)
+            return _half_to_float(h), offset + 2
+        if info == 26:
+            return struct.unpack_from(">f", data, offset)[0], offset + 4
+        if info == 27:
+            return struct.unpack_from(">d", data, offset)[0], offset + 8
+        if info in (20, 21):
+            return info == 21, offset
+        raise ValueError(f"Unsupported simple value: {info}")
+
+    if info < 24:
+        value = info
+    elif info in (24, 25, 26, 27):
+        size = 1 << (info - 24)
+        value = int.from_bytes(data[offset:offset + size], "big")
+        offset += size
+    else:
+        raise ValueError("Indefinite lengths are not supported")
+
+    if major == 0:
+        return value, offset
+    if major == 1:
+        return -1 - value, offset
+    if major == 2:
+        return bytes(data[offset:offset + value]), offset + value
+    if major == 3:
+        return data[offset:offset + value].decode("utf-8"), offset + value
+    if major == 4:
+        items = []
+        for _ in range(value):
+            item, offset = cbor_decode(data, offset)
+            items.append(item)
+        return items, offset
+    if major == 5:
+        items = {}
+        for _ in range(value):
+            key, offset = cbor_decode(data, offset)
+            items[key], offset = cbor_decode(data, offset)
+        return items, offset
+    raise ValueError(f"Unsupported major type: {major}")
+
+
+# ==== Log ===================================================================
+
+def load_sensors(path):
+    """Map sensor IDs to (name, unit) from the sensor registry header."""
+    with open(path, "r") as f:
+        text = f.read()
+    entries = re.findall(r'X\(\s*\w+\s*,\s*"([^"]*)"\s*,\s*"([^"]*)"\s*\)',
+                         text)
+    return dict(enumerate(entries))
+
+
+def read_index(path):
+    """Return the index entries as (offset, length, min_ms, max_ms)."""
+    if not os.path.exists(path):
+        return []
+    with open(path, "rb") as f:
+        data = f.read()
+    usable = len(data) - len(data) % INDEX_ENTRY.size
+    return [INDEX_ENTRY.unpack_from(data, i)
+            for i in range(0, usable, INDEX_ENTRY.size)]
+
+
+def decode_record(payload):
+    """Decode a record payload, or return None if it is not a datapoint."""
+    try:
+        dp, length = cbor_decode(payload)
+    except (ValueError, IndexError, struct.error, UnicodeDecodeError):
+        return None
+    if length != len(payload) or not isinstance(dp, dict) or "t" not in dp:
+        return None
+    return dp
+
+
+def scan_records(log, start, end, skipped):
+    """Yield the datapoints found between two offsets of the log.
+
+    Bytes that do not start a whole, decodable record, such as those of a
+    record cut short by a reset, are skipped until the next record marker.
+    """
+    pos = start
+    while pos + RECORD_HEADER.size <= end:
+        magic, length = RECORD_HEADER.unpack_from(log, pos)
+        payload_end = pos + RECORD_HEADER.size + length
+        dp = None
+        if magic == RECORD_MAGIC and payload_end <= end:
+            dp = decode_record(log[pos + RECORD_HEADER.size:payload_end])
+        if dp is None:
+            skipped[0] += magic == RECORD_MAGIC
+            pos += 1
+            continue
+        yield dp
+        pos = payload_end
+
+
+def select_records(log, index, start_ms, end_ms, skipped):
+    """Yield the datapoints that may fall within a range, reading only the
+    indexed blocks that overlap it."""
+    pos = 0
+    for offset, length, min_ms, max_ms in index:
+        # Entries that overlap ones before them or run past the end of the
+        # log do not describe it
+        if offset < pos or offset + length > len(log):
+            continue
+        # Records between blocks are not indexed
+        yield from scan_records(log, pos, offset, skipped)
+        if min_ms <= end_ms and max_ms >= start_ms:
+            yield from scan_records(log, offset, offset + length, skipped)
+        pos = offset + length
+    yield from scan_records(log, pos, len(log), skipped)
+
+
+# ==== CSV ===================================================================
+
+def format_float(value):
+    """Format a float as the device's "%.6f" does."""
+    if math.isnan(value):
+        return "-nan" if math.copysign(1.0, value) < 0 else "nan"
+    if math.isinf(value):
+        return "-inf" if value < 0 else "inf"
+    return "%.6f" % value
+
+
+def csv_line(t, name, n=None, f=None, r=None, unit=None):
+    return ",".join((
+        str(t),
+        name,
+        "" if n is None else str(n),
+        "" if f is None else format_float(f),
+        "" if r is None else r,
+        "" if unit is None else unit,
+    )) + "\n"
+
+
+def datapoint_lines(dp, sensors, in_ms):
+    """Return the CSV lines of a decoded datapoint."""
+    t = dp["t"]
+    if not in_ms:
+        # Truncated towards zero, as on the device
+        t = abs(t) // 1000 * (1 if t >= 0 else -1)
+    name, unit = dp.get("s"), dp.get("u")
+    if "d" in dp and dp["d"] in sensors:
+        known_name, known_unit = sensors[dp["d"]]
+        name = known_name if name is None else name
+        unit = known_unit if unit is None else unit
+    if name is None:
+        name = str(dp.get("d", ""))
+
+    if "c" not in dp:
+        return [csv_line(t, name, dp.get("n"), dp.get("f"), dp.get("r"),
+                         unit)]
+
+    # Window summaries are one line per statistic
+    return [
+        csv_line(t, name, None, dp.get("f"), dp.get("r"), unit),
+        csv_line(t, f"{name}/min", None, dp.get("lo"), dp.get("r"), unit),
+        csv_line(t, f"{name}/max", None, dp.get("hi"), dp.get("r"), unit),
+        csv_line(t, f"{name}/sd", None, dp.get("sd"), dp.get("r"), unit),
+        csv_line(t, f"{name}/count", dp["c"], None, dp.get("r"), None),
+    ]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[1])
+    parser.add_argument("log", help="Binary log file, e.g. LOG.CBR")
+    parser.add_argument("--index", default=None,
+                        help="Index file (default: the log name with .idx)")
+    parser.add_argument("--start", type=int, default=None,
+                        help="Start of the range in UTC seconds")
+    parser.add_argument("--end", type=int, default=None,
+                        help="End of the range in UTC seconds, inclusive")
+    parser.add_argument("--sensors", default=DEFAULT_SENSORS,
+                        help="Sensor registry header (default: the one in "
+                             "this repository)")
+    parser.add_argument("--ms", action="store_true",
+                        help="Write timestamps in UTC milliseconds")
+    parser.add_argument("-o", "--output", default=None,
+                        help="Output CSV file (default: stdout)")
+    args = parser.parse_args()
+
+    index_path = args.index
+    if index_path is None:
+        base, ext = os.path.splitext(args.log)
+        index_path = base + (".IDX" if ext.isupper() else ".idx")
+
+    start_ms = -2 ** 63 if args.start is None else args.start * 1000
+    end_ms = 2 ** 63 - 1 if args.end is None else args.end * 1000 + 999
+
+    sensors = load_sensors(args.sensors)
+    index = read_index(index_path)
+    with open(args.log, "rb") as f:
+        log = f.read()
+
+    out = open(args.output, "w", newline="") if args.output else sys.stdout
+    skipped = [0]
+    try:
+        for dp in select_records(log, index, start_ms, end_ms, skipped):
+            if start_ms <= dp["t"] <= end_ms:
+                out.writelines(datapoint_lines(dp, sensors, args.ms))
+    finally:
+        if out is not sys.stdout:
+            out.close()
+
+    if skipped[0]:
+        print(f"Skipped {skipped[0]} damaged records", file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,13 @@
+#include <zephyr/kernel.h>
+#include <time.h>
+
+#include "bench_host.h"
+
+uint64_t bench_host_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+}
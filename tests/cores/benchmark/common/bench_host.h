@@ -0,0 +1,14 @@
+#ifndef BENCH_HOST_H_
+#define BENCH_HOST_H_
+
+#include <zephyr/kernel.h>
+
+/**
+ * @brief Host time in nanoseconds.
+ *
+ * Simulated time does not advance while code runs on native_sim, so the
+ * benchmarks read the host clock instead.
+ */
+uint64_t bench_host_ns(void);
+
+#endif /* BENCH_HOST_H_ */
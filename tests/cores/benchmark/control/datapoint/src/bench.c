@@ -0,0 +1,88 @@
+/* For pthread_getattr_np() */
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <zephyr/kernel.h>
+
+#include "bench.h"
+
+/*
+ * Stack use
+ *
+ * On native_sim, each thread runs on a host pthread with a stack of its own.
+ * Its bounds are only known to the thread itself, so they are noted from the
+ * thread switch hook of the user tracing backend, which runs on the thread
+ * being switched out. The pipeline threads are created at boot, so their
+ * stacks are fresh host mappings, zeroed until first used: the deepest use
+ * is the lowest byte that is not zero. Nothing is written to the stacks.
+ */
+
+struct stack_bounds {
+    k_tid_t thread;
+    const uint8_t *low;
+    const uint8_t *high;
+};
+
+static struct stack_bounds stacks[16];
+static size_t stack_count;
+
+void sys_trace_thread_switched_out_user(void)
+{
+    k_tid_t self = k_current_get();
+    pthread_attr_t attr;
+    void *addr;
+    size_t size;
+
+    /* Called with interrupts locked, which keeps out bench_stack_peak() */
+    for (size_t i = 0; i < stack_count; i++) {
+        if (stacks[i].thread == self) {
+            return;
+        }
+    }
+
+    if (stack_count == ARRAY_SIZE(stacks)) {
+        return;
+    }
+
+    if (pthread_getattr_np(pthread_self(), &attr) != 0) {
+        return;
+    }
+
+    /* The range excludes the guard page below the stack */
+    if (pthread_attr_getstack(&attr, &addr, &size) == 0) {
+        stacks[stack_count++] = (struct stack_bounds) {
+            .thread = self,
+            .low = addr,
+            .high = (const uint8_t *)addr + size,
+        };
+    }
+
+    pthread_attr_destroy(&attr);
+}
+
+size_t bench_stack_peak(k_tid_t thread)
+{
+    struct stack_bounds bounds = { 0 };
+    unsigned int key = irq_lock();
+
+    for (size_t i = 0; i < stack_count; i++) {
+        if (stacks[i].thread == thread) {
+            bounds = stacks[i];
+            break;
+        }
+    }
+
+    irq_unlock(key);
+
+    if (bounds.thread == NULL) {
+        return 0;
+    }
+
+    const uint8_t *p = bounds.low;
+
+    while (p < bounds.high && *p == 0) {
+        p++;
+    }
+
+    return bounds.high - p;
+}
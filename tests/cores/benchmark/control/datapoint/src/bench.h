@@ -0,0 +1,39 @@
+#ifndef BENCH_H_
+#define BENCH_H_
+
+#include <zephyr/kernel.h>
+
+#include <bench_host.h>
+
+/* What the pipeline handed to the stubbed uplink and SD card */
+struct bench_sink_stats {
+    /* Datapoint requests committed to the uplink */
+    uint32_t packets;
+    /* Uplink buffers returned unsent */
+    uint32_t aborted;
+    uint64_t packet_bytes;
+    /* Host time from claiming each uplink buffer to committing it, which
+     * covers building the CoAP header and encoding the datapoint */
+    uint64_t packet_ns;
+    /* CSV lines submitted to the SD card */
+    uint32_t lines;
+    uint64_t line_bytes;
+};
+
+/**
+ * @brief Deepest use of a thread's host stack, from its top.
+ *
+ * On native_sim, threads run on host stacks, so the depth is that of the
+ * host build and includes the host thread's own data at the top of the
+ * stack. It compares between builds, not with the target.
+ *
+ * @return Depth in bytes, or 0 if the thread has not yet been switched out.
+ */
+size_t bench_stack_peak(k_tid_t thread);
+
+void bench_sink_stats_get(struct bench_sink_stats *stats);
+
+/* Samples fully handled by both stubbed sinks */
+uint32_t bench_sink_done(void);
+
+#endif /* BENCH_H_ */
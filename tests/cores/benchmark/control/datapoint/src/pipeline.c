@@ -0,0 +1,223 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/net/coap.h>
+#include <zcbor_common.h>
+
+#include <lib/coap.h>
+#include <datapoint/czd_datapoint_encode.h>
+#include <datapoint_csv.h>
+#include <datapoint_helpers.h>
+#include <datapoint_queue.h>
+#include <datapoint_sensors.h>
+#include <datapoint_sink.h>
+
+#include "bench.h"
+
+/*
+ * Datapoint pipeline benchmark
+ *
+ * Synthetic readings are submitted with submit_float_datapoint() and run
+ * through the real queue, datapoint thread and sinks, down to the stubbed
+ * uplink and SD card. Each stage is then timed on its own. Times are of the
+ * host, and only compare between runs on the same machine.
+ */
+
+/* Samples are submitted in batches no larger than a sink queue, and each
+ * batch is left to drain before the next, so that none are dropped */
+#define PIPELINE_BATCH   MIN(CONFIG_DATAPOINT_SINK_CELLULAR_QUEUE_LEN, \
+                             CONFIG_DATAPOINT_SINK_SD_CARD_QUEUE_LEN)
+#define PIPELINE_BATCHES 2000
+#define PIPELINE_SAMPLES (PIPELINE_BATCH * PIPELINE_BATCHES)
+
+/* Ticks to wait for a batch to drain before giving up */
+#define PIPELINE_DRAIN_TICKS 1000
+
+#define STAGE_ITERATIONS 100000
+
+/* Threads of the pipeline, see datapoint.c */
+extern const k_tid_t datapoint;
+extern const k_tid_t cellular_sink_thread;
+extern const k_tid_t sd_card_sink_thread;
+
+extern const char * const data_path[];
+
+/* Readings of the IMU and the temperature and humidity sensors. Each
+ * alternates by a step larger than the sensor's deadband, so that every
+ * sample is passed on. */
+static const struct {
+    enum datapoint_sensor sensor;
+    double base;
+    double step;
+} readings[] = {
+    { DATAPOINT_SENSOR_LSM6DSO_ACCEL_X, 0.132, 0.25 },
+    { DATAPOINT_SENSOR_LSM6DSO_ACCEL_Y, -0.287, 0.25 },
+    { DATAPOINT_SENSOR_LSM6DSO_ACCEL_Z, 9.806, 0.25 },
+    { DATAPOINT_SENSOR_SHT4X_TEMP, 21.37, 0.1 },
+    { DATAPOINT_SENSOR_SHT4X_HUM, 48.6, 1.0 },
+};
+
+static int submit_sample(uint32_t n)
+{
+    size_t r = n % ARRAY_SIZE(readings);
+    bool stepped = (n / ARRAY_SIZE(readings)) & 1;
+    double value = readings[r].base + (stepped ? readings[r].step : 0.0);
+
+    return submit_float_datapoint(value, readings[r].sensor);
+}
+
+/**
+ * @brief Wait for the sinks to finish with a number of samples.
+ *
+ * The pipeline threads all run below the test thread, and work through
+ * what has been submitted while it sleeps.
+ */
+static bool pipeline_drain(uint32_t samples)
+{
+    for (int i = 0; i < PIPELINE_DRAIN_TICKS; i++) {
+        if (bench_sink_done() >= samples) {
+            return true;
+        }
+
+        k_sleep(K_TICKS(1));
+    }
+
+    return false;
+}
+
+static uint32_t sinks_dropped(void)
+{
+    struct datapoint_sink_stats stats;
+    uint32_t dropped = 0;
+
+    for (size_t i = 0; datapoint_sink_stats_get(i, &stats) == 0; i++) {
+        dropped += stats.dropped;
+    }
+
+    return dropped;
+}
+
+static void report_stack(const char *name, k_tid_t thread)
+{
+    TC_PRINT("%-21s %zu B\n", name, bench_stack_peak(thread));
+}
+
+ZTEST(datapoint_pipeline, test_pipeline)
+{
+    struct bench_sink_stats before;
+    struct bench_sink_stats after;
+    struct datapoint_queue_stats queue;
+    uint32_t dropped = sinks_dropped();
+    uint64_t submit_ns = 0;
+
+    datapoint_queue_stats_reset();
+    bench_sink_stats_get(&before);
+
+    uint32_t done = bench_sink_done();
+    uint64_t start = bench_host_ns();
+
+    for (uint32_t n = 0; n < PIPELINE_SAMPLES; n += PIPELINE_BATCH) {
+        uint64_t batch_start = bench_host_ns();
+
+        for (uint32_t i = n; i < n + PIPELINE_BATCH; i++) {
+            zassert_ok(submit_sample(i));
+        }
+
+        submit_ns += bench_host_ns() - batch_start;
+
+        zassert_true(pipeline_drain(done + n + PIPELINE_BATCH),
+                     "Sinks stalled after %u samples", n);
+    }
+
+    uint64_t elapsed_ns = bench_host_ns() - start;
+
+    bench_sink_stats_get(&after);
+    datapoint_queue_stats_get(&queue);
+
+    uint32_t packets = after.packets - before.packets;
+    uint32_t lines = after.lines - before.lines;
+
+    zassert_equal(queue.dropped, 0, "Queue dropped %u", queue.dropped);
+    zassert_equal(sinks_dropped(), dropped, "Sinks dropped datapoints");
+    zassert_equal(after.aborted, before.aborted, "Uplink aborted");
+    zassert_equal(packets, PIPELINE_SAMPLES, "%u packets", packets);
+    zassert_equal(lines, PIPELINE_SAMPLES, "%u lines", lines);
+
+    TC_PRINT("%u samples in %llu ms: %llu samples/s\n", PIPELINE_SAMPLES,
+             elapsed_ns / NSEC_PER_MSEC,
+             (uint64_t)PIPELINE_SAMPLES * NSEC_PER_SEC / elapsed_ns);
+    TC_PRINT("submit:               %llu ns/sample\n",
+             submit_ns / PIPELINE_SAMPLES);
+    TC_PRINT("uplink claim->commit: %llu ns/packet, %llu B/packet\n",
+             (after.packet_ns - before.packet_ns) / packets,
+             (after.packet_bytes - before.packet_bytes) / packets);
+    TC_PRINT("SD card line:         %llu B/line\n",
+             (after.line_bytes - before.line_bytes) / lines);
+    TC_PRINT("queue high water:     %u of %u records\n", queue.high_water,
+             queue.capacity);
+
+    zassert_true(bench_stack_peak(datapoint) > 0,
+                 "Datapoint thread stack not found");
+
+    TC_PRINT("Peak host stack use:\n");
+    report_stack("datapoint", datapoint);
+    report_stack("cellular_sink_thread", cellular_sink_thread);
+    report_stack("sd_card_sink_thread", sd_card_sink_thread);
+}
+
+ZTEST(datapoint_pipeline, test_stages)
+{
+    struct datapoint_record rec = {
+        .sensor_id = DATAPOINT_SENSOR_SHT4X_TEMP,
+        .type = DATAPOINT_VALUE_FLOAT,
+        .value.f = 21.37f,
+    };
+    struct coap_request_template tpl;
+    struct datapoint dp;
+    uint8_t buf[CONFIG_CELLULAR_UPLINK_BUFFER_SIZE];
+    char line[256];
+    size_t total = 0;
+    uint64_t start;
+
+    zassert_ok(coap_template_init(&tpl, COAP_TYPE_NON_CON, COAP_METHOD_POST,
+                                  data_path));
+
+    start = bench_host_ns();
+    for (int i = 0; i < STAGE_ITERATIONS; i++) {
+        total += datapoint_expand(&rec, &dp) == 0;
+    }
+    uint64_t expand_ns = bench_host_ns() - start;
+
+    /* As the sinks see it, in UTC seconds with the IMEI tail set */
+    dp.t = 1700000000;
+    dp.i = 267864;
+
+    start = bench_host_ns();
+    for (int i = 0; i < STAGE_ITERATIONS; i++) {
+        total += coap_template_build(&tpl, buf, sizeof(buf), true) > 0;
+    }
+    uint64_t coap_ns = bench_host_ns() - start;
+
+    start = bench_host_ns();
+    for (int i = 0; i < STAGE_ITERATIONS; i++) {
+        size_t len = 0;
+
+        total += cbor_encode_datapoint(buf, sizeof(buf), &dp, &len) ==
+                 ZCBOR_SUCCESS;
+    }
+    uint64_t cbor_ns = bench_host_ns() - start;
+
+    start = bench_host_ns();
+    for (int i = 0; i < STAGE_ITERATIONS; i++) {
+        total += datapoint_to_csv(&dp, line, sizeof(line)) > 0;
+    }
+    uint64_t csv_ns = bench_host_ns() - start;
+
+    zassert_equal(total, 4 * STAGE_ITERATIONS, "A stage failed");
+
+    TC_PRINT("datapoint_expand:      %llu ns\n", expand_ns / STAGE_ITERATIONS);
+    TC_PRINT("coap_template_build:   %llu ns\n", coap_ns / STAGE_ITERATIONS);
+    TC_PRINT("cbor_encode_datapoint: %llu ns\n", cbor_ns / STAGE_ITERATIONS);
+    TC_PRINT("datapoint_to_csv:      %llu ns\n", csv_ns / STAGE_ITERATIONS);
+}
+
+ZTEST_SUITE(datapoint_pipeline, NULL, NULL, NULL, NULL, NULL);
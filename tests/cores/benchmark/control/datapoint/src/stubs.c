@@ -0,0 +1,110 @@
+#include <zephyr/kernel.h>
+
+#include <date_time.h>
+#include <lib/cellular.h>
+#include <sd_card.h>
+
+#include "bench.h"
+
+/* UTC at boot, as if date_time had synced then */
+#define BENCH_BOOT_UTC_MS 1700000000000LL
+
+/* Uplink */
+static uint8_t uplink_data[CONFIG_CELLULAR_UPLINK_BUFFER_SIZE];
+static uint64_t claimed_at;
+
+/* Counts are read while the sinks run, the totals once they are idle */
+static atomic_t packets;
+static atomic_t lines;
+static uint32_t aborted;
+static uint64_t packet_bytes;
+static uint64_t packet_ns;
+static uint64_t line_bytes;
+
+cellular_state_t cellular_state_get(void)
+{
+    return CELLULAR_STATE_RUNNING;
+}
+
+int cellular_uplink_claim(struct cellular_uplink_buf *buf, size_t size,
+                          enum cellular_priority priority)
+{
+    ARG_UNUSED(priority);
+
+    if (buf == NULL || size == 0 || size > sizeof(uplink_data)) {
+        return -EINVAL;
+    }
+
+    /* Only the cellular sink claims, one buffer at a time */
+    buf->data = uplink_data;
+    buf->size = size;
+    buf->tag = NULL;
+    buf->priv = uplink_data;
+
+    claimed_at = bench_host_ns();
+
+    return 0;
+}
+
+int cellular_uplink_commit(struct cellular_uplink_buf *buf, size_t len)
+{
+    uint64_t now = bench_host_ns();
+
+    if (buf == NULL || buf->priv == NULL || len > buf->size) {
+        return -EINVAL;
+    }
+
+    buf->priv = NULL;
+    packet_ns += now - claimed_at;
+    packet_bytes += len;
+    atomic_inc(&packets);
+
+    return 0;
+}
+
+void cellular_uplink_abort(struct cellular_uplink_buf *buf)
+{
+    if (buf != NULL) {
+        buf->priv = NULL;
+    }
+
+    aborted++;
+}
+
+/* SD card */
+int sd_card_submit_line(const char *line, size_t line_len,
+                        k_timeout_t timeout)
+{
+    ARG_UNUSED(line);
+    ARG_UNUSED(timeout);
+
+    line_bytes += line_len;
+    atomic_inc(&lines);
+
+    return 0;
+}
+
+/* Wall clock, as read by datapoint_clock_offset() */
+int date_time_now(int64_t *unix_time_ms)
+{
+    *unix_time_ms = BENCH_BOOT_UTC_MS + k_uptime_get();
+
+    return 0;
+}
+
+void bench_sink_stats_get(struct bench_sink_stats *stats)
+{
+    *stats = (struct bench_sink_stats) {
+        .packets = atomic_get(&packets),
+        .aborted = aborted,
+        .packet_bytes = packet_bytes,
+        .packet_ns = packet_ns,
+        .lines = atomic_get(&lines),
+        .line_bytes = line_bytes,
+    };
+}
+
+uint32_t bench_sink_done(void)
+{
+    return MIN(atomic_get(&packets), atomic_get(&lines));
+}
@@ -0,0 +1,61 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include <bench_host.h>
+#include <datapoint_csv.h>
+#include "csv_reference.h"
+
+#define BENCHMARK_LINES 100000
+
+#define TSTR(s) ((struct zcbor_string) { (const uint8_t *)(s), sizeof(s) - 1 })
+
+typedef int (*csv_formatter_t)(const struct datapoint *dp, char *buf,
+                               size_t buf_size);
+
+/* A spread of readings like those the sensors log */
+static struct datapoint lines[16];
+
+static uint64_t time_formatter(csv_formatter_t format)
+{
+    char buf[256];
+    size_t total = 0;
+    uint64_t start = bench_host_ns();
+
+    for (int i = 0; i < BENCHMARK_LINES; i++) {
+        total += format(&lines[i % ARRAY_SIZE(lines)], buf, sizeof(buf));
+    }
+
+    uint64_t elapsed = bench_host_ns() - start;
+
+    zassert_true(total > 0);
+
+    return elapsed;
+}
+
+static void *benchmark_setup(void)
+{
+    for (size_t i = 0; i < ARRAY_SIZE(lines); i++) {
+        lines[i] = (struct datapoint) {
+            .t = 1700000000000 + i * 1000,
+            .s.s = TSTR("sht4x_temp"),
+            .f_present = true,
+            .f.f = (double)(float)(18.0 + i * 0.37),
+            .u_present = true,
+            .u.u = TSTR("Cel"),
+        };
+    }
+
+    return NULL;
+}
+
+ZTEST(datapoint_csv_benchmark, test_format_speed)
+{
+    uint64_t reference_ns = time_formatter(csv_reference);
+    uint64_t fast_ns = time_formatter(datapoint_to_csv);
+
+    TC_PRINT("snprintf:         %llu ns/line\n",
+             reference_ns / BENCHMARK_LINES);
+    TC_PRINT("datapoint_to_csv: %llu ns/line\n", fast_ns / BENCHMARK_LINES);
+}
+
+ZTEST_SUITE(datapoint_csv_benchmark, NULL, benchmark_setup, NULL, NULL, NULL);
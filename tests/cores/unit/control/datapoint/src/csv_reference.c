@@ -0,0 +1,62 @@
+#include <zephyr/kernel.h>
+#include <stdio.h>
+#include <inttypes.h>
+
+#include "csv_reference.h"
+
+#define CHECK_RET(ret, offset, buf_size)                                      \
+    do {                                                                      \
+        if ((ret) < 0 || (ret) >= (int)((buf_size) - (offset))) {            \
+            return -ENOMEM;                                                   \
+        }                                                                     \
+        (offset) += (ret);                                                    \
+    } while (0)
+
+int csv_reference(const struct datapoint *dp, char *buf, size_t buf_size)
+{
+    if (!dp || !buf) {
+        return -EINVAL;
+    }
+
+    size_t offset = 0;
+    int ret;
+
+    ret = snprintf(buf + offset, buf_size - offset, "%" PRId64 ",", dp->t);
+    CHECK_RET(ret, offset, buf_size);
+
+    ret = snprintf(buf + offset, buf_size - offset, "%.*s,",
+                   (int)dp->s.s.len, dp->s.s.value);
+    CHECK_RET(ret, offset, buf_size);
+
+    if (dp->n_present) {
+        ret = snprintf(buf + offset, buf_size - offset, "%d,", dp->n.n);
+    } else {
+        ret = snprintf(buf + offset, buf_size - offset, ",");
+    }
+    CHECK_RET(ret, offset, buf_size);
+
+    if (dp->f_present) {
+        ret = snprintf(buf + offset, buf_size - offset, "%.6f,", dp->f.f);
+    } else {
+        ret = snprintf(buf + offset, buf_size - offset, ",");
+    }
+    CHECK_RET(ret, offset, buf_size);
+
+    if (dp->r_present) {
+        ret = snprintf(buf + offset, buf_size - offset, "%.*s,",
+                       (int)dp->r.r.len, dp->r.r.value);
+    } else {
+        ret = snprintf(buf + offset, buf_size - offset, ",");
+    }
+    CHECK_RET(ret, offset, buf_size);
+
+    if (dp->u_present) {
+        ret = snprintf(buf + offset, buf_size - offset, "%.*s\n",
+                       (int)dp->u.u.len, dp->u.u.value);
+    } else {
+        ret = snprintf(buf + offset, buf_size - offset, "\n");
+    }
+    CHECK_RET(ret, offset, buf_size);
+
+    return offset;
+}
@@ -0,0 +1,13 @@
+#ifndef _CSV_REFERENCE_H_
+#define _CSV_REFERENCE_H_
+
+#include <zephyr/kernel.h>
+#include <datapoint/czd_datapoint_types.h>
+
+/**
+ * @brief The snprintf() based CSV formatter that datapoint_to_csv()
+ *        replaced, kept as the reference for its output.
+ */
+int csv_reference(const struct datapoint *dp, char *buf, size_t buf_size);
+
+#endif /* _CSV_REFERENCE_H_ */
@@ -0,0 +1,94 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include <math.h>
+
+#include <datapoint_helpers.h>
+#include <datapoint_senml.h>
+
+#define TSTR(s) ((struct zcbor_string) { (const uint8_t *)(s), sizeof(s) - 1 })
+
+/* A whole second, so that it is the base time of the pack */
+#define BASE_MS 1700000000000LL
+
+/* Windowed summaries are not encoded by these tests */
+int datapoint_summary_row(const struct datapoint *dp, unsigned int row,
+                          struct datapoint *out, char *name_buf)
+{
+    return -ENOTSUP;
+}
+
+/**
+ * @brief Encode a datapoint at the base time and one relative_ms later, and
+ *        read back the time of the second.
+ *
+ * The relative time is the last entry of the last record, so the pack ends
+ * with it as a float.
+ */
+static int64_t round_trip_ms(int64_t relative_ms, uint8_t *float_head)
+{
+    struct datapoint dps[2];
+    uint8_t buf[128];
+    size_t len;
+
+    for (size_t i = 0; i < ARRAY_SIZE(dps); i++) {
+        dps[i] = (struct datapoint) {
+            .t = BASE_MS + i * relative_ms,
+            .s.s = TSTR("sht4x_temp"),
+            .f_present = true,
+            .f.f = 21.5,
+            .u_present = true,
+            .u.u = TSTR("Cel"),
+        };
+    }
+
+    zassert_equal(datapoint_senml_encode(dps, ARRAY_SIZE(dps), buf,
+                                         sizeof(buf), &len), 2);
+
+    if (buf[len - 5] == 0xfa) {
+        uint32_t bits = sys_get_be32(&buf[len - 4]);
+        float seconds;
+
+        memcpy(&seconds, &bits, sizeof(seconds));
+        *float_head = 0xfa;
+
+        return llround(seconds * 1000.0);
+    }
+
+    zassert_equal(buf[len - 9], 0xfb, "Relative time is not a float");
+
+    uint64_t bits = sys_get_be64(&buf[len - 8]);
+    double seconds;
+
+    memcpy(&seconds, &bits, sizeof(seconds));
+    *float_head = 0xfb;
+
+    return llround(seconds * 1000.0);
+}
+
+ZTEST(datapoint_senml, test_time_below_float32_bound)
+{
+    uint8_t head;
+
+    /* Just below the bound, single precision is still exact */
+    zassert_equal(round_trip_ms(7999999, &head), 7999999);
+    zassert_equal(head, 0xfa, "Expected a single precision time");
+
+    zassert_equal(round_trip_ms(1234, &head), 1234);
+    zassert_equal(head, 0xfa, "Expected a single precision time");
+}
+
+ZTEST(datapoint_senml, test_time_above_float32_bound)
+{
+    uint8_t head;
+
+    /* Single precision would be a millisecond out at 16384.005 s */
+    zassert_equal(round_trip_ms(8000001, &head), 8000001);
+    zassert_equal(head, 0xfb, "Expected a double precision time");
+
+    zassert_equal(round_trip_ms(16384005, &head), 16384005);
+    zassert_equal(head, 0xfb, "Expected a double precision time");
+}
+
+ZTEST_SUITE(datapoint_senml, NULL, NULL, NULL, NULL, NULL);
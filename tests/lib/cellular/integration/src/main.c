@@ -9,6 +9,10 @@ K_SEM_DEFINE(rx_sem, 0, 1);
 
 struct cellular_backend cellular_backend_mock;
 
+static atomic_t mock_link_up = ATOMIC_INIT(1);
+static atomic_t reconnecting_seen = ATOMIC_INIT(0);
+static atomic_t running_seen = ATOMIC_INIT(0);
+
 void cellular_recv_cb(const uint8_t *payload, size_t payload_len)
 {
     printk("Recv callback executed!\n");
@@ -19,7 +23,8 @@ void cellular_recv_cb(const uint8_t *payload, size_t payload_len)
 
 int cellular_backend_mock_init_ok(void)
 {
-    return 0;
+    /* A modem does not finish initialising without a network */
+    return atomic_get(&mock_link_up) != 0 ? 0 : -ENETDOWN;
 }
 
 int cellular_backend_mock_init_fail(void)
@@ -27,6 +32,34 @@ int cellular_backend_mock_init_fail(void)
     return 1;
 }
 
+bool cellular_backend_mock_link_is_up(void)
+{
+    return atomic_get(&mock_link_up) != 0;
+}
+
+void cellular_state_cb(cellular_state_t state)
+{
+    if (state == CELLULAR_STATE_RECONNECTING) {
+        atomic_inc(&reconnecting_seen);
+    } else if (state == CELLULAR_STATE_RUNNING) {
+        atomic_inc(&running_seen);
+    }
+}
+
+static int wait_for_state(cellular_state_t state, int timeout_ms)
+{
+    int64_t start = k_uptime_get();
+
+    while (cellular_state_get() != state) {
+        if (k_uptime_get() - start > timeout_ms) {
+            return -ETIMEDOUT;
+        }
+        k_sleep(K_MSEC(5));
+    }
+
+    return 0;
+}
+
 const struct cellular_backend *cellular_get_selected_backend(void)
 {
     return &cellular_backend_mock;
@@ -38,6 +71,13 @@ ZTEST(cellular_integration, test_cellular_integration)
     int cellular_state;
     uint8_t req[] = "native_sim mock";
 
+    /* Subscribe to state changes */
+    err = cellular_state_subscribe(NULL);
+    zassert_true(err != 0, "Subscribing a NULL callback didn't fail");
+
+    err = cellular_state_subscribe(cellular_state_cb);
+    zassert_true(err == 0, "State subscribe failed: %d", err);
+
     /* Fail to start thread using bad receive callback */
     err = cellular_init(NULL);
     zassert_true(err != 0, "Cellular init didn't fail");
@@ -58,24 +98,17 @@ ZTEST(cellular_integration, test_cellular_integration)
     zassert_true(cellular_state == CELLULAR_STATE_BACKEND_ERROR,
                  "Cellular state incorrect: %d", cellular_state);
 
-    /* Start the cellular thread */
-    cellular_backend_mock.init = cellular_backend_mock_init_ok;
-    err = cellular_init(cellular_recv_cb);
-    zassert_true(err == 0, "Cellular init failed: %d", err);
-
-    /* Let the thread run briefly */
-    k_sleep(K_MSEC(5));
-
-    cellular_state = cellular_state_get();
-    zassert_true(cellular_state == CELLULAR_STATE_RUNNING,
-                 "Cellular state incorrect: %d", cellular_state);
-
-    /* Let the thread run briefly*/
-    k_sleep(K_MSEC(5));
-
+    /* The thread keeps retrying, so a second init is rejected */
     err = cellular_init(cellular_recv_cb);
     zassert_true(err != 0, "Cellular init should have failed", err);
 
+    /* Fix the backend and let the thread reconnect on its own */
+    cellular_backend_mock.init = cellular_backend_mock_init_ok;
+    err = wait_for_state(CELLULAR_STATE_RUNNING, 1000);
+    zassert_true(err == 0, "Cellular thread did not recover");
+    zassert_true(atomic_get(&reconnecting_seen) > 0,
+                 "Reconnecting state not published");
+
     /* Send a message */
     err = cellular_send_packet(req, sizeof(req));
     zassert_true(err == 0, "Cellular send packet failed: %d", err);
@@ -88,6 +121,28 @@ ZTEST(cellular_integration, test_cellular_integration)
     /* Check that the packet memory blocks were free'd. */
     uint32_t num_used_packets = cellular_packet_allocated_count();
     zassert_true(num_used_packets == 0, "Packet(s) not free'd.");
+    zassert_true(cellular_downlink_packet_allocated_count() <= 1,
+                 "Delivered downlink packet(s) not free'd.");
+
+    /* Drop the link and check that the thread reconnects */
+    atomic_val_t running_before = atomic_get(&running_seen);
+    cellular_backend_mock.link_is_up = cellular_backend_mock_link_is_up;
+    atomic_set(&mock_link_up, 0);
+
+    err = wait_for_state(CELLULAR_STATE_RECONNECTING, 1000);
+    zassert_true(err == 0, "Link loss not detected");
+
+    atomic_set(&mock_link_up, 1);
+    err = wait_for_state(CELLULAR_STATE_RUNNING, 1000);
+    zassert_true(err == 0, "Cellular thread did not reconnect");
+    zassert_true(atomic_get(&running_seen) > running_before,
+                 "Running state not published");
+
+    struct cellular_link_status status;
+    cellular_link_status_get(&status);
+    zassert_true(status.reconnects == 1, "Unexpected reconnect count: %u",
+                 status.reconnects);
+    zassert_true(status.down_since == 0, "Link should be up");
 }
 
 ZTEST_SUITE(cellular_integration, NULL, NULL, NULL, NULL, NULL);
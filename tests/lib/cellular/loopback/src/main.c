@@ -0,0 +1,140 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/net/coap.h>
+
+#include <lib/cellular.h>
+#include <lib/coap.h>
+
+#define LOOPBACK_NUM_DATAPOINTS 500
+#define LOOPBACK_NUM_POLLS      20
+#define LOOPBACK_TIMEOUT_MS     10000
+
+K_SEM_DEFINE(poll_sem, 0, 1);
+
+static atomic_t responses_received;
+static atomic_t expect_poll;
+
+static const char * const data_path[] = {
+    "ccd99122-3904-454a-95c7-9fb71f2c3fde", "data", NULL
+};
+
+static const char * const commands_path[] = {
+    "ccd99122-3904-454a-95c7-9fb71f2c3fde", "commands", NULL
+};
+
+/* {"i": 267864, "t": 1760000000, "s": "loopback", "f": 1.5, "u": "V"} */
+static const uint8_t datapoint_cbor[] = {
+    0xa5, 0x61, 0x69, 0x1a, 0x00, 0x04, 0x16, 0x58, 0x61, 0x74, 0x1a, 0x68,
+    0xe7, 0x78, 0x00, 0x61, 0x73, 0x68, 0x6c, 0x6f, 0x6f, 0x70, 0x62, 0x61,
+    0x63, 0x6b, 0x61, 0x66, 0xfb, 0x3f, 0xf8, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x61, 0x75, 0x61, 0x56
+};
+
+void cellular_recv_cb(const uint8_t *payload, size_t payload_len)
+{
+    struct coap_packet response;
+
+    if (coap_packet_parse(&response, (uint8_t *)payload, payload_len,
+                          NULL, 0) != 0) {
+        printk("Failed to parse response\n");
+        return;
+    }
+
+    atomic_inc(&responses_received);
+
+    if (coap_header_get_code(&response) == COAP_RESPONSE_CODE_CONTENT &&
+        atomic_cas(&expect_poll, 1, 0)) {
+        k_sem_give(&poll_sem);
+    }
+}
+
+static int send_request(enum coap_method method, const char * const *path,
+                        const uint8_t *payload, size_t payload_len)
+{
+    uint8_t buf[CONFIG_CELLULAR_UPLINK_BUFFER_SIZE];
+
+    int len = coap_build_request(buf, sizeof(buf), COAP_TYPE_NON_CON, method,
+                                 path, payload, payload_len);
+    if (len < 0) {
+        return len;
+    }
+
+    /* Back off while the uplink queue drains */
+    int err;
+    while ((err = cellular_send_packet(buf, len)) == -ENOMSG ||
+           err == -ENOMEM) {
+        k_sleep(K_MSEC(1));
+    }
+
+    return err;
+}
+
+static void *loopback_setup(void)
+{
+    int err = cellular_init(cellular_recv_cb);
+    zassert_true(err == 0, "Cellular init failed: %d", err);
+
+    int64_t start = k_uptime_get();
+    while (cellular_state_get() != CELLULAR_STATE_RUNNING) {
+        zassert_true(k_uptime_get() - start < LOOPBACK_TIMEOUT_MS,
+                     "Cellular did not reach RUNNING");
+        k_sleep(K_MSEC(10));
+    }
+
+    return NULL;
+}
+
+ZTEST(cellular_loopback, test_datapoint_throughput)
+{
+    atomic_set(&responses_received, 0);
+
+    int64_t start = k_uptime_get();
+
+    for (int i = 0; i < LOOPBACK_NUM_DATAPOINTS; i++) {
+        int err = send_request(COAP_METHOD_POST, data_path,
+                               datapoint_cbor, sizeof(datapoint_cbor));
+        zassert_true(err == 0, "Failed to send datapoint %d: %d", i, err);
+    }
+
+    while (atomic_get(&responses_received) < LOOPBACK_NUM_DATAPOINTS) {
+        zassert_true(k_uptime_get() - start < LOOPBACK_TIMEOUT_MS,
+                     "Only %d/%d responses received",
+                     (int)atomic_get(&responses_received),
+                     LOOPBACK_NUM_DATAPOINTS);
+        k_sleep(K_MSEC(1));
+    }
+
+    int64_t elapsed_ms = MAX(k_uptime_get() - start, 1);
+
+    printk("Throughput: %d datapoints in %lld ms (%lld/s)\n",
+           LOOPBACK_NUM_DATAPOINTS, elapsed_ms,
+           (LOOPBACK_NUM_DATAPOINTS * 1000LL) / elapsed_ms);
+}
+
+ZTEST(cellular_loopback, test_command_poll_latency)
+{
+    int64_t min_ms = INT64_MAX;
+    int64_t max_ms = 0;
+    int64_t total_ms = 0;
+
+    for (int i = 0; i < LOOPBACK_NUM_POLLS; i++) {
+        atomic_set(&expect_poll, 1);
+        int64_t start = k_uptime_get();
+
+        int err = send_request(COAP_METHOD_GET, commands_path, NULL, 0);
+        zassert_true(err == 0, "Failed to send poll: %d", err);
+
+        err = k_sem_take(&poll_sem, K_MSEC(LOOPBACK_TIMEOUT_MS));
+        zassert_true(err == 0, "No response to poll %d", i);
+
+        int64_t rtt_ms = k_uptime_get() - start;
+        min_ms = MIN(min_ms, rtt_ms);
+        max_ms = MAX(max_ms, rtt_ms);
+        total_ms += rtt_ms;
+    }
+
+    printk("Command poll RTT: min %lld ms, avg %lld ms, max %lld ms\n",
+           min_ms, total_ms / LOOPBACK_NUM_POLLS, max_ms);
+}
+
+ZTEST_SUITE(cellular_loopback, NULL, loopback_setup, NULL, NULL, NULL);
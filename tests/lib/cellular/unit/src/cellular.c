@@ -1,4 +1,5 @@
 #include <stdint.h>
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/ztest.h>
 
@@ -53,4 +54,91 @@ ZTEST(cellular, test_send_packet_no_free_packets)
     zassert_true(num_used_packets == 0, "Packet(s) not free'd.");
 }
 
+ZTEST(cellular, test_control_with_full_telemetry_queue)
+{
+    struct cellular_uplink_buf buf;
+    struct cellular_packet *packet = NULL;
+    uint8_t buffer[] = "message";
+    int err;
+
+    /* Fill the telemetry queue */
+    for (int i = 0; i < CONFIG_CELLULAR_UPLINK_QUEUE_MAX_ITEMS; i++) {
+        err = cellular_send_packet(buffer, sizeof(buffer));
+        zassert_true(err == 0, "Packet failed to send: %d", err);
+    }
+
+    /* Control traffic is still accepted */
+    err = cellular_uplink_claim(&buf, 4, CELLULAR_PRIORITY_CONTROL);
+    zassert_true(err == 0, "Control claim failed: %d", err);
+    memcpy(buf.data, "ctrl", 4);
+    err = cellular_uplink_commit(&buf, 4);
+    zassert_true(err == 0, "Control commit failed: %d", err);
+
+    /* ... and is dequeued first */
+    err = cellular_uplink_dequeue(&packet, K_NO_WAIT);
+    zassert_true(err == 0, "Failed to dequeue packet: %d", err);
+    zassert_true(packet->priority == CELLULAR_PRIORITY_CONTROL,
+                 "Telemetry sent before control");
+    cellular_packet_free(packet);
+
+    for (int i = 0; i < CONFIG_CELLULAR_UPLINK_QUEUE_MAX_ITEMS; i++) {
+        err = cellular_uplink_dequeue(&packet, K_NO_WAIT);
+        zassert_true(err == 0, "Failed to dequeue packet: %d", err);
+        cellular_packet_free(packet);
+    }
+
+    zassert_true(cellular_packet_allocated_count() == 0,
+                 "Packet(s) not free'd.");
+}
+
+ZTEST(cellular, test_uplink_claim_commit)
+{
+    struct cellular_uplink_buf buf;
+    struct cellular_packet *packet = NULL;
+
+    /* Invalid sizes are rejected */
+    int err = cellular_uplink_claim(&buf, 0, CELLULAR_PRIORITY_TELEMETRY);
+    zassert_true(err != 0, "Claim of zero bytes didn't fail");
+    err = cellular_uplink_claim(&buf, CONFIG_CELLULAR_UPLINK_BUFFER_SIZE + 1,
+                                CELLULAR_PRIORITY_TELEMETRY);
+    zassert_true(err != 0, "Over-sized claim didn't fail");
+
+    err = cellular_uplink_claim(&buf, 4, CELLULAR_PRIORITY_TELEMETRY);
+    zassert_true(err == 0, "Claim failed: %d", err);
+    zassert_true(buf.size >= 4, "Claimed buffer too small");
+
+    /* Data written to the claimed buffer is queued without a copy */
+    memcpy(buf.data, "abcd", 4);
+    err = cellular_uplink_commit(&buf, 4);
+    zassert_true(err == 0, "Commit failed: %d", err);
+
+    err = cellular_uplink_dequeue(&packet, K_NO_WAIT);
+    zassert_true(err == 0, "Failed to dequeue packet: %d", err);
+    zassert_true(packet->len == 4, "Unexpected packet length");
+    zassert_mem_equal(packet->buffer, "abcd", 4);
+    cellular_packet_free(packet);
+
+    zassert_true(cellular_packet_allocated_count() == 0,
+                 "Packet(s) not free'd.");
+}
+
+ZTEST(cellular, test_uplink_abort)
+{
+    struct cellular_uplink_buf buf;
+
+    int err = cellular_uplink_claim(&buf, 8, CELLULAR_PRIORITY_CONTROL);
+    zassert_true(err == 0, "Claim failed: %d", err);
+    cellular_uplink_abort(&buf);
+    zassert_true(cellular_packet_allocated_count() == 0,
+                 "Aborted packet not free'd.");
+
+    /* A commit with an invalid length releases the buffer */
+    err = cellular_uplink_claim(&buf, 8, CELLULAR_PRIORITY_CONTROL);
+    zassert_true(err == 0, "Claim failed: %d", err);
+    err = cellular_uplink_commit(&buf, 0);
+    zassert_true(err != 0, "Commit of zero bytes didn't fail");
+    zassert_true(cellular_packet_allocated_count() == 0,
+                 "Rejected packet not free'd.");
+}
+
 ZTEST_SUITE(cellular, NULL, NULL, NULL, NULL, NULL);
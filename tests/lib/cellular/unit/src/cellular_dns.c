@@ -0,0 +1,34 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/net/net_ip.h>
+
+#include "cellular_dns.h"
+
+ZTEST(cellular_dns, test_dns_cache_store_and_load)
+{
+    struct in_addr in = { .s_addr = htonl(0x7F000001) };
+    struct in_addr out = {0};
+
+    int err = cellular_dns_cache_store(&in);
+    zassert_true(err == 0, "DNS cache store failed: %d", err);
+
+    err = cellular_dns_cache_load(&out);
+    zassert_true(err == 0, "DNS cache load failed: %d", err);
+    zassert_equal(in.s_addr, out.s_addr, "Cached address mismatch");
+}
+
+ZTEST(cellular_dns, test_dns_cache_invalidate)
+{
+    struct in_addr in = { .s_addr = htonl(0x7F000001) };
+    struct in_addr out = {0};
+
+    int err = cellular_dns_cache_store(&in);
+    zassert_true(err == 0, "DNS cache store failed: %d", err);
+
+    cellular_dns_cache_invalidate();
+
+    err = cellular_dns_cache_load(&out);
+    zassert_true(err == -ENOENT, "Invalidated entry was returned");
+}
+
+ZTEST_SUITE(cellular_dns, NULL, NULL, NULL, NULL, NULL);
@@ -1,3 +1,4 @@
+#include <string.h>
 #include <zephyr/kernel.h>
 #include <zephyr/ztest.h>
 
@@ -6,8 +7,73 @@
 ZTEST(cellular_packet, test_packet_alloc_and_free)
 {
     struct cellular_packet *packet;
-    int ret = cellular_packet_alloc(&packet);
+    int ret = cellular_packet_alloc(&packet, CONFIG_CELLULAR_UPLINK_BUFFER_SIZE,
+                                    CELLULAR_PRIORITY_TELEMETRY);
     zassert_true(ret == 0, "Packet alloc failed");
+    zassert_true(cellular_packet_allocated_count() == 1, "Packet not counted");
+    cellular_packet_free(packet);
+    zassert_true(cellular_packet_allocated_count() == 0, "Packet not free'd");
+}
+
+ZTEST(cellular_packet, test_packet_pool_exhaustion)
+{
+    struct cellular_packet *packets[CONFIG_CELLULAR_UPLINK_POOL_SIZE / 16];
+    size_t count = 0;
+
+    /* Short packets fit many times more than full-sized slots would */
+    while (count < ARRAY_SIZE(packets) &&
+           cellular_packet_alloc(&packets[count], 16,
+                                 CELLULAR_PRIORITY_TELEMETRY) == 0) {
+        count++;
+    }
+
+    size_t full_slots = CONFIG_CELLULAR_UPLINK_POOL_SIZE /
+                     CONFIG_CELLULAR_UPLINK_BUFFER_SIZE;
+    zassert_true(count > 2 * full_slots,
+                 "Only %zu short packets fit in the pool", count);
+
+    for (size_t i = 0; i < count; i++) {
+        cellular_packet_free(packets[i]);
+    }
+    zassert_true(cellular_packet_allocated_count() == 0, "Packet(s) not free'd");
+}
+
+ZTEST(cellular_packet, test_control_pool_reserved)
+{
+    struct cellular_packet *telemetry[CONFIG_CELLULAR_UPLINK_POOL_SIZE / 16];
+    struct cellular_packet *control;
+    size_t count = 0;
+
+    /* Exhaust the telemetry pool */
+    while (count < ARRAY_SIZE(telemetry) &&
+           cellular_packet_alloc(&telemetry[count], 16,
+                                 CELLULAR_PRIORITY_TELEMETRY) == 0) {
+        count++;
+    }
+
+    /* Control packets are still available */
+    int ret = cellular_packet_alloc(&control, 16, CELLULAR_PRIORITY_CONTROL);
+    zassert_true(ret == 0, "Control alloc failed: %d", ret);
+    cellular_packet_free(control);
+
+    for (size_t i = 0; i < count; i++) {
+        cellular_packet_free(telemetry[i]);
+    }
+    zassert_true(cellular_packet_allocated_count() == 0, "Packet(s) not free'd");
+}
+
+ZTEST(cellular_packet, test_packet_shrink)
+{
+    struct cellular_packet *packet;
+    int ret = cellular_packet_alloc(&packet, CONFIG_CELLULAR_UPLINK_BUFFER_SIZE,
+                                    CELLULAR_PRIORITY_TELEMETRY);
+    zassert_true(ret == 0, "Packet alloc failed");
+
+    memcpy(packet->buffer, "shrink", 6);
+    ret = cellular_packet_shrink(&packet, 6);
+    zassert_true(ret == 0, "Packet shrink failed");
+    zassert_mem_equal(packet->buffer, "shrink", 6);
+
     cellular_packet_free(packet);
 }
 
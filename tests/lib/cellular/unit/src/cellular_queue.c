@@ -9,6 +9,7 @@ ZTEST(cellular_queue, test_uplink_queue_basic)
     struct cellular_packet *in_pkt = k_malloc(sizeof(struct cellular_packet));
     struct cellular_packet *out_pkt = NULL;
 
+    in_pkt->priority = CELLULAR_PRIORITY_TELEMETRY;
     int ret = cellular_uplink_enqueue(&in_pkt, K_NO_WAIT);
     zassert_true(ret == 0, "Uplink enqueue failed.");
 
@@ -20,4 +21,59 @@ ZTEST(cellular_queue, test_uplink_queue_basic)
     k_free(in_pkt);
 }
 
+ZTEST(cellular_queue, test_uplink_queue_strict_priority)
+{
+    struct cellular_packet *telemetry = k_malloc(sizeof(struct cellular_packet));
+    struct cellular_packet *control = k_malloc(sizeof(struct cellular_packet));
+    struct cellular_packet *out_pkt = NULL;
+
+    telemetry->priority = CELLULAR_PRIORITY_TELEMETRY;
+    control->priority = CELLULAR_PRIORITY_CONTROL;
+
+    /* Control jumps ahead of previously queued telemetry */
+    int ret = cellular_uplink_enqueue(&telemetry, K_NO_WAIT);
+    zassert_true(ret == 0, "Telemetry enqueue failed.");
+    ret = cellular_uplink_enqueue(&control, K_NO_WAIT);
+    zassert_true(ret == 0, "Control enqueue failed.");
+
+    ret = cellular_uplink_dequeue(&out_pkt, K_NO_WAIT);
+    zassert_true(ret == 0, "Uplink dequeue failed.");
+    zassert_equal_ptr(control, out_pkt, "Control packet not sent first.");
+
+    ret = cellular_uplink_dequeue(&out_pkt, K_NO_WAIT);
+    zassert_true(ret == 0, "Uplink dequeue failed.");
+    zassert_equal_ptr(telemetry, out_pkt, "Telemetry packet lost.");
+
+    k_free(telemetry);
+    k_free(control);
+}
+
+ZTEST(cellular_queue, test_downlink_queue_back_to_back)
+{
+    struct cellular_downlink_packet *packets[CONFIG_CELLULAR_DOWNLINK_QUEUE_MAX_ITEMS];
+    struct cellular_downlink_packet *out_pkt = NULL;
+
+    /* Every downlink buffer can be queued without loss */
+    for (int i = 0; i < CONFIG_CELLULAR_DOWNLINK_QUEUE_MAX_ITEMS; i++) {
+        int ret = cellular_downlink_packet_alloc(&packets[i]);
+        zassert_true(ret == 0, "Downlink alloc %d failed.", i);
+
+        ret = cellular_downlink_enqueue(&packets[i], K_NO_WAIT);
+        zassert_true(ret == 0, "Downlink enqueue %d failed.", i);
+    }
+
+    zassert_true(cellular_downlink_packet_alloc(&out_pkt) != 0,
+                 "Downlink pool should be exhausted.");
+
+    for (int i = 0; i < CONFIG_CELLULAR_DOWNLINK_QUEUE_MAX_ITEMS; i++) {
+        int ret = cellular_downlink_dequeue(&out_pkt, K_NO_WAIT);
+        zassert_true(ret == 0, "Downlink dequeue %d failed.", i);
+        zassert_equal_ptr(packets[i], out_pkt, "Downlink order changed.");
+        cellular_downlink_packet_free(out_pkt);
+    }
+
+    zassert_true(cellular_downlink_packet_allocated_count() == 0,
+                 "Downlink packet(s) not free'd.");
+}
+
 ZTEST_SUITE(cellular_queue, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,108 @@
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+
+#include <lib/cellular.h>
+
+#include "cellular_stats.h"
+
+static void stats_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    cellular_stats_reset();
+}
+
+ZTEST(cellular_stats, test_traffic_totals)
+{
+    struct cellular_stats stats;
+
+    cellular_stats_tx("data", 100);
+    cellular_stats_tx("data", 50);
+    cellular_stats_rx(20);
+
+    cellular_stats_get(&stats);
+    zassert_equal(stats.total.tx_bytes, 150);
+    zassert_equal(stats.total.tx_packets, 2);
+    zassert_equal(stats.total.rx_bytes, 20);
+    zassert_equal(stats.total.rx_packets, 1);
+    zassert_equal(stats.hour.tx_bytes, 150, "Hour window not updated");
+    zassert_equal(stats.day.tx_bytes, 150, "Day window not updated");
+}
+
+ZTEST(cellular_stats, test_tags)
+{
+    struct cellular_tag_stats tag;
+
+    cellular_stats_tx("data", 10);
+    cellular_stats_tx("commands", 5);
+    cellular_stats_tx("data", 10);
+
+    /* Beyond CONFIG_CELLULAR_STATS_MAX_TAGS traffic is grouped as "other" */
+    cellular_stats_tx("extra", 7);
+    cellular_stats_tx(NULL, 3);
+
+    zassert_ok(cellular_stats_tag_get(0, &tag));
+    zassert_str_equal(tag.tag, "data");
+    zassert_equal(tag.traffic.tx_bytes, 20);
+    zassert_equal(tag.traffic.tx_packets, 2);
+
+    zassert_ok(cellular_stats_tag_get(1, &tag));
+    zassert_str_equal(tag.tag, "commands");
+    zassert_equal(tag.traffic.tx_bytes, 5);
+
+    zassert_ok(cellular_stats_tag_get(2, &tag));
+    zassert_str_equal(tag.tag, "other");
+    zassert_equal(tag.traffic.tx_bytes, 10);
+    zassert_equal(tag.traffic.tx_packets, 2);
+
+    zassert_equal(cellular_stats_tag_get(3, &tag), -ENOENT);
+}
+
+ZTEST(cellular_stats, test_errors_and_high_water)
+{
+    struct cellular_stats stats;
+
+    cellular_stats_error(CELLULAR_ERROR_SEND);
+    cellular_stats_error(CELLULAR_ERROR_SEND);
+    cellular_stats_error(CELLULAR_ERROR_QUEUE_FULL);
+    cellular_stats_queue_depth(CELLULAR_PRIORITY_TELEMETRY, 3);
+    cellular_stats_queue_depth(CELLULAR_PRIORITY_TELEMETRY, 1);
+
+    cellular_stats_get(&stats);
+    zassert_equal(stats.errors[CELLULAR_ERROR_SEND], 2);
+    zassert_equal(stats.errors[CELLULAR_ERROR_QUEUE_FULL], 1);
+    zassert_equal(stats.queue_high_water[CELLULAR_PRIORITY_TELEMETRY], 3);
+    zassert_equal(stats.queue_high_water[CELLULAR_PRIORITY_CONTROL], 0);
+}
+
+ZTEST(cellular_stats, test_time_in_state)
+{
+    struct cellular_stats stats;
+
+    cellular_stats_state(CELLULAR_STATE_RUNNING);
+    k_sleep(K_MSEC(100));
+    cellular_stats_state(CELLULAR_STATE_RECONNECTING);
+    k_sleep(K_MSEC(50));
+
+    cellular_stats_get(&stats);
+    zassert_true(stats.time_in_state_ms[CELLULAR_STATE_RUNNING] >= 100,
+                 "Running time not accounted");
+    zassert_true(stats.time_in_state_ms[CELLULAR_STATE_RECONNECTING] >= 50,
+                 "Current state time not included");
+}
+
+ZTEST(cellular_stats, test_signal)
+{
+    struct cellular_stats stats;
+
+    cellular_stats_get(&stats);
+    zassert_false(stats.signal_valid, "Signal valid before sampling");
+
+    cellular_stats_signal(-95, -11);
+    cellular_stats_get(&stats);
+    zassert_true(stats.signal_valid, "Signal not recorded");
+    zassert_equal(stats.rsrp_dbm, -95);
+    zassert_equal(stats.rsrq_db, -11);
+}
+
+ZTEST_SUITE(cellular_stats, NULL, NULL, stats_before, NULL, NULL);
@@ -115,10 +115,22 @@ ZTEST(coap_unit, test_invalid_method)
     zassert_true(ret < 0, "Invalid method should not succeed");
 }
 
-ZTEST(coap_unit, test_invalid_type)
+ZTEST(coap_unit, test_con_request)
 {
     int ret = coap_build_request(buf, sizeof(buf),
                                  COAP_TYPE_CON,
+                                 COAP_METHOD_DELETE,
+                                 path,
+                                 NULL, 0);
+
+    zassert_true(ret > 0, "CON request should succeed");
+    zassert_equal((buf[0] >> 4) & 0x3, COAP_TYPE_CON, "Wrong message type");
+}
+
+ZTEST(coap_unit, test_invalid_type)
+{
+    int ret = coap_build_request(buf, sizeof(buf),
+                                 COAP_TYPE_ACK,
                                  COAP_METHOD_GET,
                                  NULL,
                                  NULL, 0);
@@ -156,4 +168,134 @@ ZTEST(coap_unit, test_zero_buf_len)
     zassert_true(ret < 0, "Zero buffer should fail");
 }
 
+ZTEST(coap_unit, test_request_header_matches_request)
+{
+    static uint8_t full[TEST_BUF_SIZE];
+    const uint8_t payload[] = { 0xa1, 0x61, 0x69, 0x01 };
+
+    int full_len = coap_build_request(full, sizeof(full),
+                                      COAP_TYPE_NON_CON,
+                                      COAP_METHOD_POST,
+                                      path,
+                                      payload, sizeof(payload));
+    zassert_true(full_len > 0, "POST request should succeed");
+
+    int hdr_len = coap_build_request_header(buf, sizeof(buf),
+                                            COAP_TYPE_NON_CON,
+                                            COAP_METHOD_POST,
+                                            path,
+                                            true);
+    zassert_true(hdr_len > 0, "Request header should succeed");
+    zassert_equal(hdr_len + sizeof(payload), full_len,
+                  "Header length doesn't leave room for the payload");
+    zassert_equal(buf[hdr_len - 1], COAP_MARKER, "Missing payload marker");
+
+    /* Message IDs and tokens differ between requests, compare the options */
+    memcpy(buf + hdr_len, payload, sizeof(payload));
+    zassert_mem_equal(buf + 4 + COAP_TOKEN_MAX_LEN, full + 4 + COAP_TOKEN_MAX_LEN,
+                      full_len - 4 - COAP_TOKEN_MAX_LEN);
+}
+
+ZTEST(coap_unit, test_request_header_no_payload)
+{
+    int hdr_len = coap_build_request_header(buf, sizeof(buf),
+                                            COAP_TYPE_NON_CON,
+                                            COAP_METHOD_GET,
+                                            path,
+                                            false);
+
+    zassert_true(hdr_len > 0, "Request header should succeed");
+    zassert_not_equal(buf[hdr_len - 1], COAP_MARKER,
+                      "Unexpected payload marker");
+}
+
+ZTEST(coap_unit, test_template_matches_request_header)
+{
+    static uint8_t expected[TEST_BUF_SIZE];
+    struct coap_request_template tpl;
+    size_t options_start = 4 + COAP_TOKEN_MAX_LEN;
+
+    int ret = coap_template_init(&tpl, COAP_TYPE_NON_CON, COAP_METHOD_POST,
+                                 path);
+    zassert_ok(ret, "Template init failed: %d", ret);
+
+    int hdr_len = coap_build_request_header(expected, sizeof(expected),
+                                            COAP_TYPE_NON_CON,
+                                            COAP_METHOD_POST,
+                                            path,
+                                            true);
+    int tpl_len = coap_template_build(&tpl, buf, sizeof(buf), true);
+    zassert_equal(tpl_len, hdr_len, "Template length differs");
+
+    /* Same header byte and code, different message ID and token */
+    zassert_equal(buf[0], expected[0]);
+    zassert_equal(buf[1], expected[1]);
+    zassert_mem_equal(buf + options_start, expected + options_start,
+                      hdr_len - options_start);
+
+    /* The result parses as a request for the same path */
+    struct coap_packet request;
+    buf[tpl_len] = 0x01;
+    zassert_ok(coap_packet_parse(&request, buf, tpl_len + 1, NULL, 0));
+    zassert_equal(coap_header_get_code(&request), COAP_METHOD_POST);
+}
+
+ZTEST(coap_unit, test_template_fresh_ids)
+{
+    struct coap_request_template tpl;
+    uint8_t first[32];
+
+    zassert_ok(coap_template_init(&tpl, COAP_TYPE_NON_CON, COAP_METHOD_GET,
+                                  path));
+
+    int len = coap_template_build(&tpl, first, sizeof(first), false);
+    zassert_true(len > 0, "Template build failed");
+    zassert_equal(coap_template_build(&tpl, buf, sizeof(buf), false), len);
+
+    zassert_true(memcmp(first + 2, buf + 2, 2) != 0,
+                 "Message ID not refreshed");
+}
+
+ZTEST(coap_unit, test_template_errors)
+{
+    struct coap_request_template tpl;
+    uint8_t small[8];
+
+    zassert_true(coap_template_init(&tpl, COAP_TYPE_NON_CON, -1, path) < 0,
+                 "Invalid method should fail");
+    zassert_true(coap_template_init(NULL, COAP_TYPE_NON_CON, COAP_METHOD_GET,
+                                    path) < 0, "NULL template should fail");
+
+    zassert_ok(coap_template_init(&tpl, COAP_TYPE_NON_CON, COAP_METHOD_GET,
+                                  path));
+    zassert_equal(coap_template_build(&tpl, small, sizeof(small), false),
+                  -ENOMEM, "Short buffer should fail");
+}
+
+ZTEST(coap_unit, test_template_observe)
+{
+    struct coap_request_template tpl;
+    static const uint8_t token[COAP_TOKEN_MAX_LEN] = {
+        1, 2, 3, 4, 5, 6, 7, 8
+    };
+    uint8_t parsed_token[COAP_TOKEN_MAX_LEN];
+    struct coap_packet request;
+
+    zassert_equal(coap_template_init_observe(&tpl, path, 2), -EINVAL,
+                  "Only register/deregister are valid");
+    zassert_ok(coap_template_init_observe(&tpl, path, 0));
+
+    int len = coap_template_build_token(&tpl, token, buf, sizeof(buf), false);
+    zassert_true(len > 0, "Template build failed: %d", len);
+
+    zassert_ok(coap_packet_parse(&request, buf, len, NULL, 0));
+    zassert_equal(coap_header_get_type(&request), COAP_TYPE_NON_CON);
+    zassert_equal(coap_header_get_code(&request), COAP_METHOD_GET);
+    zassert_equal(coap_get_option_int(&request, COAP_OPTION_OBSERVE), 0);
+
+    zassert_equal(coap_header_get_token(&request, parsed_token),
+                  COAP_TOKEN_MAX_LEN);
+    zassert_mem_equal(parsed_token, token, COAP_TOKEN_MAX_LEN);
+}
+
 ZTEST_SUITE(coap_unit, NULL, NULL, NULL, NULL, NULL);
@@ -0,0 +1,326 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/net/coap.h>
+#include <string.h>
+
+#include <lib/coap.h>
+
+#define BODY_LEN 300
+
+/* 256 byte datagrams leave room for 128 byte blocks */
+#define SMALL_MTU   256
+#define SMALL_BLOCK 128
+#define SMALL_SZX   COAP_BLOCK_128
+
+static const char * const block_path[] = { "logs", NULL };
+
+static uint8_t body[BODY_LEN];
+static uint8_t received[BODY_LEN];
+static size_t received_len;
+
+static uint8_t sent[CONFIG_COAP_BLOCK_MAX_SIZE + 64];
+static size_t sent_len;
+static atomic_t num_sent;
+
+static atomic_t num_done;
+static int done_result;
+static uint8_t done_code;
+
+static int mock_send(const uint8_t *buf, size_t len)
+{
+    memcpy(sent, buf, len);
+    sent_len = len;
+    atomic_inc(&num_sent);
+    return 0;
+}
+
+static int read_body(size_t offset, uint8_t *buf, size_t len, void *user_data)
+{
+    memcpy(buf, &body[offset], len);
+    return len;
+}
+
+static int write_body(size_t offset, const uint8_t *data, size_t len,
+                      bool last, void *user_data)
+{
+    zassert_equal(offset, received_len, "Blocks written out of order");
+    memcpy(&received[offset], data, len);
+    received_len += len;
+    return 0;
+}
+
+static void done_cb(int result, uint8_t code, void *user_data)
+{
+    done_result = result;
+    done_code = code;
+    atomic_inc(&num_done);
+}
+
+/** @brief Parse the last request and return the value of a block option. */
+static int sent_block_option(struct coap_packet *request, uint16_t option)
+{
+    zassert_ok(coap_packet_parse(request, sent, sent_len, NULL, 0));
+    return coap_get_option_int(request, option);
+}
+
+/** @brief Answer the last request, optionally with a block option. */
+static void respond(uint8_t code, uint16_t option, int value,
+                    const uint8_t *payload, size_t payload_len)
+{
+    struct coap_packet request;
+    struct coap_packet response;
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    uint8_t buf[CONFIG_COAP_BLOCK_MAX_SIZE + 64];
+
+    zassert_ok(coap_packet_parse(&request, sent, sent_len, NULL, 0));
+    uint8_t tkl = coap_header_get_token(&request, token);
+
+    zassert_ok(coap_packet_init(&response, buf, sizeof(buf), COAP_VERSION_1,
+                                COAP_TYPE_NON_CON, tkl, token, code,
+                                coap_next_id()));
+    if (value >= 0) {
+        zassert_ok(coap_append_option_int(&response, option, value));
+    }
+    if (payload_len > 0) {
+        zassert_ok(coap_packet_append_payload_marker(&response));
+        zassert_ok(coap_packet_append_payload(&response, payload,
+                                              payload_len));
+    }
+
+    zassert_ok(coap_packet_parse(&response, buf, response.offset, NULL, 0));
+    zassert_ok(coap_block_handle_message(&response));
+}
+
+static void *block_setup(void)
+{
+    for (int i = 0; i < BODY_LEN; i++) {
+        body[i] = i * 7;
+    }
+
+    return NULL;
+}
+
+static void block_before(void *fixture)
+{
+    zassert_ok(coap_block_init(mock_send, SMALL_MTU, SMALL_MTU));
+    atomic_set(&num_sent, 0);
+    atomic_set(&num_done, 0);
+    received_len = 0;
+    memset(received, 0, sizeof(received));
+}
+
+static void block_after(void *fixture)
+{
+    /* Let anything left over time out so tests stay independent */
+    while (coap_block_active_count() > 0) {
+        k_sleep(K_MSEC(10));
+    }
+}
+
+ZTEST(coap_block, test_upload)
+{
+    struct coap_packet request;
+    uint16_t payload_len;
+
+    zassert_ok(coap_block_upload(COAP_METHOD_PUT, block_path, BODY_LEN,
+                                 read_body, done_cb, NULL));
+
+    for (int num = 0; num * SMALL_BLOCK < BODY_LEN; num++) {
+        size_t offset = num * SMALL_BLOCK;
+        bool more = offset + SMALL_BLOCK < BODY_LEN;
+
+        int block1 = sent_block_option(&request, COAP_OPTION_BLOCK1);
+        zassert_equal(block1, (num << 4) | (more ? 0x8 : 0) | SMALL_SZX,
+                      "Unexpected Block1 option %x", block1);
+        zassert_equal(coap_get_option_int(&request, COAP_OPTION_SIZE1),
+                      num == 0 ? BODY_LEN : -ENOENT,
+                      "Size1 belongs on the first block only");
+
+        const uint8_t *payload = coap_packet_get_payload(&request,
+                                                         &payload_len);
+        zassert_equal(payload_len, MIN(SMALL_BLOCK, BODY_LEN - offset));
+        zassert_mem_equal(payload, &body[offset], payload_len);
+        zassert_true(sent_len <= SMALL_MTU, "Block exceeds the MTU");
+
+        uint8_t code = more ? COAP_RESPONSE_CODE_CONTINUE :
+                              COAP_RESPONSE_CODE_CHANGED;
+        respond(code, COAP_OPTION_BLOCK1, block1 & ~0x8, NULL, 0);
+    }
+
+    zassert_equal(atomic_get(&num_done), 1, "Transfer did not complete");
+    zassert_equal(done_result, 0);
+    zassert_equal(done_code, COAP_RESPONSE_CODE_CHANGED);
+    zassert_equal(coap_block_active_count(), 0);
+}
+
+ZTEST(coap_block, test_upload_adopts_smaller_blocks)
+{
+    struct coap_packet request;
+    uint16_t payload_len;
+
+    zassert_ok(coap_block_upload(COAP_METHOD_POST, block_path, BODY_LEN,
+                                 read_body, done_cb, NULL));
+
+    /* The server only takes the first 64 bytes of block 0 */
+    respond(COAP_RESPONSE_CODE_CONTINUE, COAP_OPTION_BLOCK1, COAP_BLOCK_64,
+            NULL, 0);
+
+    int block1 = sent_block_option(&request, COAP_OPTION_BLOCK1);
+    zassert_equal(block1, (1 << 4) | 0x8 | COAP_BLOCK_64,
+                  "Expected block 1 of 64 bytes, got %x", block1);
+
+    const uint8_t *payload = coap_packet_get_payload(&request, &payload_len);
+    zassert_equal(payload_len, 64);
+    zassert_mem_equal(payload, &body[64], payload_len);
+}
+
+ZTEST(coap_block, test_block_size_follows_mtu)
+{
+    struct coap_packet request;
+
+    zassert_ok(coap_block_init(mock_send, 1280, 1280));
+
+    /* Responses may use the whole receive MTU */
+    zassert_ok(coap_block_download(block_path, write_body, done_cb, NULL));
+    zassert_equal(sent_block_option(&request, COAP_OPTION_BLOCK2),
+                  COAP_BLOCK_1024);
+    respond(COAP_RESPONSE_CODE_CONTENT, COAP_OPTION_BLOCK2, COAP_BLOCK_1024,
+            body, BODY_LEN);
+    zassert_equal(done_result, 0);
+
+    /* Requests are limited by the message buffer */
+    zassert_ok(coap_block_upload(COAP_METHOD_PUT, block_path, BODY_LEN,
+                                 read_body, done_cb, NULL));
+    zassert_true(sent_len <= CONFIG_COAP_MAX_MSG_LEN,
+                 "Block exceeds the message buffer");
+    zassert_equal(sent_block_option(&request, COAP_OPTION_BLOCK1),
+                  0x8 | SMALL_SZX);
+
+    zassert_ok(coap_block_init(mock_send, 32, 32));
+    zassert_equal(coap_block_upload(COAP_METHOD_PUT, block_path, BODY_LEN,
+                                    read_body, done_cb, NULL), -EMSGSIZE);
+}
+
+ZTEST(coap_block, test_download)
+{
+    struct coap_packet request;
+
+    zassert_ok(coap_block_download(block_path, write_body, done_cb, NULL));
+
+    for (int num = 0; num * SMALL_BLOCK < BODY_LEN; num++) {
+        size_t offset = num * SMALL_BLOCK;
+        size_t len = MIN(SMALL_BLOCK, BODY_LEN - offset);
+        bool more = offset + len < BODY_LEN;
+
+        zassert_equal(sent_block_option(&request, COAP_OPTION_BLOCK2),
+                      (num << 4) | SMALL_SZX);
+        zassert_equal(coap_header_get_code(&request), COAP_METHOD_GET);
+
+        respond(COAP_RESPONSE_CODE_CONTENT, COAP_OPTION_BLOCK2,
+                (num << 4) | (more ? 0x8 : 0) | SMALL_SZX,
+                &body[offset], len);
+    }
+
+    zassert_equal(atomic_get(&num_done), 1, "Transfer did not complete");
+    zassert_equal(done_result, 0);
+    zassert_equal(received_len, BODY_LEN);
+    zassert_mem_equal(received, body, BODY_LEN);
+}
+
+ZTEST(coap_block, test_download_single_response)
+{
+    zassert_ok(coap_block_download(block_path, write_body, done_cb, NULL));
+
+    /* Servers may answer small resources without a Block2 option */
+    respond(COAP_RESPONSE_CODE_CONTENT, 0, -1, body, 40);
+
+    zassert_equal(done_result, 0);
+    zassert_equal(received_len, 40);
+    zassert_mem_equal(received, body, 40);
+}
+
+ZTEST(coap_block, test_stale_response_ignored)
+{
+    struct coap_packet request;
+
+    zassert_ok(coap_block_download(block_path, write_body, done_cb, NULL));
+
+    respond(COAP_RESPONSE_CODE_CONTENT, COAP_OPTION_BLOCK2,
+            0x8 | SMALL_SZX, body, SMALL_BLOCK);
+    zassert_equal(sent_block_option(&request, COAP_OPTION_BLOCK2),
+                  (1 << 4) | SMALL_SZX);
+
+    /* A duplicate of block 0, e.g. answering a resend, is dropped */
+    uint8_t dup[sizeof(sent)];
+    size_t dup_len = sent_len;
+    memcpy(dup, sent, sent_len);
+
+    atomic_set(&num_sent, 0);
+    respond(COAP_RESPONSE_CODE_CONTENT, COAP_OPTION_BLOCK2,
+            0x8 | SMALL_SZX, body, SMALL_BLOCK);
+    zassert_equal(atomic_get(&num_sent), 0, "Duplicate block acted on");
+    zassert_equal(received_len, SMALL_BLOCK);
+    zassert_mem_equal(sent, dup, dup_len);
+}
+
+ZTEST(coap_block, test_timeout)
+{
+    zassert_ok(coap_block_download(block_path, write_body, done_cb, NULL));
+
+    while (atomic_get(&num_done) == 0) {
+        k_sleep(K_MSEC(5));
+    }
+
+    zassert_equal(done_result, -ETIMEDOUT);
+    zassert_equal(atomic_get(&num_sent),
+                  1 + CONFIG_COAP_BLOCK_MAX_RETRANSMIT,
+                  "Unexpected number of transmissions");
+}
+
+ZTEST(coap_block, test_resend_fresh_message_id)
+{
+    struct coap_packet request;
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    uint8_t resent_token[COAP_TOKEN_MAX_LEN];
+
+    zassert_ok(coap_block_download(block_path, write_body, done_cb, NULL));
+
+    zassert_ok(coap_packet_parse(&request, sent, sent_len, NULL, 0));
+    uint16_t msg_id = coap_header_get_id(&request);
+    coap_header_get_token(&request, token);
+
+    while (atomic_get(&num_sent) < 2) {
+        k_sleep(K_MSEC(5));
+    }
+
+    /* A server deduplicating by message ID must see the resend */
+    zassert_equal(sent_block_option(&request, COAP_OPTION_BLOCK2), SMALL_SZX);
+    zassert_not_equal(coap_header_get_id(&request), msg_id,
+                      "Resend reused the message ID");
+    coap_header_get_token(&request, resent_token);
+    zassert_mem_equal(resent_token, token, sizeof(token));
+}
+
+ZTEST(coap_block, test_slots_exhausted)
+{
+    for (int i = 0; i < CONFIG_COAP_BLOCK_MAX_TRANSFERS; i++) {
+        zassert_ok(coap_block_download(block_path, write_body, NULL, NULL));
+    }
+
+    zassert_equal(coap_block_download(block_path, write_body, NULL, NULL),
+                  -EBUSY, "Transfer table should be full");
+}
+
+ZTEST(coap_block, test_unrelated_message)
+{
+    struct coap_packet packet;
+    uint8_t req[64];
+
+    int len = coap_build_request(req, sizeof(req), COAP_TYPE_NON_CON,
+                                 COAP_METHOD_GET, block_path, NULL, 0);
+    zassert_ok(coap_packet_parse(&packet, req, len, NULL, 0));
+    zassert_equal(coap_block_handle_message(&packet), -ENOENT);
+    zassert_equal(coap_block_handle_message(NULL), -EINVAL);
+}
+
+ZTEST_SUITE(coap_block, NULL, block_setup, block_before, block_after, NULL);
@@ -0,0 +1,157 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/net/coap.h>
+
+#include <lib/coap.h>
+
+static const char * const con_path[] = { "commands", NULL };
+
+static atomic_t num_sent;
+static atomic_t last_result;
+static atomic_t num_results;
+
+static int mock_send(const uint8_t *buf, size_t len)
+{
+    atomic_inc(&num_sent);
+    return 0;
+}
+
+static void result_cb(uint16_t msg_id, enum coap_con_result result,
+                      void *user_data)
+{
+    atomic_set(&last_result, result);
+    atomic_inc(&num_results);
+}
+
+static int build_con(uint8_t *buf, size_t len)
+{
+    return coap_build_request(buf, len, COAP_TYPE_CON, COAP_METHOD_DELETE,
+                              con_path, NULL, 0);
+}
+
+/** @brief Build and parse a reply of the given type to a request. */
+static void build_reply(const uint8_t *req, uint8_t type, uint8_t *reply,
+                        struct coap_packet *packet)
+{
+    reply[0] = (COAP_VERSION_1 << 6) | (type << 4);
+    reply[1] = COAP_CODE_EMPTY;
+    reply[2] = req[2];
+    reply[3] = req[3];
+
+    zassert_ok(coap_packet_parse(packet, reply, 4, NULL, 0));
+}
+
+static void *con_setup(void)
+{
+    zassert_ok(coap_con_init(mock_send));
+    return NULL;
+}
+
+static void con_before(void *fixture)
+{
+    atomic_set(&num_sent, 0);
+    atomic_set(&num_results, 0);
+    atomic_set(&last_result, -1);
+}
+
+static void con_after(void *fixture)
+{
+    /* Let anything left over time out so tests stay independent */
+    while (coap_con_pending_count() > 0) {
+        k_sleep(K_MSEC(10));
+    }
+}
+
+ZTEST(coap_con, test_ack_completes_delivery)
+{
+    uint8_t req[64];
+    uint8_t ack[4];
+    struct coap_packet packet;
+
+    int len = build_con(req, sizeof(req));
+    zassert_true(len > 0, "CON request should build");
+
+    zassert_ok(coap_con_send(req, len, result_cb, NULL));
+    zassert_equal(atomic_get(&num_sent), 1, "Message not sent");
+    zassert_equal(coap_con_pending_count(), 1);
+
+    build_reply(req, COAP_TYPE_ACK, ack, &packet);
+    zassert_ok(coap_con_handle_message(&packet));
+
+    zassert_equal(atomic_get(&num_results), 1, "Callback not invoked");
+    zassert_equal(atomic_get(&last_result), COAP_CON_DELIVERED);
+    zassert_equal(coap_con_pending_count(), 0);
+
+    /* Duplicate ACKs are ignored */
+    zassert_equal(coap_con_handle_message(&packet), -ENOENT);
+
+    /* No retransmissions after acknowledgement */
+    k_sleep(K_MSEC(3 * CONFIG_COAP_CON_ACK_TIMEOUT_MS));
+    zassert_equal(atomic_get(&num_sent), 1, "Acknowledged message resent");
+}
+
+ZTEST(coap_con, test_reset)
+{
+    uint8_t req[64];
+    uint8_t rst[4];
+    struct coap_packet packet;
+
+    int len = build_con(req, sizeof(req));
+    zassert_ok(coap_con_send(req, len, result_cb, NULL));
+
+    build_reply(req, COAP_TYPE_RESET, rst, &packet);
+    zassert_ok(coap_con_handle_message(&packet));
+    zassert_equal(atomic_get(&last_result), COAP_CON_RESET);
+}
+
+ZTEST(coap_con, test_retransmit_then_timeout)
+{
+    uint8_t req[64];
+
+    int len = build_con(req, sizeof(req));
+    zassert_ok(coap_con_send(req, len, result_cb, NULL));
+
+    /* Worst case: 1.5 * ACK_TIMEOUT * (2^(MAX_RETRANSMIT + 1) - 1) */
+    int64_t limit_ms = 3 * CONFIG_COAP_CON_ACK_TIMEOUT_MS *
+                       ((1 << (CONFIG_COAP_CON_MAX_RETRANSMIT + 1)) - 1) / 2;
+    int64_t start = k_uptime_get();
+
+    while (atomic_get(&num_results) == 0) {
+        zassert_true(k_uptime_get() - start <= limit_ms + 50,
+                     "Delivery did not time out");
+        k_sleep(K_MSEC(5));
+    }
+
+    zassert_equal(atomic_get(&last_result), COAP_CON_TIMEOUT);
+    zassert_equal(atomic_get(&num_sent), 1 + CONFIG_COAP_CON_MAX_RETRANSMIT,
+                  "Unexpected number of transmissions");
+    zassert_true(k_uptime_get() - start >=
+                 CONFIG_COAP_CON_ACK_TIMEOUT_MS *
+                 ((1 << (CONFIG_COAP_CON_MAX_RETRANSMIT + 1)) - 1),
+                 "Backoff too short");
+}
+
+ZTEST(coap_con, test_pool_exhaustion)
+{
+    uint8_t req[64];
+
+    for (int i = 0; i < CONFIG_COAP_CON_MAX_PENDING; i++) {
+        int len = build_con(req, sizeof(req));
+        zassert_ok(coap_con_send(req, len, NULL, NULL));
+    }
+
+    int len = build_con(req, sizeof(req));
+    zassert_equal(coap_con_send(req, len, NULL, NULL), -ENOMEM,
+                  "Pending table should be full");
+}
+
+ZTEST(coap_con, test_rejects_non_confirmable)
+{
+    uint8_t req[64];
+
+    int len = coap_build_request(req, sizeof(req), COAP_TYPE_NON_CON,
+                                 COAP_METHOD_GET, con_path, NULL, 0);
+    zassert_equal(coap_con_send(req, len, NULL, NULL), -EINVAL);
+}
+
+ZTEST_SUITE(coap_con, NULL, con_setup, con_before, con_after, NULL);
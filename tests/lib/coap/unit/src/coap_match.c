@@ -0,0 +1,170 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <zephyr/net/coap.h>
+#include <string.h>
+
+#include <lib/coap.h>
+
+#define MATCH_TIMEOUT_MS 20
+
+static atomic_t num_responses;
+static atomic_t num_timeouts;
+static uint8_t last_code;
+
+static void match_cb(const struct coap_packet *response, int result,
+                     void *user_data)
+{
+    if (result == -ETIMEDOUT) {
+        zassert_is_null(response);
+        atomic_inc(&num_timeouts);
+        return;
+    }
+
+    zassert_ok(result);
+    last_code = coap_header_get_code(response);
+    atomic_inc(&num_responses);
+}
+
+/** @brief Build and parse a NON response with the given token and code. */
+static void build_response(struct coap_packet *response, uint8_t *buf,
+                           size_t len, const uint8_t *token, uint8_t code)
+{
+    zassert_ok(coap_packet_init(response, buf, len, COAP_VERSION_1,
+                                COAP_TYPE_NON_CON, COAP_TOKEN_MAX_LEN, token,
+                                code, coap_next_id()));
+    zassert_ok(coap_packet_parse(response, buf, response->offset, NULL, 0));
+}
+
+static void match_before(void *fixture)
+{
+    atomic_set(&num_responses, 0);
+    atomic_set(&num_timeouts, 0);
+    last_code = 0;
+}
+
+static void match_after(void *fixture)
+{
+    /* Let anything left over expire so tests stay independent */
+    while (coap_match_pending_count() > 0) {
+        k_sleep(K_MSEC(10));
+    }
+}
+
+ZTEST(coap_match, test_routes_by_token)
+{
+    uint8_t first[COAP_TOKEN_MAX_LEN];
+    uint8_t second[COAP_TOKEN_MAX_LEN];
+    struct coap_packet response;
+    uint8_t buf[32];
+
+    memcpy(first, coap_next_token(), sizeof(first));
+    memcpy(second, coap_next_token(), sizeof(second));
+
+    zassert_ok(coap_match_register(first, 1000, 0, match_cb, NULL));
+    zassert_ok(coap_match_register(second, 1000, 0, match_cb, NULL));
+
+    build_response(&response, buf, sizeof(buf), second,
+                   COAP_RESPONSE_CODE_DELETED);
+    zassert_ok(coap_match_handle_message(&response));
+    zassert_equal(atomic_get(&num_responses), 1);
+    zassert_equal(last_code, COAP_RESPONSE_CODE_DELETED);
+
+    /* A single response completes the request, duplicates are stale */
+    zassert_equal(coap_match_handle_message(&response), -ENOENT);
+    zassert_equal(coap_match_pending_count(), 1);
+
+    build_response(&response, buf, sizeof(buf), first,
+                   COAP_RESPONSE_CODE_CONTENT);
+    zassert_ok(coap_match_handle_message(&response));
+    zassert_equal(last_code, COAP_RESPONSE_CODE_CONTENT);
+    zassert_equal(coap_match_pending_count(), 0);
+}
+
+ZTEST(coap_match, test_unmatched_messages)
+{
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    struct coap_packet response;
+    uint8_t buf[32];
+
+    memcpy(token, coap_next_token(), sizeof(token));
+
+    build_response(&response, buf, sizeof(buf), token,
+                   COAP_RESPONSE_CODE_CONTENT);
+    zassert_equal(coap_match_handle_message(&response), -ENOENT);
+
+    /* Requests carrying a registered token are not responses */
+    zassert_ok(coap_match_register(token, MATCH_TIMEOUT_MS, 0, match_cb,
+                                   NULL));
+    build_response(&response, buf, sizeof(buf), token, COAP_METHOD_GET);
+    zassert_equal(coap_match_handle_message(&response), -ENOENT);
+
+    zassert_equal(coap_match_handle_message(NULL), -EINVAL);
+    zassert_equal(atomic_get(&num_responses), 0);
+}
+
+ZTEST(coap_match, test_expiry)
+{
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    struct coap_packet response;
+    uint8_t buf[32];
+
+    memcpy(token, coap_next_token(), sizeof(token));
+    zassert_ok(coap_match_register(token, MATCH_TIMEOUT_MS, 0, match_cb,
+                                   NULL));
+
+    k_sleep(K_MSEC(2 * MATCH_TIMEOUT_MS));
+    zassert_equal(atomic_get(&num_timeouts), 1, "Request did not expire");
+    zassert_equal(coap_match_pending_count(), 0);
+
+    /* A late response is dropped */
+    build_response(&response, buf, sizeof(buf), token,
+                   COAP_RESPONSE_CODE_CONTENT);
+    zassert_equal(coap_match_handle_message(&response), -ENOENT);
+    zassert_equal(atomic_get(&num_responses), 0);
+}
+
+ZTEST(coap_match, test_multiple_responses)
+{
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+    struct coap_packet response;
+    uint8_t buf[32];
+
+    memcpy(token, coap_next_token(), sizeof(token));
+    zassert_ok(coap_match_register(token, 1000, COAP_MATCH_MULTIPLE,
+                                   match_cb, NULL));
+
+    build_response(&response, buf, sizeof(buf), token,
+                   COAP_RESPONSE_CODE_CONTENT);
+    for (int i = 0; i < 3; i++) {
+        zassert_ok(coap_match_handle_message(&response));
+    }
+    zassert_equal(atomic_get(&num_responses), 3);
+
+    /* Registering again refreshes rather than duplicates */
+    zassert_ok(coap_match_register(token, 1000, COAP_MATCH_MULTIPLE,
+                                   match_cb, NULL));
+    zassert_equal(coap_match_pending_count(), 1);
+
+    zassert_ok(coap_match_cancel(token));
+    zassert_equal(coap_match_cancel(token), -ENOENT);
+    zassert_equal(coap_match_handle_message(&response), -ENOENT);
+    zassert_equal(atomic_get(&num_timeouts), 0, "Cancel invoked callback");
+}
+
+ZTEST(coap_match, test_table_full)
+{
+    uint8_t token[COAP_TOKEN_MAX_LEN];
+
+    for (int i = 0; i < CONFIG_COAP_MATCH_MAX_PENDING; i++) {
+        memcpy(token, coap_next_token(), sizeof(token));
+        zassert_ok(coap_match_register(token, MATCH_TIMEOUT_MS, 0, match_cb,
+                                       NULL));
+    }
+
+    memcpy(token, coap_next_token(), sizeof(token));
+    zassert_equal(coap_match_register(token, MATCH_TIMEOUT_MS, 0, match_cb,
+                                      NULL), -ENOMEM,
+                  "Match table should be full");
+}
+
+ZTEST_SUITE(coap_match, NULL, NULL, match_before, match_after, NULL);
@@ -0,0 +1,189 @@
+#include <zephyr/kernel.h>
+#include <zephyr/ztest.h>
+#include <string.h>
+
+#include <lib/tsz.h>
+
+#define MAX_SAMPLES 256
+
+static uint8_t block[2048];
+static uint32_t rand_state = 0x12345678;
+static int64_t times[MAX_SAMPLES];
+static uint32_t values[MAX_SAMPLES];
+
+/** @brief Deterministic xorshift32 so failures can be reproduced. */
+static uint32_t next_rand(void)
+{
+    rand_state ^= rand_state << 13;
+    rand_state ^= rand_state >> 17;
+    rand_state ^= rand_state << 5;
+
+    return rand_state;
+}
+
+/** @brief Encode samples into block and return the block length. */
+static size_t encode(size_t count)
+{
+    struct tsz_encoder enc;
+
+    zassert_ok(tsz_encoder_init(&enc, block, sizeof(block)));
+    for (size_t i = 0; i < count; i++) {
+        zassert_ok(tsz_encoder_append(&enc, times[i], values[i]),
+                   "Sample %zu did not fit", i);
+    }
+
+    return tsz_encoder_finish(&enc);
+}
+
+/** @brief Decode block and check it against the samples. */
+static void check_decode(size_t len, size_t count)
+{
+    struct tsz_decoder dec;
+    int64_t t;
+    uint32_t value;
+
+    zassert_ok(tsz_decoder_init(&dec, block, len));
+    for (size_t i = 0; i < count; i++) {
+        zassert_ok(tsz_decoder_next(&dec, &t, &value), "Sample %zu", i);
+        zassert_equal(t, times[i], "Sample %zu time", i);
+        zassert_equal(value, values[i], "Sample %zu value", i);
+    }
+
+    zassert_equal(tsz_decoder_next(&dec, &t, &value), -ENODATA);
+}
+
+ZTEST(tsz_unit, test_empty_block)
+{
+    size_t len = encode(0);
+
+    zassert_equal(len, 2);
+    check_decode(len, 0);
+}
+
+ZTEST(tsz_unit, test_steady_series)
+{
+    /* A steady period and slowly varying value, as from a thermometer */
+    for (size_t i = 0; i < MAX_SAMPLES; i++) {
+        times[i] = 1700000000000LL + i * 1000;
+        values[i] = tsz_float_bits(21.5f + (i % 8) * 0.25f);
+    }
+
+    size_t len = encode(MAX_SAMPLES);
+    check_decode(len, MAX_SAMPLES);
+
+    /* The raw samples would take 12 bytes each */
+    zassert_true(len < MAX_SAMPLES * 12 / 4, "Block of %zu B compressed poorly",
+                 len);
+}
+
+ZTEST(tsz_unit, test_constant_series)
+{
+    for (size_t i = 0; i < MAX_SAMPLES; i++) {
+        times[i] = i * 500;
+        values[i] = 42;
+    }
+
+    size_t len = encode(MAX_SAMPLES);
+    check_decode(len, MAX_SAMPLES);
+
+    /* Header and first sample, the first interval as a 12 bit delta of
+     * delta, then two bits per sample */
+    zassert_equal(len, 2 + 12 + DIV_ROUND_UP(4 + 12 + 1 +
+                                             (MAX_SAMPLES - 2) * 2, 8));
+}
+
+ZTEST(tsz_unit, test_irregular_series)
+{
+    /* Jitter and gaps covering every delta of delta bucket */
+    static const int64_t steps[] = {
+        1000, 1000, 1001, 990, 1200, 1000, 3000, 60000, 1000, 0, 5,
+        INT32_MAX, 1, -20,
+    };
+
+    times[0] = -5000;
+    values[0] = 0;
+    for (size_t i = 1; i < ARRAY_SIZE(steps); i++) {
+        times[i] = times[i - 1] + steps[i];
+        values[i] = (i % 2) ? UINT32_MAX : (uint32_t)i << 20;
+    }
+
+    size_t len = encode(ARRAY_SIZE(steps));
+    check_decode(len, ARRAY_SIZE(steps));
+}
+
+ZTEST(tsz_unit, test_random_values)
+{
+    for (size_t i = 0; i < MAX_SAMPLES; i++) {
+        times[i] = i * 100 + (next_rand() % 16);
+        values[i] = next_rand() >> (next_rand() % 32);
+    }
+
+    size_t len = encode(MAX_SAMPLES);
+    check_decode(len, MAX_SAMPLES);
+}
+
+ZTEST(tsz_unit, test_full_block)
+{
+    struct tsz_encoder enc;
+    uint8_t small[24];
+    size_t count = 0;
+
+    zassert_ok(tsz_encoder_init(&enc, small, sizeof(small)));
+
+    while (tsz_encoder_append(&enc, count * 1000,
+                              tsz_float_bits(count * 1.5f)) == 0) {
+        times[count] = count * 1000;
+        values[count] = tsz_float_bits(count * 1.5f);
+        count++;
+    }
+    zassert_true(count > 1, "Block should hold more than one sample");
+
+    /* The rejected sample leaves the block intact */
+    size_t len = tsz_encoder_finish(&enc);
+    zassert_true(len <= sizeof(small));
+    memcpy(block, small, len);
+    check_decode(len, count);
+}
+
+ZTEST(tsz_unit, test_range)
+{
+    struct tsz_encoder enc;
+
+    zassert_ok(tsz_encoder_init(&enc, block, sizeof(block)));
+    zassert_ok(tsz_encoder_append(&enc, 0, 0));
+    zassert_ok(tsz_encoder_append(&enc, 1, 0));
+    zassert_equal(tsz_encoder_append(&enc, 1 + BIT64(40), 0), -ERANGE);
+    zassert_ok(tsz_encoder_append(&enc, 2, 0));
+}
+
+ZTEST(tsz_unit, test_truncated_block)
+{
+    for (size_t i = 0; i < 16; i++) {
+        times[i] = i * 1000;
+        values[i] = tsz_float_bits(i * 0.1f);
+    }
+
+    size_t len = encode(16);
+    struct tsz_decoder dec;
+    int64_t t;
+    uint32_t value;
+    int err;
+
+    zassert_ok(tsz_decoder_init(&dec, block, len - 1));
+    do {
+        err = tsz_decoder_next(&dec, &t, &value);
+    } while (err == 0);
+    zassert_equal(err, -EBADMSG);
+
+    zassert_equal(tsz_decoder_init(&dec, block, 1), -EBADMSG);
+}
+
+ZTEST(tsz_unit, test_invalid_args)
+{
+    struct tsz_encoder enc;
+
+    zassert_equal(tsz_encoder_init(&enc, NULL, sizeof(block)), -EINVAL);
+    zassert_equal(tsz_encoder_init(&enc, block, 1), -EINVAL);
+}
+
+ZTEST_SUITE(tsz_unit, NULL, NULL, NULL, NULL, NULL);